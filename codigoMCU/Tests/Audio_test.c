@@ -20,8 +20,8 @@
 volatile bool PIT_trigger;
 volatile bool DMA_trigger;
 
-volatile uint16_t bufA[AUDIO_BUF_LEN];
-volatile uint16_t bufB[AUDIO_BUF_LEN];
+volatile uint16_t bufA[AUDIO_BUF_LEN * AUDIO_CHANNELS];
+volatile uint16_t bufB[AUDIO_BUF_LEN * AUDIO_CHANNELS];
 
 /*******************************************************************************
  *******************************************************************************
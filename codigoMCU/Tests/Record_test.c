@@ -0,0 +1,75 @@
+/***************************************************************************/ /**
+   @file     Record_test.c
+   @brief    Record mode test: captures ADC0_DP1 to 0:/REC.WAV.
+   - PIT2 -> ADC0 -> DMA ring -> preallocated WAV (see Recorder.h)
+   - Records REC_TEST_SECONDS and appends the write counters to 0:/REC.CSV
+
+   Replaces App.c like the other tests (App_Init / App_Run). The counters
+   also stay in g_rec_stats for the debugger: write_kbps has to stay well
+   above REC_FS_HZ * 2 / 1000 (~44 KB/s) and max_write_us below one half of
+   the ring (~185 ms), otherwise samples_dropped grows.
+   @author   Grupo 3
+  ******************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include "MK64F12.h"
+#include "drivers/SDHC/sdhc.h"
+#include "drivers/FAT/ff.h"
+#include "Recorder.h"
+
+#ifndef REC_TEST_SECONDS
+#define REC_TEST_SECONDS    30u
+#endif
+
+#define REC_TEST_WAV        "0:/REC.WAV"
+#define REC_TEST_CSV        "0:/REC.CSV"
+
+static FATFS g_fs;
+volatile recorder_stats_t g_rec_stats;
+volatile bool g_rec_ok;
+
+void App_Init(void)
+{
+    sdhc_enable_clocks_and_pins();
+    sdhc_reset(SDHC_RESET_CMD);
+    sdhc_reset(SDHC_RESET_DATA);
+    __enable_irq();
+}
+
+void App_Run(void)
+{
+    static bool done = false;
+    recorder_stats_t st;
+    char line[128];
+    FIL csv;
+    UINT bw;
+
+    if (done) return;
+    done = true;
+
+    if (f_mount(&g_fs, "0:", 1) != FR_OK) return;
+    if (!Recorder_Start(REC_TEST_WAV, REC_TEST_SECONDS)) return;
+
+    // Se corta solo cuando se llena lo preasignado
+    while (Recorder_Service()) {
+    }
+    g_rec_ok = Recorder_Stop();
+
+    Recorder_GetStats(&st);
+    g_rec_stats = st;
+
+    if (f_open(&csv, REC_TEST_CSV, FA_OPEN_APPEND | FA_WRITE) == FR_OK) {
+        int n = 0;
+        if (f_size(&csv) == 0)
+            n = snprintf(line, sizeof(line), "captured,dropped,overruns,bytes,writes,max_write_us,write_kbps\n");
+        n += snprintf(line + n, sizeof(line) - (size_t)n, "%lu,%lu,%lu,%lu,%lu,%lu,%lu\n",
+                      (unsigned long)st.samples_captured, (unsigned long)st.samples_dropped,
+                      (unsigned long)st.overruns, (unsigned long)st.bytes_written,
+                      (unsigned long)st.writes, (unsigned long)st.max_write_us,
+                      (unsigned long)st.write_kbps);
+        f_write(&csv, line, (UINT)n, &bw);
+        f_close(&csv);
+    }
+}
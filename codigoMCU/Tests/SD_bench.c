@@ -0,0 +1,389 @@
+/***************************************************************************/ /**
+   @file     SD_bench.c
+   @brief    SD / FatFs throughput and latency benchmark.
+   - Sequential f_read throughput for several chunk sizes
+   - Random seek + 512 byte read latency
+   - Root directory scan time (metadata cache cold and warm)
+   - Read latency histogram for MP3Player-sized reads (worst case)
+
+   On target it replaces App.c like the other tests (App_Init / App_Run) and
+   appends one CSV row per run to 0:/BENCH.CSV; results also stay in g_bench
+   for the debugger. Times come from DWT->CYCCNT.
+
+   On the host it runs against a FAT image through diskio_image (see
+   diskio_image.h), printing the CSV header and row to stdout:
+
+     gcc -DHOST_BUILD -I. -Isource \
+         source/drivers/FAT/{ff,ffunicode,ffsystem,fattime,diskio,diskcache,diskio_image}.c \
+         Tests/SD_bench.c -o sd_bench
+     ./sd_bench card.img [ideal|sdhc|sdhc-single]
+
+   Host times are the modeled card time (default model: sdhc, multi-block
+   transfers like the board), so rows from the board and from the image can
+   be compared directly; sdhc-single models one command per sector. With
+   "ideal" the image costs nothing and times are host wall clock (FatFs
+   overhead only).
+
+   The benchmark creates 0:/BENCH.BIN (BENCH_FILE_SIZE bytes) the first time.
+   @author   Grupo 3
+  ******************************************************************************/
+
+/*******************************************************************************
+ * INCLUDE HEADER FILES
+ ******************************************************************************/
+#ifdef HOST_BUILD
+#define _POSIX_C_SOURCE 200809L     // clock_gettime
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include "drivers/FAT/ff.h"
+#include "drivers/FAT/diskcache.h"
+
+#ifdef HOST_BUILD
+#include <time.h>
+#include "drivers/FAT/diskio_image.h"
+#else
+#include "MK64F12.h"
+#include "drivers/SDHC/sdhc.h"
+#endif
+
+/*******************************************************************************
+ * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
+ ******************************************************************************/
+#define BENCH_FILE          "0:/BENCH.BIN"
+#define BENCH_CSV           "0:/BENCH.CSV"
+#define BENCH_DIR           "0:/"
+#ifndef BENCH_FILE_SIZE
+#define BENCH_FILE_SIZE     (1024u * 1024u)
+#endif
+#define BENCH_BUF_SIZE      32768u
+#define BENCH_SEEKS         64u
+#define BENCH_HIST_CHUNK    4096u       // MP3_READ_CHUNK en mp3_player.c
+#define BENCH_HIST_PASSES   4u
+#define BENCH_HIST_BUCKETS  12u         // [0,64) [64,128) ... [65536, inf) us
+#define BENCH_HIST_BASE_US  64u
+
+static const uint32_t k_chunks[] = { 512u, 1024u, 4096u, 8192u, 16384u, 32768u };
+#define BENCH_CHUNKS        (sizeof(k_chunks) / sizeof(k_chunks[0]))
+
+/*******************************************************************************
+ * ENUMERATIONS AND STRUCTURES AND TYPEDEFS
+ ******************************************************************************/
+typedef struct {
+    uint32_t chunk;
+    uint32_t kbps;              // KB/s over the whole file
+    uint32_t max_call_us;       // slowest single f_read
+} bench_seq_t;
+
+typedef struct {
+    FRESULT     status;         // first FatFs error, FR_OK if the run completed
+    bench_seq_t seq[BENCH_CHUNKS];
+    uint32_t    seek_avg_us;
+    uint32_t    seek_max_us;
+    uint32_t    dir_entries;
+    uint32_t    dir_cold_us;
+    uint32_t    dir_warm_us;
+    uint32_t    hist[BENCH_HIST_BUCKETS];
+    uint32_t    worst_us;
+} bench_results_t;
+
+/*******************************************************************************
+ * GLOBAL DATA
+ ******************************************************************************/
+volatile bench_results_t g_bench;
+
+static FATFS g_fs;
+static FIL   g_fil;
+static uint8_t g_buf[BENCH_BUF_SIZE] __attribute__((aligned(4)));
+static char  g_line[512];
+
+/*******************************************************************************
+ * TIMER
+ ******************************************************************************/
+#ifdef HOST_BUILD
+
+static bool g_wall_clock;
+
+static void bench_timer_init(void) { }
+
+/* Con modelo: tiempo modelado de la tarjeta (el costo de CPU del host no
+ * representa al K64). Con "ideal": reloj de pared, mide solo FatFs. */
+static inline uint32_t bench_now(void)
+{
+    if (g_wall_clock) {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (uint32_t)((uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u);
+    }
+    return (uint32_t)diskio_image_time_us();
+}
+
+static inline uint32_t bench_elapsed_us(uint32_t t0)
+{
+    return bench_now() - t0;
+}
+
+#else
+
+static uint32_t g_cycles_per_us;
+
+static void bench_timer_init(void)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0u;
+    DWT->CTRL  |= DWT_CTRL_CYCCNTENA_Msk;
+    g_cycles_per_us = SystemCoreClock / 1000000u;
+}
+
+static inline uint32_t bench_now(void)
+{
+    return DWT->CYCCNT;
+}
+
+// Ciclos sin signo: la vuelta de CYCCNT (~35 s a 120 MHz) no afecta una medición
+static inline uint32_t bench_elapsed_us(uint32_t t0)
+{
+    return (DWT->CYCCNT - t0) / g_cycles_per_us;
+}
+
+#endif
+
+/*******************************************************************************
+ * BENCHMARKS
+ ******************************************************************************/
+static bool bench_fail(FRESULT fr)
+{
+    if (fr != FR_OK && g_bench.status == FR_OK) g_bench.status = fr;
+    return fr != FR_OK;
+}
+
+static FRESULT bench_prepare_file(void)
+{
+    FRESULT fr = f_open(&g_fil, BENCH_FILE, FA_READ);
+    if (fr == FR_OK && f_size(&g_fil) == BENCH_FILE_SIZE) return FR_OK;
+    if (fr == FR_OK) f_close(&g_fil);
+
+    fr = f_open(&g_fil, BENCH_FILE, FA_CREATE_ALWAYS | FA_WRITE | FA_READ);
+    if (fr != FR_OK) return fr;
+
+    for (uint32_t off = 0; off < BENCH_FILE_SIZE && fr == FR_OK; off += BENCH_BUF_SIZE) {
+        UINT bw;
+        for (uint32_t i = 0; i < BENCH_BUF_SIZE; i++) g_buf[i] = (uint8_t)(off + i);
+        fr = f_write(&g_fil, g_buf, BENCH_BUF_SIZE, &bw);
+        if (fr == FR_OK && bw != BENCH_BUF_SIZE) fr = FR_DENIED;     // tarjeta llena
+    }
+    if (fr == FR_OK) fr = f_sync(&g_fil);
+    return fr;
+}
+
+static void bench_sequential(void)
+{
+    for (uint32_t c = 0; c < BENCH_CHUNKS; c++) {
+        uint32_t chunk = k_chunks[c];
+        uint64_t total_us = 0;
+        uint32_t max_us = 0;
+        UINT br = 1;
+
+        if (bench_fail(f_lseek(&g_fil, 0))) return;
+
+        while (br) {
+            uint32_t t0 = bench_now();
+            if (bench_fail(f_read(&g_fil, g_buf, chunk, &br))) return;
+            uint32_t us = bench_elapsed_us(t0);
+            total_us += us;
+            if (us > max_us) max_us = us;
+        }
+
+        g_bench.seq[c].chunk       = chunk;
+        g_bench.seq[c].max_call_us = max_us;
+        g_bench.seq[c].kbps        = total_us ? (uint32_t)(((uint64_t)BENCH_FILE_SIZE * 1000000u / 1024u) / total_us) : 0u;
+    }
+}
+
+static void bench_random_seek(void)
+{
+    uint32_t rng = 0x12345678u;     // semilla fija: mismo patrón en cada corrida
+    uint64_t total_us = 0;
+    uint32_t max_us = 0;
+
+    for (uint32_t i = 0; i < BENCH_SEEKS; i++) {
+        UINT br;
+
+        rng ^= rng << 13; rng ^= rng >> 17; rng ^= rng << 5;
+        FSIZE_t pos = (FSIZE_t)(rng % (BENCH_FILE_SIZE / 512u)) * 512u;
+
+        uint32_t t0 = bench_now();
+        if (bench_fail(f_lseek(&g_fil, pos))) return;
+        if (bench_fail(f_read(&g_fil, g_buf, 512u, &br))) return;
+        uint32_t us = bench_elapsed_us(t0);
+
+        total_us += us;
+        if (us > max_us) max_us = us;
+    }
+
+    g_bench.seek_avg_us = (uint32_t)(total_us / BENCH_SEEKS);
+    g_bench.seek_max_us = max_us;
+}
+
+static uint32_t bench_dir_scan_once(void)
+{
+    static DIR dir;
+    static FILINFO fno;
+    uint32_t n = 0;
+
+    uint32_t t0 = bench_now();
+    if (bench_fail(f_opendir(&dir, BENCH_DIR))) return 0;
+    while (f_readdir(&dir, &fno) == FR_OK && fno.fname[0]) n++;
+    f_closedir(&dir);
+    uint32_t us = bench_elapsed_us(t0);
+
+    g_bench.dir_entries = n;
+    return us;
+}
+
+static void bench_dir_scan(void)
+{
+    diskcache_init();               // frío: todo el directorio sale de la tarjeta
+    g_bench.dir_cold_us = bench_dir_scan_once();
+    g_bench.dir_warm_us = bench_dir_scan_once();
+}
+
+static void bench_histogram(void)
+{
+    for (uint32_t pass = 0; pass < BENCH_HIST_PASSES; pass++) {
+        UINT br = 1;
+
+        if (bench_fail(f_lseek(&g_fil, 0))) return;
+
+        while (br) {
+            uint32_t t0 = bench_now();
+            if (bench_fail(f_read(&g_fil, g_buf, BENCH_HIST_CHUNK, &br))) return;
+            uint32_t us = bench_elapsed_us(t0);
+            if (!br) break;
+
+            uint32_t b = 0;
+            while (b < BENCH_HIST_BUCKETS - 1u && us >= (BENCH_HIST_BASE_US << b)) b++;
+            g_bench.hist[b]++;
+            if (us > g_bench.worst_us) g_bench.worst_us = us;
+        }
+    }
+}
+
+/*******************************************************************************
+ * REPORT
+ ******************************************************************************/
+static int bench_csv_header(char *out, size_t len)
+{
+    int n = snprintf(out, len, "status");
+    for (uint32_t c = 0; c < BENCH_CHUNKS; c++)
+        n += snprintf(out + n, len - (size_t)n, ",seq%lu_kbps,seq%lu_max_us",
+                      (unsigned long)k_chunks[c], (unsigned long)k_chunks[c]);
+    n += snprintf(out + n, len - (size_t)n, ",seek_avg_us,seek_max_us,dir_entries,dir_cold_us,dir_warm_us,worst_us");
+    for (uint32_t b = 0; b < BENCH_HIST_BUCKETS - 1u; b++)
+        n += snprintf(out + n, len - (size_t)n, ",lt%lu", (unsigned long)(BENCH_HIST_BASE_US << b));
+    n += snprintf(out + n, len - (size_t)n, ",ge%lu", (unsigned long)(BENCH_HIST_BASE_US << (BENCH_HIST_BUCKETS - 2u)));
+    n += snprintf(out + n, len - (size_t)n, "\n");
+    return n;
+}
+
+static int bench_csv_row(char *out, size_t len)
+{
+    int n = snprintf(out, len, "%d", (int)g_bench.status);
+    for (uint32_t c = 0; c < BENCH_CHUNKS; c++)
+        n += snprintf(out + n, len - (size_t)n, ",%lu,%lu",
+                      (unsigned long)g_bench.seq[c].kbps, (unsigned long)g_bench.seq[c].max_call_us);
+    n += snprintf(out + n, len - (size_t)n, ",%lu,%lu,%lu,%lu,%lu,%lu",
+                  (unsigned long)g_bench.seek_avg_us, (unsigned long)g_bench.seek_max_us,
+                  (unsigned long)g_bench.dir_entries, (unsigned long)g_bench.dir_cold_us,
+                  (unsigned long)g_bench.dir_warm_us, (unsigned long)g_bench.worst_us);
+    for (uint32_t b = 0; b < BENCH_HIST_BUCKETS; b++)
+        n += snprintf(out + n, len - (size_t)n, ",%lu", (unsigned long)g_bench.hist[b]);
+    n += snprintf(out + n, len - (size_t)n, "\n");
+    return n;
+}
+
+/*******************************************************************************
+ * ENTRY
+ ******************************************************************************/
+static void bench_run(void)
+{
+    memset((void *)&g_bench, 0, sizeof(g_bench));
+    bench_timer_init();
+
+    if (bench_fail(f_mount(&g_fs, "0:", 1))) return;
+    diskcache_set_window(g_fs.win);
+
+    if (bench_fail(bench_prepare_file())) return;
+    bench_sequential();
+    bench_random_seek();
+    bench_histogram();
+    f_close(&g_fil);
+
+    bench_dir_scan();
+}
+
+#ifdef HOST_BUILD
+
+int main(int argc, char **argv)
+{
+    static const diskio_image_model_t ideal = DISKIO_IMAGE_MODEL_IDEAL;
+    static const diskio_image_model_t sdhc  = DISKIO_IMAGE_MODEL_SDHC_1BIT_25MHZ;
+    static const diskio_image_model_t sdhc1 = DISKIO_IMAGE_MODEL_SDHC_1BIT_25MHZ_SINGLE;
+
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s card.img [ideal|sdhc|sdhc-single]\n", argv[0]);
+        return 2;
+    }
+    const char *model = (argc > 2) ? argv[2] : "sdhc";
+    bool use_ideal = (strcmp(model, "ideal") == 0);
+    g_wall_clock = use_ideal;
+    if (!diskio_image_open(argv[1], use_ideal ? &ideal :
+                           (strcmp(model, "sdhc-single") == 0) ? &sdhc1 : &sdhc)) {
+        fprintf(stderr, "cannot open %s\n", argv[1]);
+        return 1;
+    }
+
+    bench_run();
+
+    bench_csv_header(g_line, sizeof(g_line));
+    fputs(g_line, stdout);
+    bench_csv_row(g_line, sizeof(g_line));
+    fputs(g_line, stdout);
+
+    f_mount(NULL, "0:", 0);
+    diskio_image_close();
+    return (g_bench.status == FR_OK) ? 0 : 1;
+}
+
+#else
+
+void App_Init(void)
+{
+    sdhc_enable_clocks_and_pins();
+    sdhc_reset(SDHC_RESET_CMD);
+    sdhc_reset(SDHC_RESET_DATA);
+    __enable_irq();
+}
+
+void App_Run(void)
+{
+    static bool done = false;
+    if (done) return;
+    done = true;
+
+    bench_run();
+
+    // Una fila por corrida; el encabezado solo si el archivo es nuevo
+    FIL csv;
+    UINT bw;
+    if (f_open(&csv, BENCH_CSV, FA_OPEN_APPEND | FA_WRITE) == FR_OK) {
+        if (f_size(&csv) == 0) f_write(&csv, g_line, (UINT)bench_csv_header(g_line, sizeof(g_line)), &bw);
+        f_write(&csv, g_line, (UINT)bench_csv_row(g_line, sizeof(g_line)), &bw);
+        f_close(&csv);
+    }
+}
+
+#endif
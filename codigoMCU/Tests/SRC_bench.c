@@ -0,0 +1,153 @@
+/***************************************************************************/ /**
+   @file     SRC_bench.c
+   @brief    Resampler cost and quality for the compiled SRC_TAPS.
+   - cycles per output frame (stereo) for 48 / 44.1 / 32 kHz -> AUDIO_FS_HZ
+   - gain of a 1 kHz and an 8 kHz tone (passband)
+   - gain of a 14 kHz tone, above the output Nyquist (alias rejection)
+
+   On target it replaces App.c like the other tests (App_Init / App_Run);
+   results stay in g_src_bench for the debugger. Cycles come from
+   DWT->CYCCNT. To pick the tap count, build once per SRC_TAPS:
+
+     gcc -DHOST_BUILD -DSRC_TAPS=16 -I. -Isource source/Resampler.c \
+         Tests/SRC_bench.c -lm -o src_bench && ./src_bench
+
+   On the host it prints one CSV row per rate (ns instead of cycles; the
+   gains are the same as on the board).
+   @author   Grupo 3
+  ******************************************************************************/
+
+#ifdef HOST_BUILD
+#define _POSIX_C_SOURCE 200809L     // clock_gettime
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <math.h>
+#include "Resampler.h"
+
+#ifdef HOST_BUILD
+#include <time.h>
+#define SRC_BENCH_OUT_HZ    22050u
+#else
+#include "MK64F12.h"
+#include "Audio.h"
+#define SRC_BENCH_OUT_HZ    AUDIO_FS_HZ
+#endif
+
+#define SRC_BENCH_BLOCK     256u        // MP3_MIX_BLOCK en mp3_player.c
+#define SRC_BENCH_BLOCKS    64u
+#define SRC_BENCH_SETTLE    64u         // salidas descartadas (historia en cero)
+#define SRC_BENCH_AMPL      16000.0f
+
+#ifndef M_PI
+#define M_PI                3.14159265358979323846     // _POSIX_C_SOURCE lo oculta
+#endif
+
+typedef struct {
+    uint32_t in_hz;
+    uint32_t cyc_per_out;       // ns por salida en el host
+    int32_t  pass_1k_cdb;       // centésimas de dB
+    int32_t  pass_8k_cdb;
+    int32_t  reject_14k_cdb;
+} src_bench_t;
+
+static const uint32_t k_rates[] = { 48000u, 44100u, 32000u };
+#define SRC_BENCH_RATES     (sizeof(k_rates) / sizeof(k_rates[0]))
+
+volatile src_bench_t g_src_bench[SRC_BENCH_RATES];
+volatile bool g_src_bench_done;
+
+static uint32_t g_in[SRC_BENCH_BLOCK];     // L | R << 16, como el ring
+static uint32_t g_out[SRC_BENCH_BLOCK];
+
+static uint32_t bench_now(void)
+{
+#ifdef HOST_BUILD
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec);
+#else
+    return DWT->CYCCNT;
+#endif
+}
+
+// Ganancia (centésimas de dB) de un tono de tone_hz a la salida; *cyc: ciclos por frame.
+// R lleva el tono invertido: se mide (L - R) / 2.
+static int32_t bench_tone(uint32_t in_hz, float tone_hz, uint32_t *cyc)
+{
+    double acc = 0.0;
+    uint32_t outs = 0, counted = 0, spent = 0;
+    float w = 2.0f * (float)M_PI * tone_hz / (float)in_hz;
+    uint32_t t = 0;
+
+    (void)Resampler_Start(in_hz);
+    for (uint32_t b = 0; b < SRC_BENCH_BLOCKS; b++) {
+        for (uint32_t i = 0; i < SRC_BENCH_BLOCK; i++, t++) {
+            int16_t x = (int16_t)lrintf(SRC_BENCH_AMPL * sinf(w * (float)t));
+            g_in[i] = ((uint32_t)x & 0xFFFFu) | ((uint32_t)(uint16_t)(-x) << 16);
+        }
+        uint32_t t0 = bench_now();
+        uint32_t m = Resampler_Process(g_in, SRC_BENCH_BLOCK, g_out);
+        spent += bench_now() - t0;
+
+        for (uint32_t i = 0; i < m; i++, outs++) {
+            if (outs < SRC_BENCH_SETTLE) continue;
+            int16_t l = (int16_t)(g_out[i] & 0xFFFFu);
+            int16_t r = (int16_t)(g_out[i] >> 16);
+            double d = 0.5 * ((double)l - (double)r);      // si un canal se mezcla con el otro, baja
+            acc += d * d;
+            counted++;
+        }
+    }
+    if (cyc) *cyc = outs ? spent / outs : 0u;
+
+    double rms = sqrt(acc / (counted ? counted : 1u));
+    double ref = SRC_BENCH_AMPL / sqrt(2.0);
+    return (int32_t)lrint(2000.0 * log10(rms / ref + 1e-9));
+}
+
+static void bench_run(void)
+{
+    (void)Resampler_Init(SRC_BENCH_OUT_HZ);
+
+    for (uint32_t r = 0; r < SRC_BENCH_RATES; r++) {
+        src_bench_t res = { .in_hz = k_rates[r] };
+        res.pass_1k_cdb    = bench_tone(k_rates[r], 1000.0f, &res.cyc_per_out);
+        res.pass_8k_cdb    = bench_tone(k_rates[r], 8000.0f, NULL);
+        res.reject_14k_cdb = bench_tone(k_rates[r], 14000.0f, NULL);
+        g_src_bench[r] = res;
+    }
+    g_src_bench_done = true;
+}
+
+#ifdef HOST_BUILD
+
+int main(void)
+{
+    bench_run();
+    printf("taps,in_hz,ns_per_out,pass_1k_db,pass_8k_db,reject_14k_db\n");
+    for (uint32_t r = 0; r < SRC_BENCH_RATES; r++) {
+        const volatile src_bench_t *b = &g_src_bench[r];
+        printf("%u,%lu,%lu,%.2f,%.2f,%.2f\n", (unsigned)SRC_TAPS, (unsigned long)b->in_hz,
+               (unsigned long)b->cyc_per_out, b->pass_1k_cdb / 100.0,
+               b->pass_8k_cdb / 100.0, b->reject_14k_cdb / 100.0);
+    }
+    return 0;
+}
+
+#else
+
+void App_Init(void)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+void App_Run(void)
+{
+    if (!g_src_bench_done) bench_run();
+}
+
+#endif
@@ -0,0 +1,258 @@
+/***************************************************************************/ /**
+   @file     trace2json.c
+   @brief    Host tool: UART capture of the trace (Trace.h) to Chrome trace JSON.
+   - one timeline per task (context = priority) and per interrupt
+   - begin/end stages as B/E events, instants as i, time in microseconds
+   - per-context summary of each stage (count, avg, max) on stderr
+
+   Build the firmware with APP_TRACE_UART 1 in App.c, then on the PC:
+
+     gcc -O2 -Wall -o trace2json Tests/trace2json.c
+     stty -F /dev/ttyACM0 115200 raw -echo && cat /dev/ttyACM0 > cap.bin
+     ./trace2json cap.bin > trace.json      (open in ui.perfetto.dev)
+
+   Task names default to the priorities in App.c; -n PRIO=NAME renames one.
+   Anything between frames (boot text, a cut frame) is skipped.
+   @author   Grupo 3
+  ******************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TRACE_MAGIC         0x31435254u     // "TRC1", como en Trace.h
+#define TRACE_HDR_SIZE      16u
+#define TRACE_REC_SIZE      8u
+#define TRACE_MAX_RECORDS   1024u           // TRACE_RING_LEN: un frame nunca trae más
+#define TRACE_CTX_ISR       0x80u
+#define TRACE_CTX_NONE      0x7Fu
+
+#define NCTX                256u
+#define NEV                 64u
+
+// Mismo orden que trace_ev_t en Trace.h
+static const char *const k_event_names[] = {
+    "mark",
+    "decode",
+    "decode_loop",
+    "sd_read",
+    "audio_isr",
+    "audio_fill",
+};
+#define NEV_NAMED   (sizeof(k_event_names) / sizeof(k_event_names[0]))
+
+static const char *g_ctx_name[NCTX];
+
+typedef struct {
+    uint64_t begin;             // ciclos del B abierto (0: ninguno)
+    uint32_t count;
+    uint64_t total;
+    uint64_t max;
+} stage_t;
+
+static stage_t g_stage[NCTX][NEV];
+static bool    g_ctx_seen[NCTX];
+
+static uint32_t rd_u32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint16_t rd_u16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static void default_names(void)
+{
+    g_ctx_name[3] = "Main";
+    g_ctx_name[4] = "Display";
+    g_ctx_name[5] = "Audio";
+    g_ctx_name[6] = "SD";
+    g_ctx_name[7] = "LedMatrix";
+    g_ctx_name[8] = "Index";
+    g_ctx_name[9] = "Debug";
+    g_ctx_name[TRACE_CTX_NONE] = "boot";
+}
+
+static void ctx_label(uint8_t ctx, char *buf, size_t len)
+{
+    if (ctx & TRACE_CTX_ISR) {
+        unsigned exc = ctx & 0x7Fu;
+        if (exc == 15u) snprintf(buf, len, "ISR SysTick");
+        else if (exc >= 16u && exc < 32u) snprintf(buf, len, "ISR DMA%u", exc - 16u);
+        else if (exc >= 16u) snprintf(buf, len, "ISR IRQ%u", exc - 16u);
+        else snprintf(buf, len, "ISR exc%u", exc);
+    } else if (g_ctx_name[ctx]) {
+        snprintf(buf, len, "%s (prio %u)", g_ctx_name[ctx], ctx);
+    } else {
+        snprintf(buf, len, "prio %u", ctx);
+    }
+}
+
+static const char *ev_name(unsigned ev, char *buf, size_t len)
+{
+    if (ev < NEV_NAMED) return k_event_names[ev];
+    snprintf(buf, len, "ev%u", ev);
+    return buf;
+}
+
+static uint8_t *read_all(const char *path, size_t *len)
+{
+    FILE *f = strcmp(path, "-") ? fopen(path, "rb") : stdin;
+    if (!f) return NULL;
+
+    size_t cap = 1u << 16, n = 0;
+    uint8_t *buf = malloc(cap);
+    while (buf) {
+        if (n == cap) {
+            uint8_t *nb = realloc(buf, cap *= 2u);
+            if (!nb) { free(buf); buf = NULL; break; }
+            buf = nb;
+        }
+        size_t r = fread(&buf[n], 1, cap - n, f);
+        if (r == 0) break;
+        n += r;
+    }
+    if (f != stdin) fclose(f);
+    *len = n;
+    return buf;
+}
+
+int main(int argc, char **argv)
+{
+    const char *path = NULL;
+
+    default_names();
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+            char *eq = strchr(argv[++i], '=');
+            unsigned prio = (unsigned)strtoul(argv[i], NULL, 0);
+            if (!eq || prio >= TRACE_CTX_NONE) { fprintf(stderr, "bad -n %s\n", argv[i]); return 2; }
+            g_ctx_name[prio] = eq + 1;
+        } else {
+            path = argv[i];
+        }
+    }
+    if (!path) {
+        fprintf(stderr, "usage: %s [-n PRIO=NAME]... capture.bin|- > trace.json\n", argv[0]);
+        return 2;
+    }
+
+    size_t len = 0;
+    uint8_t *buf = read_all(path, &len);
+    if (!buf) { perror(path); return 1; }
+
+    uint64_t base = 0, t0 = 0;          // CYCCNT desenrollado a 64 bits; t0: primer record
+    uint32_t last = 0, dropped = 0, cpu_hz = 0;
+    unsigned long frames = 0, records = 0, skipped = 0;
+    bool first = true;
+    const char *sep = "";
+    char nb[32];
+
+    printf("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+
+    size_t pos = 0;
+    while (pos + TRACE_HDR_SIZE <= len) {
+        if (rd_u32(&buf[pos]) != TRACE_MAGIC) { pos++; skipped++; continue; }
+
+        const uint8_t *h = &buf[pos];
+        uint32_t count = rd_u16(&h[4]);
+        size_t flen = TRACE_HDR_SIZE + (size_t)count * TRACE_REC_SIZE;
+        if (count == 0u || count > TRACE_MAX_RECORDS || rd_u32(&h[12]) == 0u) { pos++; skipped++; continue; }
+        if (pos + flen > len) break;    // cortado al final de la captura
+
+        cpu_hz = rd_u32(&h[12]);
+        uint32_t d = rd_u32(&h[8]);
+        const uint8_t *r = &h[TRACE_HDR_SIZE];
+
+        for (uint32_t k = 0; k < count; k++, r += TRACE_REC_SIZE) {
+            uint32_t cyc = rd_u32(r);
+            unsigned ev  = r[4] & 0x3Fu;
+            unsigned ph  = r[4] >> 6;
+            uint8_t  ctx = r[5];
+            uint16_t arg = rd_u16(&r[6]);
+
+            // los records salen en orden: si el contador bajó, dio la vuelta (~36 s a 120 MHz)
+            if (!first && cyc < last) base += 1ull << 32;
+            uint64_t t = base + cyc;
+            if (first) { t0 = t; first = false; }
+            last = cyc;
+
+            double us = (double)(t - t0) * 1e6 / (double)cpu_hz;
+            const char *name = ev_name(ev, nb, sizeof(nb));
+            g_ctx_seen[ctx] = true;
+
+            if (ph == 1u) {
+                printf("%s{\"name\":\"%s\",\"ph\":\"B\",\"ts\":%.3f,\"pid\":1,\"tid\":%u,\"args\":{\"arg\":%u}}",
+                       sep, name, us, ctx, arg);
+                if (ev < NEV) g_stage[ctx][ev].begin = t + 1u;
+            } else if (ph == 2u) {
+                printf("%s{\"name\":\"%s\",\"ph\":\"E\",\"ts\":%.3f,\"pid\":1,\"tid\":%u,\"args\":{\"ret\":%u}}",
+                       sep, name, us, ctx, arg);
+                if (ev < NEV && g_stage[ctx][ev].begin) {
+                    stage_t *s = &g_stage[ctx][ev];
+                    uint64_t dt = t - (s->begin - 1u);
+                    s->count++;
+                    s->total += dt;
+                    if (dt > s->max) s->max = dt;
+                    s->begin = 0;
+                }
+            } else {
+                printf("%s{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":1,\"tid\":%u,\"args\":{\"arg\":%u}}",
+                       sep, name, us, ctx, arg);
+                if (ev < NEV) g_stage[ctx][ev].count++;
+            }
+            sep = ",\n";
+        }
+
+        // el ring se llenó antes de este frame: hueco en la traza
+        if (d != dropped) {
+            double us = first ? 0.0 : (double)(base + last - t0) * 1e6 / (double)cpu_hz;
+            printf("%s{\"name\":\"dropped %u\",\"ph\":\"i\",\"s\":\"g\",\"ts\":%.3f,\"pid\":1,\"tid\":0}",
+                   sep, d - dropped, us);
+            sep = ",\n";
+            dropped = d;
+        }
+
+        frames++;
+        records += count;
+        pos += flen;
+    }
+
+    // nombres de las líneas de tiempo: tareas primero, por prioridad
+    for (unsigned c = 0; c < NCTX; c++) {
+        if (!g_ctx_seen[c]) continue;
+        char label[48];
+        ctx_label((uint8_t)c, label, sizeof(label));
+        printf("%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+               sep, c, label);
+        printf(",\n{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"sort_index\":%u}}",
+               c, c);
+        sep = ",\n";
+    }
+    printf("%s{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"K64 @ %u Hz\"}}\n]}\n",
+           sep, cpu_hz);
+
+    fprintf(stderr, "%lu frames, %lu records, %u dropped on target, %lu bytes skipped\n",
+            frames, records, dropped, skipped);
+    if (cpu_hz) {
+        fprintf(stderr, "%-22s %-12s %8s %10s %10s\n", "context", "event", "count", "avg_us", "max_us");
+        for (unsigned c = 0; c < NCTX; c++) {
+            for (unsigned e = 0; e < NEV; e++) {
+                const stage_t *s = &g_stage[c][e];
+                if (!s->count) continue;
+                char label[48];
+                ctx_label((uint8_t)c, label, sizeof(label));
+                double k = 1e6 / (double)cpu_hz;
+                fprintf(stderr, "%-22s %-12s %8u %10.1f %10.1f\n", label, ev_name(e, nb, sizeof(nb)),
+                        s->count, s->total ? (double)s->total * k / s->count : 0.0, (double)s->max * k);
+            }
+        }
+    }
+
+    free(buf);
+    return 0;
+}
@@ -40,10 +40,17 @@
 #include "drivers/SDHC/sdhc.h"
 #include "drivers/FAT/ff.h"
 #include "drivers/FAT/diskio.h"
+#include "drivers/FAT/diskcache.h"
 
 //MP3
 #include "helix/pub/mp3dec.h"
 #include "mp3_player.h"
+#include "Trace.h"
+#include "TaskStats.h"
+#include "CritSect.h"
+#include "library.h"
+#include "browser.h"
+#include "Recorder.h"
 
 // AUDIO
 volatile bool PIT_trigger;
@@ -52,8 +59,8 @@ volatile bool DMA_trigger;
 //SD
 bool isPlaying = false;
 
-volatile uint16_t bufA[AUDIO_BUF_LEN];
-volatile uint16_t bufB[AUDIO_BUF_LEN];
+volatile uint16_t bufA[AUDIO_BUF_LEN * AUDIO_CHANNELS];     // L, R intercalados
+volatile uint16_t bufB[AUDIO_BUF_LEN * AUDIO_CHANNELS];
 
 volatile bool decode = true;
 
@@ -64,16 +71,8 @@ static volatile bool start_new_frame;
 static void PIT_cb(void);
 
 // FAT
-#ifndef MAX_LISTED_ENTRIES
-#define MAX_LISTED_ENTRIES 64
-#endif
-
-#ifndef MAX_NAME_LEN
-#define MAX_NAME_LEN 64    
-#endif
-
-#define MAX_TRACKS   64
-#define MAX_PATH_LEN 128
+#define MAX_PATH_LEN LIBRARY_PATH_LEN
+#define SCAN_STEP_ENTRIES   4u      // entradas de directorio por pasada del Index_Task
 
 
 /*******************************************************************************
@@ -85,12 +84,32 @@ static void PIT_cb(void);
 #define SD_TASK_PRIO                6u
 #define DISP_TASK_PRIO              4u
 #define LEDMATRIX_TASK_PRIO         7u
+#define INDEX_TASK_PRIO             8u      // debajo de todo: solo usa la SD cuando nadie más la pide
+#define DEBUG_TASK_PRIO             9u      // UART0 (stats o traza): después de todo lo demás
 
 #define MAIN_STK_SIZE               256u
 #define AUDIO_STK_SIZE              2048u
 #define SD_STK_SIZE                 1024u
 #define DISP_STK_SIZE               2048u
 #define LEDMATRIX_STK_SIZE          2048u
+#define INDEX_STK_SIZE              1024u
+#define DEBUG_STK_SIZE              512u
+
+#define SD_MOUNT_RETRY_MS           500u    // ticks de 1 ms entre intentos de f_mount
+#define APP_CROSSFADE_MS            0u      // fundido entre tracks; 0: gapless (discos en vivo, etc.)
+#define APP_FIXED_OUTPUT_HZ         0u      // AUDIO_FS_HZ: todo resampleado a 22.05 kHz; 0: cada track a la suya
+#define APP_STATS_PERIOD_MS         0u      // telemetría de audio y tabla de tareas por la consola de debug (UART0); 0: apagada
+#define APP_TRACE_UART              0u      // 1: la traza (Trace.h) sale por UART0 en binario; ver Tests/trace2json.c
+#define TRACE_DRAIN_PERIOD_MS       10u     // un frame de 64 records tarda ~46 ms a 115200
+#define APP_REC_MAX_S               600u    // grabación: lo que se preasigna (~26 MB a 22.05 kHz mono)
+#define APP_REC_SERVICE_MS          20u     // cada mitad del ring del ADC son ~185 ms
+#define APP_REC_PATH_FMT            "0:/REC%03u.WAV"
+#define APP_REC_FILES               1000u
+
+#if APP_TRACE_UART && (APP_STATS_PERIOD_MS > 0)
+#error "APP_TRACE_UART and APP_STATS_PERIOD_MS share UART0: enable only one"
+#endif
+#define APP_DEBUG_TASK              (APP_TRACE_UART || (APP_STATS_PERIOD_MS > 0))
 
 #define QUEUE_SIZE  10
 
@@ -98,6 +117,7 @@ typedef enum {
     APP_STATE_PLAYING = 0,
     APP_STATE_PAUSED,
     APP_STATE_SELECT_TRACK,
+    APP_STATE_RECORDING,
 } controlState_t;
 static controlState_t currentState = APP_STATE_SELECT_TRACK;
 static controlState_t SDState = APP_STATE_SELECT_TRACK;
@@ -111,6 +131,9 @@ typedef enum {
     APP_EVENT_ENC_BUTTON,
     APP_EVENT_NEXT_TRACK,
     APP_EVENT_PREV_TRACK,
+    APP_EVENT_JUMP_LETTER,
+    APP_EVENT_ENTER_DIR,
+    APP_EVENT_RECORD,
 } controlEvent_t ;
 static controlEvent_t currentEvent = APP_EVENT_NONE;
 static controlEvent_t SDEvent = APP_EVENT_NONE;
@@ -123,25 +146,34 @@ static CPU_STK AudioStk[AUDIO_STK_SIZE];
 static CPU_STK SdStk[SD_STK_SIZE];
 static CPU_STK DispStk[DISP_STK_SIZE];
 static CPU_STK LedStk[LEDMATRIX_STK_SIZE];
+static CPU_STK IndexStk[INDEX_STK_SIZE];
+#if APP_DEBUG_TASK
+static CPU_STK DebugStk[DEBUG_STK_SIZE];
+#endif
 
 static OS_TCB MainTCB;
 static OS_TCB AudioTCB;
 static OS_TCB SdTCB;
 static OS_TCB DispTCB;
 static OS_TCB LedTCB;
+static OS_TCB IndexTCB;
+#if APP_DEBUG_TASK
+static OS_TCB DebugTCB;
+#endif
 
 static OS_SEM DisplaySem;
 static OS_SEM LedFrameSem;
-static OS_SEM g_mp3ReadySem;       
+static OS_SEM g_mp3ReadySem;       // se postea cada vez que isPlaying pasa a true
 static OS_SEM g_AudioSem;         // indica que hay datos de audio listos
-
-char *filenames[MAX_TRACKS] = {"TALKTO~1.MP3"};
-static char filenames_storage[MAX_TRACKS][MAX_PATH_LEN];
-static uint32_t filenames_count = 0;
-static uint32_t filenamesIdx = 0;
+static OS_MUTEX LibMutex;         // library.c + browser.c (FatFs tiene su propio lock por volumen)
 
 static FATFS g_fs;
-static FIL   g_song;
+static FIL   g_song[2];               // el que suena y el siguiente (gapless)
+static bool  g_song_open[2];
+static bool  g_no_next = false;       // no hay más tracks en la carpeta: no volver a buscar
+static FIL   g_pre;                   // track que se está pasando al cache de arranque
+static uint8_t g_precache_todo = 0;   // vecinos del cursor (k_precache_at) que faltan revisar
+static char  g_rec_path[sizeof("0:/REC000.WAV")];
 
 /*******************************************************************************
  * FUNCTION PROTOTYPES FOR PRIVATE FUNCTIONS WITH FILE LEVEL SCOPE
@@ -160,9 +192,15 @@ static void Audio_Task(void *p_arg);
 static void Display_Task(void *p_arg);
 static void LedMatrix_Task(void *p_arg);
 static void SD_Task(void *p_arg);
+static void Index_Task(void *p_arg);
+#if APP_DEBUG_TASK
+static void Debug_Task(void *p_arg);
+#endif
 
 void App_Init(void)
 {
+    Trace_Init();
+
     // OS Task creation & init
     App_TaskCreate();
 }
@@ -182,6 +220,7 @@ static void App_TaskCreate(void)
                     &err);
     OSSemCreate(&g_mp3ReadySem, "mp3_ready", 0, &err);
     OSSemCreate(&g_AudioSem,"Audio semaphore", 0u, &err);
+    OSMutexCreate(&LibMutex, "Library mutex", &err);
 
     // Create tasks                
     OSTaskCreate(&MainTCB,
@@ -234,7 +273,7 @@ static void App_TaskCreate(void)
                  0u,
                  0u,
                  0u,
-				 OS_OPT_TASK_STK_CHK | OS_OPT_TASK_SAVE_FP,
+                 OS_OPT_TASK_STK_CHK,                   // FPU: el port guarda el contexto de cualquier tarea que lo use
                  &err);
     OSTaskCreate(&SdTCB,
                  "SD Task",
@@ -249,15 +288,158 @@ static void App_TaskCreate(void)
                  0u,
                  OS_OPT_TASK_STK_CHK,
                  &err);
+    OSTaskCreate(&IndexTCB,
+                 "Index Task",
+                 Index_Task,
+                 0,
+                 INDEX_TASK_PRIO,
+                 &IndexStk[0],
+                 INDEX_STK_SIZE / 10u,
+                 INDEX_STK_SIZE,
+                 0u,
+                 0u,
+                 0u,
+                 OS_OPT_TASK_STK_CHK,
+                 &err);
+#if APP_DEBUG_TASK
+    OSTaskCreate(&DebugTCB,
+                 "Debug Task",
+                 Debug_Task,
+                 0,
+                 DEBUG_TASK_PRIO,
+                 &DebugStk[0],
+                 DEBUG_STK_SIZE / 10u,
+                 DEBUG_STK_SIZE,
+                 0u,
+                 0u,
+                 0u,
+                 OS_OPT_TASK_STK_CHK,
+                 &err);
+#endif
+}
+
+static void lib_lock(void)
+{
+    OS_ERR err;
+    OSMutexPend(&LibMutex, 0u, OS_OPT_PEND_BLOCKING, 0u, &err);
+}
+
+static void lib_unlock(void)
+{
+    OS_ERR err;
+    OSMutexPost(&LibMutex, OS_OPT_POST_NONE, &err);
 }
 
 bool closeFile = false;
 bool changeTrack = false;
 
+static void songs_close(void)
+{
+    for (int i = 0; i < 2; i++) {
+        if (g_song_open[i]) f_close(&g_song[i]);
+        g_song_open[i] = false;
+    }
+}
+
+static void song_close(FIL *fp)
+{
+    int i = (int)(fp - g_song);
+    f_close(fp);
+    g_song_open[i] = false;
+}
+
+/*
+ * Abre el siguiente track de la carpeta en el slot libre y lo encola en el
+ * player. Se llama cuando el actual ya se leyó entero: queda el inbuf + el
+ * ring (~1 s) para abrirlo antes de que haga falta.
+ */
+static void song_queue_next(void)
+{
+    char path[MAX_PATH_LEN];
+    OS_ERR err;
+    int slot = g_song_open[0] ? 1 : 0;
+
+    if (g_song_open[slot]) return;
+
+    lib_lock();
+    bool have_path = Browser_NextTrack() && Browser_GetPath(path, sizeof(path));
+    lib_unlock();
+    if (!have_path) {
+        g_no_next = true;
+        return;
+    }
+    OSSemPost(&DisplaySem, OS_OPT_POST_1, &err);    // el cursor ya está en el siguiente
+
+    if (f_open(&g_song[slot], path, FA_READ) != FR_OK) return;     // se prueba con el próximo
+    g_song_open[slot] = true;
+    if (!MP3Player_QueueNext(&g_song[slot])) song_close(&g_song[slot]);
+}
+
+/*
+ * Cache de arranque: en los ratos libres de SELECT_TRACK se decodifica el
+ * principio del track del cursor (y de los vecinos que entren en
+ * MP3_CACHE_SLOTS), de a uno por vuelta para que los eventos se sigan
+ * atendiendo entre medio.
+ */
+static const int8_t k_precache_at[MP3_CACHE_SLOTS] = { 0 };
+
+static void song_precache_restart(void)
+{
+    g_precache_todo = (uint8_t)((1u << MP3_CACHE_SLOTS) - 1u);
+}
+
+static bool song_precache_step(void)
+{
+    char path[MAX_PATH_LEN];
+
+    if (!g_precache_todo) return false;
+
+    // primero se marcan los que ya están: el reemplazo cae en uno que ya no hace falta
+    for (uint32_t i = 0; i < MP3_CACHE_SLOTS; i++) {
+        if (!(g_precache_todo & (1u << i))) continue;
+        lib_lock();
+        bool have_path = Browser_GetPathAt(k_precache_at[i], path, sizeof(path));
+        lib_unlock();
+        if (!have_path || MP3Player_CacheTouch(MP3Player_CacheKey(path)))
+            g_precache_todo &= (uint8_t)~(1u << i);
+    }
+
+    for (uint32_t i = 0; i < MP3_CACHE_SLOTS; i++) {
+        if (!(g_precache_todo & (1u << i))) continue;
+        g_precache_todo &= (uint8_t)~(1u << i);     // un intento por posición del cursor
+        lib_lock();
+        bool have_path = Browser_GetPathAt(k_precache_at[i], path, sizeof(path));
+        lib_unlock();
+        if (have_path && f_open(&g_pre, path, FA_READ) == FR_OK) {
+            (void)MP3Player_Precache(&g_pre, MP3Player_CacheKey(path));
+            f_close(&g_pre);
+        }
+        return true;
+    }
+    return false;
+}
+
+/*
+ * Modo grabación (PLAY sostenido en el menú): ADC0 -> WAV en el primer
+ * REC###.WAV libre. Se corta con PLAY / el encoder o al llenarse lo preasignado.
+ */
+static bool rec_start(void)
+{
+    FILINFO fno;
+
+    for (uint32_t i = 0; i < APP_REC_FILES; i++) {
+        snprintf(g_rec_path, sizeof(g_rec_path), APP_REC_PATH_FMT, (unsigned)i);
+        if (f_stat(g_rec_path, &fno) == FR_NO_FILE)
+            return Recorder_Start(g_rec_path, APP_REC_MAX_S);
+    }
+    return false;
+}
+
 static void Main_Task(void *p_arg)
 {
     (void)p_arg;
     OS_ERR err;
+    const browser_entry_t *entry;
 
     // Drivers initialization
     init_LCD();
@@ -267,13 +449,19 @@ static void Main_Task(void *p_arg)
     write_LCD("Welcome!", 0);
     OSTimeDlyHMSM(0u, 0u, 1u, 500u, OS_OPT_TIME_HMSM_STRICT, &err);
     OSSemPost(&DisplaySem, OS_OPT_POST_1, &err);
-    gpioMode(PORTNUM2PIN(PC,11),OUTPUT);
 
     while (1)
     {
+        // getTurns()/getSwitchState() consumen el estado: se leen una sola vez
+        int16_t turns = getTurns();
+        encoder_btn_event_t sw = getSwitchState();
+        bool play_long = get_BTN_long(PLAY_BTN);
+
         /****** BUTTON EVENTS ***************/ 
         
-        if(get_BTN_state(PLAY_BTN))
+        if(play_long)
+            currentEvent = (currentState == APP_STATE_SELECT_TRACK) ? APP_EVENT_RECORD : APP_EVENT_NONE;
+        else if(get_BTN_state(PLAY_BTN))
             currentEvent = APP_EVENT_BTN_PRESSED;
         else if(get_BTN_state(NEXT_BTN))
             currentEvent = (currentState == APP_STATE_SELECT_TRACK) ? APP_EVENT_NEXT_TRACK : APP_EVENT_NONE;
@@ -281,14 +469,14 @@ static void Main_Task(void *p_arg)
             currentEvent = (currentState == APP_STATE_SELECT_TRACK) ? APP_EVENT_PREV_TRACK : APP_EVENT_NONE;
         /****************************************/ 
         /******** ENCODER EVENTS ****************/
-        else if(getTurns() > 0) 
+        else if(turns > 0) 
             currentEvent = APP_EVENT_ENC_RIGHT;
-        else if(getTurns() < 0) 
+        else if(turns < 0) 
             currentEvent = APP_EVENT_ENC_LEFT;
-        else if(getSwitchState() == BTN_CLICK) 
-            currentEvent = APP_EVENT_ENC_BUTTON;
-        else if(getSwitchState() == BTN_LONG_CLICK) 
+        else if(sw == BTN_CLICK) 
             currentEvent = APP_EVENT_ENC_BUTTON;
+        else if(sw == BTN_LONG_CLICK) 
+            currentEvent = (currentState == APP_STATE_SELECT_TRACK) ? APP_EVENT_JUMP_LETTER : APP_EVENT_ENC_BUTTON;
         /*****************************************/
 
         switch (currentState){
@@ -296,6 +484,15 @@ static void Main_Task(void *p_arg)
                 switch(currentEvent) {
                     case(APP_EVENT_ENC_BUTTON):
                     case(APP_EVENT_BTN_PRESSED):
+                        entry = Browser_Current();
+                        if (entry == NULL) break;
+                        if (entry->is_dir) {
+                            // carpeta (o ".."): se entra sin salir del menú
+                            SDState = APP_STATE_SELECT_TRACK;
+                            SDEvent = APP_EVENT_ENTER_DIR;
+                            currentEvent = APP_EVENT_NONE;
+                            break;
+                        }
                         displayState= APP_STATE_PLAYING;
                         SDState = APP_STATE_SELECT_TRACK;
                         currentState = APP_STATE_PLAYING;
@@ -308,25 +505,53 @@ static void Main_Task(void *p_arg)
                         break;
                     case(APP_EVENT_ENC_RIGHT):
                     case(APP_EVENT_NEXT_TRACK):
-                        filenamesIdx = (filenamesIdx + 1) % filenames_count;
-
                         displayState= APP_STATE_SELECT_TRACK;
                         SDState = APP_STATE_SELECT_TRACK;
 
-                        SDEvent = currentEvent;
+                        SDEvent = currentEvent;     // SD_Task mueve el cursor y refresca el display
                         currentEvent = APP_EVENT_NONE;
-                        
-                        OSSemPost(&DisplaySem, OS_OPT_POST_1, &err);
                         break;
                     case(APP_EVENT_ENC_LEFT):
                     case(APP_EVENT_PREV_TRACK):
-                        filenamesIdx = (filenamesIdx - 1 + filenames_count) % filenames_count;
+                        displayState= APP_STATE_SELECT_TRACK;
+                        SDState = APP_STATE_SELECT_TRACK;
 
+                        SDEvent = currentEvent;
+                        currentEvent = APP_EVENT_NONE;
+                        break;
+                    case(APP_EVENT_JUMP_LETTER):
+                        // long click: saltar a la próxima letra (lo resuelve SD_Task)
                         displayState= APP_STATE_SELECT_TRACK;
                         SDState = APP_STATE_SELECT_TRACK;
 
                         SDEvent = currentEvent;
+                        currentEvent = APP_EVENT_NONE;
+                        break;
+                    case(APP_EVENT_RECORD):
+                        // PLAY sostenido: grabar (SD_Task abre el archivo y atiende el ring)
+                        displayState = APP_STATE_RECORDING;
+                        SDState = APP_STATE_RECORDING;
+                        currentState = APP_STATE_RECORDING;
+
+                        SDEvent = currentEvent;
+                        currentEvent = APP_EVENT_NONE;
 
+                        OSSemPost(&DisplaySem, OS_OPT_POST_1, &err);
+                        break;
+                    default:
+                }
+        		break;
+
+        	case APP_STATE_RECORDING:
+                switch(currentEvent) {
+                    case(APP_EVENT_BTN_PRESSED):
+                    case(APP_EVENT_ENC_BUTTON):
+                        // cortar: SD_Task cierra el WAV al volver al menú
+                        SDState = APP_STATE_SELECT_TRACK;
+                        displayState = APP_STATE_SELECT_TRACK;
+                        currentState = APP_STATE_SELECT_TRACK;
+
+                        SDEvent = APP_EVENT_NONE;
                         currentEvent = APP_EVENT_NONE;
 
                         OSSemPost(&DisplaySem, OS_OPT_POST_1, &err);
@@ -352,7 +577,7 @@ static void Main_Task(void *p_arg)
                         break;
                     case(APP_EVENT_ENC_RIGHT):
                     case(APP_EVENT_ENC_LEFT):
-                        filenamesIdx = 0; // volver al primer track
+                        // volver al menú, con el cursor en el track que sonaba
                         isPlaying = false;
                         closeFile = true;
 
@@ -374,6 +599,7 @@ static void Main_Task(void *p_arg)
                     case(APP_EVENT_ENC_BUTTON):
                         DMA_SetEnableRequest(DMA_CH1, true);
                         isPlaying = true;
+                        OSSemPost(&g_mp3ReadySem, OS_OPT_POST_1, &err);
 
                         SDState = APP_STATE_PLAYING;
                         displayState = APP_STATE_PLAYING;
@@ -386,7 +612,6 @@ static void Main_Task(void *p_arg)
                         break;
                     case(APP_EVENT_ENC_RIGHT):
                     case(APP_EVENT_ENC_LEFT):
-                        filenamesIdx = 0; // volver al primer track
                         // ir a seleccion de track
                         isPlaying = false;
                         closeFile = true;
@@ -426,7 +651,12 @@ static void Audio_Task(void *p_arg)
                 Audio_Service();         
             }
             else
+            {
+                // sin audio no hay nada que hacer: se bloquea hasta que vuelva a sonar, así
+                // SD_Task (grabación), Index_Task y Debug_Task tienen CPU
                 DMA_SetEnableRequest(DMA_CH1, false);
+                OSSemPend(&g_mp3ReadySem, 0u, OS_OPT_PEND_BLOCKING, 0u, &err);
+            }
         }
 }
 
@@ -434,6 +664,7 @@ static void Display_Task(void *p_arg)
 {
     (void)p_arg;
     OS_ERR err;
+    static char line[LIBRARY_NAME_LEN + 1u];
 
     while (1) {
         // Display
@@ -451,9 +682,26 @@ static void Display_Task(void *p_arg)
                 clear_LCD();
                 write_LCD("Select Track", 0);
                 break;
+            case(APP_STATE_RECORDING):
+                clear_LCD();
+                write_LCD("Recording", 0);
+                break;
             default:
         }
-        write_LCD(filenames[filenamesIdx], 1);
+        const browser_entry_t *entry = Browser_Current();
+        if (displayState == APP_STATE_RECORDING) {
+            write_LCD(Recorder_IsRecording() ? &g_rec_path[3] : "", 1);    // sin el "0:/"
+        } else if (entry == NULL) {
+            write_LCD("Scanning...", 1);
+        } else {
+            // título ID3 si el track está indexado, si no el nombre; carpetas con '/' al final
+            const char *label = entry->title[0] ? entry->title : entry->name;
+            size_t n = strlen(label);
+            memcpy(line, label, n);
+            if (entry->is_dir) line[n++] = '/';
+            line[n] = '\0';
+            write_LCD(line, 1);
+        }
         OSTimeDlyHMSM(0u, 0u, 0u, 50u, OS_OPT_TIME_HMSM_STRICT, &err);
     }
 }
@@ -477,7 +725,7 @@ static void LedMatrix_Task(void *p_arg)
     	OSSemPend(&LedFrameSem, 0u, OS_OPT_PEND_BLOCKING, 0u, &err);
 		LEDM_SetBrightness(matrix, 2);
         MP3Player_GetLastPCMwindow(frame, FFT_N);
-		FFT_ComputeBands(frame, FFT_N, AUDIO_FS_HZ, bands);
+		FFT_ComputeBands(frame, FFT_N, Audio_GetSampleRateHz(), bands);
 		Visualizer_DrawBars(bands, matrix);
 		ok = LEDM_Show(matrix);
 
@@ -502,59 +750,31 @@ static void SD_Task(void *p_arg)
     sdhc_reset(SDHC_RESET_DATA);
     __enable_irq();
 
-    // 2) Montar FS
-    FRESULT fr = f_mount(&g_fs, "0:", 1);
-    if (fr != FR_OK) {
-        while (1) OSTimeDly(10u, OS_OPT_TIME_DLY, &err);
-    }
-
-    DIR dir;
-    FILINFO fno;
-
-    filenames_count = 0;
-
-    #if FF_USE_LFN
-        static char lfn[128];
-        fno.lfname = lfn;
-        fno.lfsize = sizeof(lfn);
-    #endif
-
-    filenames_count = 0;
-
-    fr = f_opendir(&dir, "0:/");
-    if (fr != FR_OK) return fr;
-
-    for (;;) {
-        fr = f_readdir(&dir, &fno);
-        if (fr != FR_OK) break;
-        if (fno.fname[0] == 0) break;          
-
-        if (fno.fattrib & AM_DIR) continue;    
-
-        const char *name =
-        #if FF_USE_LFN
-            (fno.lfname && fno.lfname[0]) ? fno.lfname : fno.fname;
-        #else
-            fno.fname;
-        #endif
-
-        if (!is_mp3_file(name)) continue;   // descartar no-mp3
-        // Guardar mientras haya espacio
-        if (filenames_count < MAX_TRACKS) {
-            // Guardar path completo en storage fijo
-            char *dst = filenames_storage[filenames_count];
-            dst[0] = '\0';
-            strcpy(dst, "0:/");
-            strncat(dst, name, MAX_PATH_LEN - strlen(dst) - 1);
-
-            filenames[filenames_count] = filenames_storage[filenames_count];
-            filenames_count++;
+    // 2) Montar FS: sin tarjeta (o con una que no inicializa) se reintenta
+    // 3) Biblioteca: se carga el índice de la SD; si no hay, lo arma Index_Task.
+    //    Si el root no se puede abrir se desmonta y se vuelve a empezar.
+    FRESULT fr;
+    while (1) {
+        while ((fr = f_mount(&g_fs, "0:", 1)) != FR_OK) {
+            OSTimeDly(SD_MOUNT_RETRY_MS, OS_OPT_TIME_DLY, &err);
         }
-        else 
+        diskcache_set_window(g_fs.win);     // FAT y directorios pasan por el cache
+
+        lib_lock();
+        (void)Library_Init("0:/");
+        bool browsing = Browser_Init();
+        lib_unlock();
+        if (browsing)
             break;
-    }
 
-    f_closedir(&dir);
+        f_unmount("0:");
+        OSTimeDly(SD_MOUNT_RETRY_MS, OS_OPT_TIME_DLY, &err);
+    }
+    MP3Player_SetCrossfadeMs(APP_CROSSFADE_MS);
+    MP3Player_SetOutputRate(APP_FIXED_OUTPUT_HZ);
+    OSTaskSemPost(&IndexTCB, OS_OPT_POST_NONE, &err);
+    OSSemPost(&DisplaySem, OS_OPT_POST_1, &err);
+    song_precache_restart();
 
     OS_MSG_SIZE size;
 
@@ -563,49 +783,169 @@ static void SD_Task(void *p_arg)
         switch(SDState) {
             case(APP_STATE_PLAYING):
 
-                gpioWrite(PORTNUM2PIN(PC,11),HIGH);
+                TRACE_BEGIN(TRACE_EV_DECODE_LOOP, 0);
                 bool ok = MP3Player_DecodeAsMuchAsPossibleToRing();
-                gpioWrite(PORTNUM2PIN(PC,11),LOW);
+                TRACE_END(TRACE_EV_DECODE_LOOP, ok);
+
+                // cambio gapless: el anterior ya no se lee
+                FIL *finished = MP3Player_TakeFinished();
+                if (finished) song_close(finished);
+                if (!g_no_next && MP3Player_WantsNext()) song_queue_next();
+
                 if (!ok)
                     // reintento corto, no 5 ticks
                     OSTimeDly(1u, OS_OPT_TIME_DLY, &err);
-                else if(closeFile)
-                {
-                    f_close(&g_song);
-                    pcm_ring_clear();
-                }
                 else
                 {
                     if (pcm_ring_free() == 0)
+                        // ring lleno: el tick libre lo aprovecha Index_Task
                         OSTimeDly(1u, OS_OPT_TIME_DLY, &err);
                     else 
                         OSTimeDly(0u, OS_OPT_TIME_DLY, &err); // yield
                 }
                 break;
+            case(APP_STATE_RECORDING):
+                if (SDEvent == APP_EVENT_RECORD) {
+                    SDEvent = APP_EVENT_NONE;
+                    songs_close();
+                    closeFile = false;
+                    if (!rec_start()) {
+                        // sin lugar contiguo para APP_REC_MAX_S (f_expand) o sin nombres libres
+                        SDState = currentState = displayState = APP_STATE_SELECT_TRACK;
+                        OSSemPost(&DisplaySem, OS_OPT_POST_1, &err);
+                        break;
+                    }
+                    OSSemPost(&DisplaySem, OS_OPT_POST_1, &err);     // nombre del archivo
+                }
+                if (!Recorder_Service()) {
+                    // lleno o error de escritura
+                    (void)Recorder_Stop();
+                    SDState = currentState = displayState = APP_STATE_SELECT_TRACK;
+                    OSSemPost(&DisplaySem, OS_OPT_POST_1, &err);
+                    break;
+                }
+                OSTimeDly(APP_REC_SERVICE_MS, OS_OPT_TIME_DLY, &err);
+                break;
             case(APP_STATE_SELECT_TRACK):
+                if (Recorder_IsRecording()) {
+                    // se cortó desde Main_Task
+                    (void)Recorder_Stop();
+                    song_precache_restart();
+                }
+                if (closeFile) {
+                    // se salió de la reproducción: el actual y el encolado
+                    songs_close();
+                    closeFile = false;
+                    song_precache_restart();
+                }
                 if(SDEvent == APP_EVENT_ENC_BUTTON || SDEvent == APP_EVENT_BTN_PRESSED || changeTrack)
                 {
+                    char path[MAX_PATH_LEN];
                     changeTrack = false;
-                    fr = f_open(&g_song, filenames[filenamesIdx], FA_READ);
-                    if (fr != FR_OK) 
-                        while (1) OSTimeDly(10u, OS_OPT_TIME_DLY, &err);
-                    if (!MP3Player_InitWithOpenFile(&g_song))
-                        while (1) OSTimeDly(10u, OS_OPT_TIME_DLY, &err);
+                    lib_lock();
+                    bool have_path = Browser_GetPath(path, sizeof(path));
+                    lib_unlock();
+                    if (!have_path)
+                        break;
+                    // sd.c ya reintentó: si igual falla, se saltea el tema y se sigue navegando
+                    songs_close();
+                    g_no_next = false;
+                    bool cached = false;
+                    fr = f_open(&g_song[0], path, FA_READ);
+                    if (fr == FR_OK) {
+                        g_song_open[0] = true;
+                        // en el cache: el ring ya arranca con MP3_CACHE_MS de audio
+                        cached = MP3Player_StartFromCache(&g_song[0], MP3Player_CacheKey(path));
+                        if (!cached && !MP3Player_InitWithOpenFile(&g_song[0])) {
+                            songs_close();
+                            fr = FR_INT_ERR;
+                        }
+                    }
+                    if (fr != FR_OK) {
+                        currentState = displayState = APP_STATE_SELECT_TRACK;
+                        SDEvent = APP_EVENT_NONE;
+                        OSSemPost(&DisplaySem, OS_OPT_POST_1, &err);
+                        break;
+                    }
                     // pcm_ring_clear();
                     DMA_SetEnableRequest(DMA_CH1, true);
                     isPlaying = true;
 
                     OSSemPost(&g_mp3ReadySem, OS_OPT_POST_1, &err);
-                    OSTimeDlyHMSM(0u, 0u, 0u, 50u, OS_OPT_TIME_HMSM_STRICT, &err);
+                    if (!cached)
+                        OSTimeDlyHMSM(0u, 0u, 0u, 50u, OS_OPT_TIME_HMSM_STRICT, &err);
                     SDState = APP_STATE_PLAYING;
                     SDEvent = APP_EVENT_NONE;
                 }
+                else if (SDEvent != APP_EVENT_NONE)
+                {
+                    // navegación: los directorios se leen recién cuando se entra
+                    lib_lock();
+                    switch (SDEvent) {
+                        case(APP_EVENT_ENC_RIGHT):
+                        case(APP_EVENT_NEXT_TRACK):
+                            (void)Browser_Next();
+                            break;
+                        case(APP_EVENT_ENC_LEFT):
+                        case(APP_EVENT_PREV_TRACK):
+                            (void)Browser_Prev();
+                            break;
+                        case(APP_EVENT_JUMP_LETTER):
+                            (void)Browser_JumpLetter();
+                            break;
+                        case(APP_EVENT_ENTER_DIR):
+                            (void)Browser_Enter();
+                            break;
+                        default:
+                            break;
+                    }
+                    lib_unlock();
+                    SDEvent = APP_EVENT_NONE;
+                    song_precache_restart();
+                    OSSemPost(&DisplaySem, OS_OPT_POST_1, &err);
+                }
+                else if (!song_precache_step())
+                    OSTimeDly(1u, OS_OPT_TIME_DLY, &err);
                 break;
         }
         
     }
 }
 
+/*
+ * Indexador en background: avanza el scanner de la biblioteca de a pocas
+ * entradas. Cada llamada a FatFs toma el volumen por separado, así que el
+ * SD_Task (más prioritario, y con herencia de prioridad en el mutex) sigue
+ * leyendo el MP3 entre medio. LibMutex solo protege el estado de library/browser.
+ */
+static void Index_Task(void *p_arg)
+{
+    (void)p_arg;
+    OS_ERR err;
+
+    // espera a que SD_Task monte la SD e inicialice la biblioteca
+    OSTaskSemPend(0u, OS_OPT_PEND_BLOCKING, 0u, &err);
+
+    while (1)
+    {
+        lib_lock();
+        bool replaced = Library_ScanStep(SCAN_STEP_ENTRIES);
+        bool scanning = Library_IsScanning();
+        if (replaced)
+            Browser_Refresh();
+        lib_unlock();
+
+        if (replaced)
+            OSSemPost(&DisplaySem, OS_OPT_POST_1, &err);   // refrescar nombre
+
+        if (scanning)
+            OSTimeDly(1u, OS_OPT_TIME_DLY, &err);
+        else
+            // índice al día: hasta que alguien pida otro rescan
+            OSTaskSemPend(0u, OS_OPT_PEND_BLOCKING, 0u, &err);
+    }
+}
+
 /********************************
  *      PIT CALLBACKS
  ********************************/
@@ -648,4 +988,41 @@ int main(void)
     while (1);
 }
 
+#if APP_DEBUG_TASK
+/*
+ * Salida de depuración por UART0 (OpenSDA):
+ * - APP_STATS_PERIOD_MS: telemetría de audio (short fills, nivel del ring,
+ *   latencia del ISR del DMA, tiempo de decode por frame) y por tarea (CPU%,
+ *   cambios de contexto, IRQ apagadas, scheduler bloqueado, stack usado) y
+ *   peor tiempo de cada sección crítica (CritSect.h) en texto, 115200 8N1
+ * - APP_TRACE_UART: la traza en binario por DMA, para Tests/trace2json.c
+ */
+static void Debug_Task(void *p_arg)
+{
+    (void)p_arg;
+    OS_ERR err;
+
+    TaskStats_Init();                       // arranca la tarea de estadística del OS
 
+#if APP_TRACE_UART
+    Trace_StartDrain(TRACE_UART_BAUD);
+    while (1)
+    {
+        OSTimeDly(TRACE_DRAIN_PERIOD_MS, OS_OPT_TIME_DLY, &err);
+        Trace_Service();
+    }
+#else
+    PORTB->PCR[16] = PORT_PCR_MUX(3);       // UART0_RX
+    PORTB->PCR[17] = PORT_PCR_MUX(3);       // UART0_TX
+    BOARD_InitDebugConsole();
+
+    while (1)
+    {
+        OSTimeDly(APP_STATS_PERIOD_MS, OS_OPT_TIME_DLY, &err);
+        Audio_PrintStats();
+        TaskStats_Print();
+        CritSect_Print();
+    }
+#endif
+}
+#endif
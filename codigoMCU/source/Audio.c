@@ -4,10 +4,12 @@
  *
  * This file contains the implementation of the audio streaming logic:
  * - PIT configuration for sample-rate timing
- * - DAC initialization
- * - DMA configuration for transferring samples to the DAC
+ * - DAC0/DAC1 initialization
+ * - DMA configuration for transferring L/R frames to both DACs
  * - Ping-pong buffer swap on DMA major-loop completion
  * - Background buffer refilling via ::Audio_Service()
+ * - Per-buffer sample rate: PIT1 is retimed to the rate of each track
+ * - Underrun / refill-deadline / DMA ISR latency telemetry
  * @author   Grupo 3
   	  	  	  - Ezequiel Díaz Guzmán
   	  	  	  - José Iván Hertter
@@ -20,10 +22,14 @@
 #include <math.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <string.h>
 #include "mp3_player.h"
 #include "drivers/gpio.h"
 #include "os.h"
 #include "equalizer.h"
+#include "fsl_debug_console.h"
+#include "Trace.h"
+#include "CritSect.h"
 #include <arm_math.h>
 
 // Internal states
@@ -36,8 +42,26 @@ static volatile bool g_need_fill_B = false;
 
 static volatile uint32_t got = AUDIO_BUF_LEN;
 
+// Frecuencia de cada buffer (la del track del que salieron sus samples);
+// el PIT se reprograma cuando el DMA pasa a ese buffer
+#define PIT_CLK_HZ      ((uint32_t)PIT_FREQ)
+
+static volatile uint32_t g_buf_fs[2] = { AUDIO_FS_HZ, AUDIO_FS_HZ };   // bufA, bufB
+static volatile uint32_t g_play_fs = AUDIO_FS_HZ;
+static uint32_t g_eq_fs = AUDIO_FS_HZ;
+
+// PIT_CLK_HZ / fs casi nunca es entero: cada buffer usa q o q+1 ticks por
+// sample, q+1 en r de cada fs buffers (acumulador fraccional)
+static uint32_t g_pit_q, g_pit_r, g_pit_acc;
+
+// Telemetría: la escriben el callback del DMA (latencia) y Audio_Service (el resto)
+#define PIT_TICKS_TO_NS(t)  ((uint32_t)(((uint64_t)(t) * 1000000000u) / PIT_CLK_HZ))
+
+static audio_stats_t g_stats = { .level_min = UINT32_MAX };
+
 static inline int16_t sat_i16(float32_t x);
 static void EQ_ProcessDacU16Buffer(volatile uint16_t *dst, uint32_t n);
+static void Audio_RetimePIT(uint32_t fs);
 
 
 //static float g_phase = 0.0f;
@@ -59,12 +83,19 @@ extern OS_SEM g_AudioSem;
 static void AudioDMA_cb(void){
     OS_ERR err;
 
-    // gpioWrite(PORTNUM2PIN(PC,11), HIGH);
-
     OSIntEnter();
 
+    // desde el request que terminó el major loop; si ya llegó el siguiente, CITER avanzó
+    uint32_t lat = PIT_GetElapsed(PIT_1);
+    bool late = (DMA_GetCurrMajorLoopCount(DMA_CH1) != AUDIO_BUF_LEN);
+    TRACE_INSTANT(TRACE_EV_AUDIO_ISR, lat);
+
     DMA_SetEnableRequest(DMA_CH1, false);          // clear ERQ for that channel
 	DMA_ClearChannelIntFlag(DMA_CH1);
+
+    g_stats.isr_latency_ns = PIT_TICKS_TO_NS(lat);
+    if (g_stats.isr_latency_ns > g_stats.isr_latency_ns_max) g_stats.isr_latency_ns_max = g_stats.isr_latency_ns;
+    if (late) g_stats.isr_late++;
     
     volatile uint16_t *just_finished = g_playing;
     volatile uint16_t *next = (g_playing == bufA) ? bufB : bufA;
@@ -77,6 +108,7 @@ static void AudioDMA_cb(void){
     OSSemPost(&g_AudioSem, OS_OPT_POST_1, &err);
     
     DMA_SetSourceAddr(DMA_CH1, (uint32_t)next);		// Change DMA source to the next buffer and restart major loop
+    Audio_RetimePIT(g_buf_fs[(next == bufA) ? 0 : 1]);
     
     // if(got == 0){
     DMA_SetCurrMajorLoopCount(DMA_CH1, AUDIO_BUF_LEN);	    // Reset loop counts for the new major loop
@@ -90,8 +122,6 @@ static void AudioDMA_cb(void){
     DMA_SetEnableRequest(DMA_CH1, true);
     
     OSIntExit();
-    
-    // gpioWrite(PORTNUM2PIN(PC,11), LOW); 
 }
 
 /**
@@ -106,6 +136,31 @@ static void AudioDMA_cb(void){
 static void PIT_cb(void){
 }
 
+/**
+ * @brief Sets PIT1 for the buffer that the DMA just started playing.
+ *
+ * Called once per buffer from the DMA callback. The new LDVAL is loaded by
+ * the PIT at its next timeout, so it applies from the second sample of the
+ * buffer on.
+ */
+static void Audio_RetimePIT(uint32_t fs)
+{
+    if (fs != g_play_fs) {
+        g_play_fs = fs;
+        g_pit_q   = PIT_CLK_HZ / fs;
+        g_pit_r   = PIT_CLK_HZ % fs;
+        g_pit_acc = 0;
+    }
+
+    uint32_t ticks = g_pit_q;
+    g_pit_acc += g_pit_r;
+    if (g_pit_acc >= g_play_fs) {
+        g_pit_acc -= g_play_fs;
+        ticks++;
+    }
+    PIT_SetLoadValue(PIT_1, ticks - 1u);
+}
+
 /**
  * @brief Initializes the audio output subsystem.
  *
@@ -118,12 +173,17 @@ static void PIT_cb(void){
  */
 void Audio_Init()
 {
-    PIT_Init(PIT_1, AUDIO_FS_HZ);	// PIT 1 for audio sample rate timing
+    PIT_Init(PIT_1, AUDIO_FS_HZ);	// PIT 1 for audio sample rate timing (retimed per track)
+    g_pit_q = PIT_CLK_HZ / AUDIO_FS_HZ;
+    g_pit_r = PIT_CLK_HZ % AUDIO_FS_HZ;
+    g_pit_acc = 0;
     PIT_DisableInterrupt(PIT_1);		// i don't really need the pit irq
     // PIT_SetCallback(PIT_cb, PIT_1);
 
-    DAC_Init(DAC0);
+    DAC_Init(DAC0);             // L
+    DAC_Init(DAC1);             // R
     DAC_SetData(DAC0, DAC_MID); // midscale
+    DAC_SetData(DAC1, DAC_MID);
 
     // Pre-fill both buffers before starting DMA
 	// Audio_FillSine(bufA, AUDIO_BUF_LEN);
@@ -138,24 +198,28 @@ void Audio_Init()
 
     DMAMUX_ConfigChannel(DMA_CH1, true, true, kDmaRequestMux0AlwaysOn58);     // PIT --> DMAMUX --> DMA
 
-    // TCD setup: audio_buffer -> DAC0 DAT0
+    // TCD setup: audio_buffer -> DAC0 DAT0, DAC1 DAT0 (un frame por request del PIT)
     DMA_SetSourceAddr(DMA_CH1, (uint32_t)(bufA));   // dirección de la fuente de datos
-    DMA_SetDestAddr(DMA_CH1, (uint32_t)&DAC0->DAT[0]);     // dirección de destino (FTM0 CnV)
+    DMA_SetDestAddr(DMA_CH1, (uint32_t)&DAC0->DAT[0]);     // dirección de destino (L)
 
-    DMA_SetSourceAddrOffset(DMA_CH1, 2); // cuanto se mueve la dirección de origen después de cada minor loop
-    DMA_SetDestAddrOffset(DMA_CH1, 0);   // always write same DAC register
+    DMA_SetSourceAddrOffset(DMA_CH1, 2); // cuanto se mueve la dirección de origen después de cada escritura
+    DMA_SetDestAddrOffset(DMA_CH1, (int32_t)((uint32_t)&DAC1->DAT[0] - (uint32_t)&DAC0->DAT[0]));   // L -> R
 
     DMA_SetSourceTransfSize(DMA_CH1, DMA_TransSize_16Bit);
     DMA_SetDestTransfSize(DMA_CH1, DMA_TransSize_16Bit);
 
-    // DMA_SetMinorLoopTransCount(DMA_CH1, 2); // 1 sample = 2 bytes
+    // minor loop = 1 frame (L, R); al terminarlo DADDR vuelve de DAC1 + DOFF a DAC0
+    DMA_SetMinorLoopDestOffset(DMA_CH1, 2u * AUDIO_CHANNELS,
+                               -(int32_t)AUDIO_CHANNELS * ((int32_t)((uint32_t)&DAC1->DAT[0] - (uint32_t)&DAC0->DAT[0])));
 
     // Major loop counts: set once
 	DMA_SetStartMajorLoopCount(DMA_CH1, AUDIO_BUF_LEN);
 	DMA_SetCurrMajorLoopCount (DMA_CH1, AUDIO_BUF_LEN);
 
-    // Destination does not move
-    DMA_SetDestLastAddrOffset(DMA_CH1, 0);
+    // En el último minor loop el eDMA aplica DLAST en vez de MLOFF: tiene que valer lo mismo
+    // para que DADDR vuelva a DAC0 también al cerrar cada buffer
+    DMA_SetDestLastAddrOffset(DMA_CH1,
+                              -(int32_t)AUDIO_CHANNELS * ((int32_t)((uint32_t)&DAC1->DAT[0] - (uint32_t)&DAC0->DAT[0])));
 
     // Major-loop interrupt (buffer boundary)
     DMA_SetChannelInterrupt(DMA_CH1, true, AudioDMA_cb);
@@ -191,27 +255,100 @@ static inline uint16_t pcm16_to_dac(int16_t s)
 void Audio_Service(void)
 {
     volatile uint16_t *dst = NULL;
+    CRIT_ALLOC();
     
-    __disable_irq();
+    CRIT_ENTER(CRIT_AUDIO_SERVICE);
+    // los dos pendientes: el DMA ya está repitiendo uno que no se llegó a llenar
+    if (g_need_fill_A && g_need_fill_B) g_stats.stale_buffers++;
     if (g_need_fill_A) { g_need_fill_A = false; dst = bufA; }
     else if (g_need_fill_B) { g_need_fill_B = false; dst = bufB; }
-    __enable_irq();
+    CRIT_EXIT(CRIT_AUDIO_SERVICE);
 
     if (!dst) return;
-//    gpioWrite(PORTNUM2PIN(PC,11), HIGH);
-//    if (pcm_ring_level() > AUDIO_BUF_LEN) {
-    got = pcm_ring_pop_block(dst, AUDIO_BUF_LEN);
 
-//    }
-//    gpioWrite(PORTNUM2PIN(PC,11), LOW);
+    TRACE_BEGIN(TRACE_EV_AUDIO_FILL, 0);
+    uint32_t level = pcm_ring_level();
+    if (level < g_stats.level_min) g_stats.level_min = level;
+    if (level > g_stats.level_max) g_stats.level_max = level;
+    uint32_t bin = (level * AUDIO_LEVEL_BINS) / PCM_RING_SIZE;
+    g_stats.level_hist[(bin < AUDIO_LEVEL_BINS) ? bin : (AUDIO_LEVEL_BINS - 1u)]++;
+
+    // un buffer no mezcla frecuencias: si el próximo track cambia, el resto va en silencio
+    uint32_t span;
+    uint32_t fs = pcm_ring_rate(&span);
+    uint32_t want = (span < AUDIO_BUF_LEN) ? span : AUDIO_BUF_LEN;
+    g_buf_fs[(dst == bufA) ? 0 : 1] = fs;
+    if (fs != g_eq_fs) {
+        setEqualizerSampleRate(fs);
+        g_eq_fs = fs;
+    }
+
+    got = pcm_ring_pop_block(dst, want);
 
     if (got > 0) {
         EQ_ProcessDacU16Buffer(dst, got);
     }
+
+    g_stats.fills++;
+    if (got < AUDIO_BUF_LEN) {
+        g_stats.short_fills++;
+        g_stats.padded_frames += AUDIO_BUF_LEN - got;
+        if (got == want) g_stats.rate_splits++;
+    }
     
-    for (uint32_t i = got; i < AUDIO_BUF_LEN; i++) {
+    for (uint32_t i = got * AUDIO_CHANNELS; i < AUDIO_BUF_LEN * AUDIO_CHANNELS; i++) {
             dst[i] = (uint16_t)DAC_MID;
 	}
+    TRACE_END(TRACE_EV_AUDIO_FILL, got);
+}
+
+uint32_t Audio_GetSampleRateHz(void)
+{
+    return g_play_fs;
+}
+
+void Audio_GetStats(audio_stats_t *st)
+{
+    if (!st) return;
+    CRIT_ALLOC();
+    CRIT_ENTER(CRIT_AUDIO_STATS);
+    *st = g_stats;
+    CRIT_EXIT(CRIT_AUDIO_STATS);
+    if (st->fills == 0u) st->level_min = 0;
+}
+
+void Audio_ResetStats(void)
+{
+    CRIT_ALLOC();
+    CRIT_ENTER(CRIT_AUDIO_STATS);
+    memset(&g_stats, 0, sizeof(g_stats));
+    g_stats.level_min = UINT32_MAX;
+    CRIT_EXIT(CRIT_AUDIO_STATS);
+    MP3Player_ResetDecodeStats();
+}
+
+void Audio_PrintStats(void)
+{
+    audio_stats_t a;
+    mp3_decode_stats_t d;
+    mp3_mix_stats_t m;
+
+    Audio_GetStats(&a);
+    MP3Player_GetDecodeStats(&d);
+    MP3Player_GetMixStats(&m);
+
+    PRINTF("audio: fs=%u fills=%u short=%u (rate=%u) padded=%u stale=%u\r\n",
+           g_play_fs, a.fills, a.short_fills, a.rate_splits, a.padded_frames, a.stale_buffers);
+    PRINTF("ring: min=%u max=%u of %u, hist", a.level_min, a.level_max, PCM_RING_SIZE);
+    for (uint32_t i = 0; i < AUDIO_LEVEL_BINS; i++) PRINTF(" %u", a.level_hist[i]);
+    PRINTF("\r\n");
+    PRINTF("dma isr: last=%uns max=%uns late=%u\r\n",
+           a.isr_latency_ns, a.isr_latency_ns_max, a.isr_late);
+    PRINTF("decode: frames=%u avg=%u max=%u budget=%u cyc, worst=%u%% over=%u\r\n",
+           d.frames, d.cyc_avg, d.cyc_max, d.budget_cyc, d.load_pct_max, d.over_budget);
+    PRINTF("mix: fades=%u samples=%u load solo=%u%% (max %u%%) mix=%u%% (max %u%%) headroom=%u%%\r\n",
+           m.fades, m.mixed_samples, m.solo_load_pct, m.solo_load_pct_max,
+           m.mix_load_pct, m.mix_load_pct_max, m.headroom_pct);
 }
 
 static inline int16_t sat_i16(float32_t x)
@@ -221,31 +358,34 @@ static inline int16_t sat_i16(float32_t x)
     return (int16_t)x;
 }
 
-// Aplica EQ in-place sobre un buffer DAC uint16 (centrado en DAC_MID)
+// Aplica EQ in-place sobre un buffer DAC uint16 (centrado en DAC_MID), n frames L/R
 static void EQ_ProcessDacU16Buffer(volatile uint16_t *dst, uint32_t n)
 {
     // Tamaño: asegurate que AUDIO_BUF_LEN <= tamaño de estos arrays
     static float32_t fin[AUDIO_BUF_LEN];
     static float32_t fout[AUDIO_BUF_LEN];
 
-    // 1) uint16 (offset) -> float centrado en 0
-    //    OJO: dst es volatile, leemos una vez y trabajamos en float.
-    for (uint32_t i = 0; i < n; i++) {
-        int32_t centered = (int32_t)dst[i] - (int32_t)DAC_MID;   // ahora es signed alrededor de 0
-        fin[i] = (float32_t)centered;
-    }
-
-    // 2) Filtrado biquad (CMSIS)
-    blockEqualizer(fin, fout, n);
-
-    // 3) float -> uint16 con offset
-    for (uint32_t i = 0; i < n; i++) {
-        int16_t y = sat_i16(fout[i]);
-        int32_t u = (int32_t)y + (int32_t)DAC_MID;
-
-        // clamp a uint16 por las dudas (si DAC_MID no es 32768 exacto)
-        if (u < 0) u = 0;
-        if (u > 65535) u = 65535;
-        dst[i] = (uint16_t)u;
+    // un canal por vez: el biquad de cada uno necesita sus samples seguidos
+    for (uint32_t ch = 0; ch < AUDIO_CHANNELS; ch++) {
+        // 1) uint16 (offset) -> float centrado en 0
+        //    OJO: dst es volatile, leemos una vez y trabajamos en float.
+        for (uint32_t i = 0; i < n; i++) {
+            int32_t centered = (int32_t)dst[i * AUDIO_CHANNELS + ch] - (int32_t)DAC_MID;   // ahora es signed alrededor de 0
+            fin[i] = (float32_t)centered;
+        }
+
+        // 2) Filtrado biquad (CMSIS)
+        blockEqualizer((uint8_t)ch, fin, fout, n);
+
+        // 3) float -> uint16 con offset
+        for (uint32_t i = 0; i < n; i++) {
+            int16_t y = sat_i16(fout[i]);
+            int32_t u = (int32_t)y + (int32_t)DAC_MID;
+
+            // clamp a uint16 por las dudas (si DAC_MID no es 32768 exacto)
+            if (u < 0) u = 0;
+            if (u > 65535) u = 65535;
+            dst[i * AUDIO_CHANNELS + ch] = (uint16_t)u;
+        }
     }
 }
@@ -2,8 +2,12 @@
  * @file     Audio.h
  * @brief Audio output driver using PIT-triggered DMA to DAC with ping-pong buffering.
  *
- * This module implements a continuous audio streaming path from RAM to the DAC
+ * This module implements a continuous audio streaming path from RAM to the DACs
  * using the Kinetis K64 PIT as a sample-rate timebase and eDMA for transfers.
+ * Output is stereo: left on DAC0, right on DAC1. Buffers hold interleaved
+ * L/R samples and each PIT request moves one frame; the minor loop writes
+ * DAC0 then DAC1 and its destination offset returns to DAC0, so a single
+ * channel feeds both DACs.
  * A ping-pong (double) buffer scheme is used so that one buffer is played by DMA
  * while the other buffer is refilled by the CPU in the background.
  *
@@ -30,21 +34,47 @@
 #include "drivers/DMA/DMA.h"
 #include "drivers/DAC/DAC.h"
 
-#define AUDIO_FS_HZ     22050u      // sample rate
-#define AUDIO_BUF_LEN   576u       // must match DMA major loop
+#define AUDIO_FS_HZ     22050u      // sample rate until the first track sets its own
+#define AUDIO_BUF_LEN   576u       // frames per buffer; must match DMA major loop
+#define AUDIO_CHANNELS  2u         // L -> DAC0, R -> DAC1
 #define DAC_BITS        12u
 #define DAC_MAX         ((1u << DAC_BITS) - 1u)
 #define DAC_MID         (DAC_MAX / 2u)
 
+#define AUDIO_LEVEL_BINS    8u      // histogram of the ring level, PCM_RING_SIZE / 8 per bin
+
 // extern uint32_t fs;
 
+/**
+ * @brief Output pipeline counters (see ::Audio_GetStats()).
+ *
+ * A short fill is a buffer that got fewer than AUDIO_BUF_LEN frames from the
+ * PCM ring; the rest is padded with DAC_MID. Most of them are underruns, but
+ * a buffer is also cut where the sample rate changes and at the end of the
+ * last track. A stale buffer is one the DMA started playing before
+ * ::Audio_Service() refilled it (it repeats old audio).
+ */
+typedef struct {
+    uint32_t fills;                 // buffers refilled by Audio_Service()
+    uint32_t short_fills;
+    uint32_t rate_splits;           // short fills cut at a rate change, not underruns
+    uint32_t padded_frames;         // DAC_MID frames written by short fills
+    uint32_t stale_buffers;
+    uint32_t level_min;             // ring level (frames) when a refill starts
+    uint32_t level_max;
+    uint32_t level_hist[AUDIO_LEVEL_BINS];
+    uint32_t isr_latency_ns;        // last major-loop end -> DMA callback
+    uint32_t isr_latency_ns_max;
+    uint32_t isr_late;              // callbacks after the next PIT request: one frame read past the buffer
+} audio_stats_t;
+
 // Flags defined in App.c as globals
 extern volatile bool PIT_trigger;
 extern volatile bool DMA_trigger;
 
 // Ping-pong buffers are defined in App.c
-extern volatile uint16_t bufA[AUDIO_BUF_LEN];
-extern volatile uint16_t bufB[AUDIO_BUF_LEN];
+extern volatile uint16_t bufA[AUDIO_BUF_LEN * AUDIO_CHANNELS];
+extern volatile uint16_t bufB[AUDIO_BUF_LEN * AUDIO_CHANNELS];
 
 /**
  * @brief Initializes the audio module.
@@ -62,4 +92,28 @@ void Audio_Init();
  */
 void Audio_Service(void);
 
+/**
+ * @brief Sample rate of the buffer being played right now.
+ *
+ * Each track plays at its own rate: PIT1 is reprogrammed when the DMA moves
+ * to a buffer whose samples come from a track at a different rate, so
+ * nothing is resampled. Use it for anything that looks at the output
+ * (FFT band edges).
+ */
+uint32_t Audio_GetSampleRateHz(void);
+
+/**
+ * @brief Copies the output counters; ::Audio_ResetStats() clears them (and
+ *        the decoder ones) to measure a new configuration.
+ */
+void Audio_GetStats(audio_stats_t *st);
+void Audio_ResetStats(void);
+
+/**
+ * @brief Prints the output counters, the MP3 decode times and the crossfade
+ *        mixer load / CPU headroom on the debug console (PRINTF, UART0).
+ *        Blocking: call it from a low-priority task.
+ */
+void Audio_PrintStats(void);
+
 #endif /* AUDIO_H_ */
@@ -6,17 +6,23 @@
   ******************************************************************************/
 
 #include "BTN.h"
+#include "../CritSect.h"
 
 #define BTN_COUNT          3
-#define DEBOUNCE_TICKS     3   // 3 * 20ms = 60ms 
+#define BTN_PERIOD_TICKS   2   // btn_cb cada 2 ticks del OS (1 ms)
+#define DEBOUNCE_TICKS     3   // 3 * 2ms = 6ms
+#define LONG_TICKS         (BTN_LONG_MS / BTN_PERIOD_TICKS)
+#define BTN_LONG_MASK      (1u << PLAY_BTN)    // botones con pulsación larga: el click sale al soltar
 
 static void btn_cb(void);
 
 static volatile uint8_t btn_event_pressed[BTN_COUNT] = {0};
+static volatile uint8_t btn_event_long[BTN_COUNT] = {0};
 
 static uint8_t debounced[BTN_COUNT] = {0};
 static uint8_t last_raw[BTN_COUNT] = {0};
 static uint8_t stable_cnt[BTN_COUNT] = {0};
+static uint16_t held_cnt[BTN_COUNT] = {0};
 
 static void btn_cb();
 
@@ -28,7 +34,7 @@ void init_user_buttons(void)
     gpioMode(PIN_PREV, INPUT_PULLDOWN);
     gpioMode(PIN_NEXT, INPUT_PULLDOWN);
 
-    tickAdd(btn_cb, 2);
+    tickAdd(btn_cb, BTN_PERIOD_TICKS);
 }
 
 static inline uint8_t read_btn_raw(btn_state_t b)
@@ -63,18 +69,38 @@ static void btn_cb(void)
         {
             debounced[b] = raw;
 
-            if (debounced[b] == 1) {
-                btn_event_pressed[b] = 1;
+            if (!(BTN_LONG_MASK & (1u << b))) {
+                if (debounced[b] == 1) btn_event_pressed[b] = 1;
+            } else if (debounced[b] == 1) {
+                held_cnt[b] = 0;
+            } else if (held_cnt[b] < LONG_TICKS) {
+                btn_event_pressed[b] = 1;       // se soltó antes de la pulsación larga
             }
         }
+
+        // pulsación larga: sale una vez, sin esperar a que se suelte
+        if ((BTN_LONG_MASK & (1u << b)) && debounced[b] == 1 && held_cnt[b] < LONG_TICKS) {
+            if (++held_cnt[b] == LONG_TICKS) btn_event_long[b] = 1;
+        }
     }
 }
 
 uint8_t get_BTN_state(btn_state_t btn)
 {
-    __disable_irq();
+    CRIT_ALLOC();
+    CRIT_ENTER(CRIT_BTN);
     uint8_t ev = btn_event_pressed[btn];
     btn_event_pressed[btn] = 0;
-    __enable_irq();
+    CRIT_EXIT(CRIT_BTN);
+    return ev;
+}
+
+uint8_t get_BTN_long(btn_state_t btn)
+{
+    CRIT_ALLOC();
+    CRIT_ENTER(CRIT_BTN);
+    uint8_t ev = btn_event_long[btn];
+    btn_event_long[btn] = 0;
+    CRIT_EXIT(CRIT_BTN);
     return ev;
 }
@@ -19,7 +19,20 @@ typedef enum {
 } btn_state_t;
 
 
+#define BTN_LONG_MS     1000u   // PLAY: hold time for a long press
+
 void init_user_buttons(void);
+
+/*
+ * @brief Returns (and clears) a press of @p btn. PLAY reports it on release,
+ *        and only if it was not a long press.
+ */
 uint8_t get_BTN_state(btn_state_t btn);
 
+/*
+ * @brief Returns (and clears) a long press of @p btn (PLAY only), reported
+ *        while still held.
+ */
+uint8_t get_BTN_long(btn_state_t btn);
+
 #endif // BTN
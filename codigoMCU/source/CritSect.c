@@ -0,0 +1,60 @@
+/**
+ * @file     CritSect.c
+ * @brief Counters and report of the tagged critical sections (see CritSect.h).
+ * @author   Grupo 3
+  	  	  	  - Ezequiel Díaz Guzmán
+  	  	  	  - José Iván Hertter
+  	  	  	  - Cristian Damián Meichtry
+  	  	  	  - Lucía Inés Ruiz
+ */
+
+#include "CritSect.h"
+#include <string.h>
+#include "MK64F12.h"
+#include "fsl_debug_console.h"
+
+static const char *const k_crit_names[CRIT_TAG_COUNT] = {
+    "ring_mark",
+    "ring_commit",
+    "ring_snapshot",
+    "ring_rate",
+    "ring_pop",
+    "audio_service",
+    "audio_stats",
+    "i2c_queue",
+    "btn",
+    "recorder",
+    "trace",
+};
+
+crit_stat_t g_crit_stats[CRIT_TAG_COUNT];
+
+void CritSect_GetStats(crit_stat_t *st)
+{
+    if (!st) return;
+    uint32_t pm = __get_PRIMASK();
+    __disable_irq();
+    memcpy(st, g_crit_stats, sizeof(g_crit_stats));
+    __set_PRIMASK(pm);
+}
+
+void CritSect_Reset(void)
+{
+    uint32_t pm = __get_PRIMASK();
+    __disable_irq();
+    memset(g_crit_stats, 0, sizeof(g_crit_stats));
+    __set_PRIMASK(pm);
+}
+
+void CritSect_Print(void)
+{
+    crit_stat_t st[CRIT_TAG_COUNT];
+    uint32_t cyc_per_us = SystemCoreClock / 1000000u;
+
+    CritSect_GetStats(st);
+    for (uint32_t i = 0; i < CRIT_TAG_COUNT; i++) {
+        if (st[i].count == 0u) continue;
+        PRINTF("crit %-14s n=%u max=%u cyc (%u us)\r\n", k_crit_names[i],
+               st[i].count, st[i].max_cyc, st[i].max_cyc / cyc_per_us);
+    }
+}
@@ -0,0 +1,106 @@
+/**
+ * @file     CritSect.h
+ * @brief Tagged interrupt-disable sections with worst-case timing.
+ *
+ * Every application site that masks interrupts (PRIMASK) goes through
+ * CRIT_ENTER(tag) / CRIT_EXIT(tag) with its own tag, so a long section that
+ * delays the audio DMA ISR can be traced back to the code that caused it:
+ *
+ * @code
+ *     CRIT_ALLOC();
+ *     CRIT_ENTER(CRIT_RING_POP);
+ *     ...
+ *     CRIT_EXIT(CRIT_RING_POP);
+ * @endcode
+ *
+ * The previous PRIMASK is restored on exit, so sections nest. With
+ * CRIT_MEAS_EN each exit adds the DWT cycles since the entry to the tag's
+ * count / max, still with interrupts masked; a nested section is also
+ * counted inside the outer one.
+ *
+ * Kernel and uC/OS-based code (CPU_CRITICAL_ENTER, scheduler lock) is
+ * measured by the kernel itself, see TaskStats.h.
+ *
+ * @author   Grupo 3
+  	  	  	  - Ezequiel Díaz Guzmán
+  	  	  	  - José Iván Hertter
+  	  	  	  - Cristian Damián Meichtry
+  	  	  	  - Lucía Inés Ruiz
+ */
+
+#ifndef CRITSECT_H_
+#define CRITSECT_H_
+
+#include <stdint.h>
+
+#ifndef CRIT_MEAS_EN
+#define CRIT_MEAS_EN        1       // 0: solo enmascara, sin medir
+#endif
+
+// Mantener en el mismo orden que k_crit_names en CritSect.c
+typedef enum {
+    CRIT_RING_MARK = 0,         // mp3_player: marca de cambio de frecuencia
+    CRIT_RING_COMMIT,           // mp3_player: publicar lo escrito en el ring
+    CRIT_RING_SNAPSHOT,         // mp3_player: leer rd / wr juntos
+    CRIT_RING_RATE,             // mp3_player: consumir marcas de frecuencia
+    CRIT_RING_POP,              // mp3_player: índices de pcm_ring_pop_block
+    CRIT_AUDIO_SERVICE,         // Audio: qué buffer rellenar
+    CRIT_AUDIO_STATS,           // Audio: copia / reset de audio_stats_t
+    CRIT_I2C_QUEUE,             // cqueue: push / pull de la cola del I2C
+    CRIT_BTN,                   // BTN: leer y limpiar un evento
+    CRIT_RECORDER,              // Recorder: mitades del ring del ADC, stats
+    CRIT_TRACE,                 // Trace: índices del ring de eventos, stats
+    CRIT_TAG_COUNT
+} crit_tag_t;
+
+typedef struct {
+    uint32_t count;
+    uint32_t max_cyc;           // ciclos del DWT
+} crit_stat_t;
+
+/**
+ * @brief Copies the counters of every tag (CRIT_TAG_COUNT entries).
+ */
+void CritSect_GetStats(crit_stat_t *st);
+
+void CritSect_Reset(void);
+
+/**
+ * @brief Prints count and worst time of every tag that ran (PRINTF; the
+ *        debug console must be initialized).
+ */
+void CritSect_Print(void);
+
+#if defined(HOST_BUILD)
+
+#define CRIT_ALLOC()        do { } while (0)
+#define CRIT_ENTER(tag)     do { } while (0)
+#define CRIT_EXIT(tag)      do { } while (0)
+
+#else
+
+#include "MK64F12.h"
+
+#if CRIT_MEAS_EN
+// Solo para los macros: se actualiza con las interrupciones enmascaradas
+extern crit_stat_t g_crit_stats[CRIT_TAG_COUNT];
+
+static inline void crit_account(crit_tag_t tag, uint32_t cyc)
+{
+    crit_stat_t *s = &g_crit_stats[tag];
+    s->count++;
+    if (cyc > s->max_cyc) s->max_cyc = cyc;
+}
+
+#define CRIT_ALLOC()        uint32_t crit_pm, crit_t0
+#define CRIT_ENTER(tag)     do { crit_pm = __get_PRIMASK(); __disable_irq(); crit_t0 = DWT->CYCCNT; } while (0)
+#define CRIT_EXIT(tag)      do { crit_account((tag), DWT->CYCCNT - crit_t0); __set_PRIMASK(crit_pm); } while (0)
+#else
+#define CRIT_ALLOC()        uint32_t crit_pm
+#define CRIT_ENTER(tag)     do { crit_pm = __get_PRIMASK(); __disable_irq(); } while (0)
+#define CRIT_EXIT(tag)      do { __set_PRIMASK(crit_pm); } while (0)
+#endif
+
+#endif /* HOST_BUILD */
+
+#endif /* CRITSECT_H_ */
@@ -42,6 +42,7 @@
 
 
 static uint16_t g_bin_edges[9];
+static uint32_t g_edges_fs = 0;      // fs con la que se calcularon g_bin_edges
 static float    g_window[FFT_N];
 
 static arm_rfft_fast_instance_f32 g_rfft;
@@ -110,6 +111,7 @@ void FFT_Init(void)
     arm_rfft_fast_init_f32(&g_rfft, FFT_N);
 
     compute_bin_edges(AUDIO_FS_HZ, FFT_N, g_bin_edges);
+    g_edges_fs = AUDIO_FS_HZ;
 
     g_init_done = 1;
 }
@@ -129,12 +131,15 @@ void FFT_Init(void)
  *
  * @param[in]  pcm        Pointer to PCM int16 samples.
  * @param[in]  n          Number of samples available in @p pcm.
- * @param[in]  fs_hz      Sampling frequency in Hz (currently unused; edges use AUDIO_FS_HZ).
+ * @param[in]  fs_hz      Sampling frequency in Hz; the band edges are recomputed when it changes.
  * @param[out] out_bands  Output array of 8 normalized band levels in [0..1].
  */
 void FFT_ComputeBands(const int16_t *pcm, size_t n, uint32_t fs_hz, float out_bands[8])
 {
-    (void)fs_hz;
+    if (fs_hz != 0u && fs_hz != g_edges_fs) {
+        compute_bin_edges(fs_hz, FFT_N, g_bin_edges);
+        g_edges_fs = fs_hz;
+    }
 
     if (!pcm || n < FFT_N) {
         for (int i = 0; i < 8; i++) out_bands[i] = 0.0f;
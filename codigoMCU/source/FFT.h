@@ -67,8 +67,8 @@ void FFT_Init(void);
  *     Must be greater than or equal to FFT_N.
  *
  * @param[in]  fs_hz
- *     Sampling frequency in Hz.
- *     Currently unused internally; band edges are computed using AUDIO_FS_HZ.
+ *     Sampling frequency in Hz (the one the track is playing at).
+ *     The FFT bin edges of the 8 bands are recomputed when it changes.
  *
  * @param[out] out_bands
  *     Pointer to an array of 8 floats receiving the normalized band levels.
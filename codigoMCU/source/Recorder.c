@@ -0,0 +1,324 @@
+/**
+ * @file     Recorder.c
+ * @brief Recorder module implementation.
+ *
+ * - ADC0 in 16-bit single-ended mode, hardware-triggered by PIT2 (SIM_SOPT7)
+ * - DMA channel 2 copies ADC0->R[0] into a circular ring (DLAST wraps it);
+ *   half-major and major interrupts mark each half as ready
+ * - ::Recorder_Service() converts a ready half to signed PCM in place and
+ *   writes it with a single f_write() into the preallocated WAV file
+ * @author   Grupo 3
+  	  	  	  - Ezequiel Díaz Guzmán
+  	  	  	  - José Iván Hertter
+  	  	  	  - Cristian Damián Meichtry
+  	  	  	  - Lucía Inés Ruiz
+ */
+
+#include "Recorder.h"
+#include <string.h>
+#include "fsl_adc16.h"
+#include "CritSect.h"
+#include "drivers/FAT/ff.h"
+
+#define REC_DMA_CH          DMA_CH2
+#define REC_PIT             PIT_2
+#define REC_HALF_BYTES      (REC_HALF_SAMPLES * 2u)
+#define REC_ADC_TRG_PIT2    6u          // SIM_SOPT7 ADC0TRGSEL: PIT trigger 2
+
+static uint16_t rec_ring[REC_RING_SAMPLES] __attribute__((aligned(4)));
+
+static FIL g_fil;
+static bool g_recording = false;
+static bool g_full = false;
+static uint32_t g_capacity;             // bytes de PCM que entran en lo preasignado
+
+// Mitades llenadas por el DMA y mitades ya escritas (o perdidas). Solo crecen.
+static volatile uint32_t g_halves_done = 0;
+static volatile uint32_t g_halves_freed = 0;
+
+static recorder_stats_t g_stats;
+static uint64_t g_write_cycles;
+
+static void wav_header(uint8_t *h, uint32_t data_bytes);
+static bool rec_write(const void *p, uint32_t n);
+
+/**
+ * @brief DMA half/major-loop callback: one more half of the ring is full.
+ *
+ * If the previous half is still pending the DMA is now overwriting it, so
+ * it is given up as dropped and the writer skips it.
+ *
+ * @note Called from DMA interrupt context.
+ */
+static void RecDMA_cb(void)
+{
+    g_halves_done++;
+    g_stats.samples_captured += REC_HALF_SAMPLES;
+
+    if (g_halves_done - g_halves_freed > 1u) {
+        g_halves_freed++;
+        g_stats.samples_dropped += REC_HALF_SAMPLES;
+        g_stats.overruns++;
+    }
+}
+
+static void rec_adc_init(void)
+{
+    adc16_config_t cfg;
+    adc16_channel_config_t ch = {0};
+
+    ADC16_GetDefaultConfig(&cfg);
+    cfg.clockSource  = kADC16_ClockSourceAlt0;          // bus clock
+    cfg.clockDivider = kADC16_ClockDivider8;            // ADCK <= 12 MHz en 16 bits
+    cfg.resolution   = kADC16_ResolutionSE16Bit;
+    ADC16_Init(ADC0, &cfg);
+
+    ADC16_EnableHardwareTrigger(ADC0, false);           // la calibración es por software
+    (void)ADC16_DoAutoCalibration(ADC0);
+    ADC16_SetHardwareAverage(ADC0, kADC16_HardwareAverageCount4);
+
+    // PIT2 -> ADC0 trigger A (SC1[0])
+    SIM->SOPT7 = (SIM->SOPT7 & ~(SIM_SOPT7_ADC0TRGSEL_MASK | SIM_SOPT7_ADC0PRETRGSEL_MASK))
+               | SIM_SOPT7_ADC0TRGSEL(REC_ADC_TRG_PIT2) | SIM_SOPT7_ADC0ALTTRGEN_MASK;
+
+    ADC16_EnableDMA(ADC0, true);
+    ADC16_EnableHardwareTrigger(ADC0, true);
+
+    ch.channelNumber = REC_ADC_CHANNEL;
+    ADC16_SetChannelConfig(ADC0, 0u, &ch);
+}
+
+static void rec_dma_init(void)
+{
+    DMA_Init();
+
+    DMA_SetEnableRequest(REC_DMA_CH, false);
+    DMAMUX_ConfigChannel(REC_DMA_CH, true, false, kDmaRequestMux0ADC0);   // COCO --> DMAMUX --> DMA
+
+    // TCD setup: ADC0 R[0] -> rec_ring, circular
+    DMA_SetSourceAddr(REC_DMA_CH, (uint32_t)&ADC0->R[0]);
+    DMA_SetSourceAddrOffset(REC_DMA_CH, 0);
+    DMA_SetSourceLastAddrOffset(REC_DMA_CH, 0);
+    DMA_SetDestAddr(REC_DMA_CH, (uint32_t)rec_ring);
+    DMA_SetDestAddrOffset(REC_DMA_CH, 2);
+    DMA_SetDestLastAddrOffset(REC_DMA_CH, -(int32_t)sizeof(rec_ring));   // vuelve al principio del ring
+
+    DMA_SetSourceTransfSize(REC_DMA_CH, DMA_TransSize_16Bit);
+    DMA_SetDestTransfSize(REC_DMA_CH, DMA_TransSize_16Bit);
+    DMA_SetMinorLoopTransCount(REC_DMA_CH, 2);                          // 1 sample por request
+
+    DMA_SetStartMajorLoopCount(REC_DMA_CH, REC_RING_SAMPLES);
+    DMA_SetCurrMajorLoopCount (REC_DMA_CH, REC_RING_SAMPLES);
+
+    DMA_SetChannelInterrupt(REC_DMA_CH, true, RecDMA_cb);
+    DMA0->TCD[REC_DMA_CH].CSR |= DMA_CSR_INTHALF_MASK;                  // una IRQ por mitad
+    DMA0->TCD[REC_DMA_CH].CSR &= ~DMA_CSR_DREQ_MASK;
+
+    DMA_SetEnableRequest(REC_DMA_CH, true);
+}
+
+static void rec_hw_stop(void)
+{
+    PIT_Disable(REC_PIT);
+    DMA_SetEnableRequest(REC_DMA_CH, false);
+    ADC16_EnableHardwareTrigger(ADC0, false);
+    ADC16_EnableDMA(ADC0, false);
+}
+
+bool Recorder_Start(const char *path, uint32_t max_seconds)
+{
+    uint8_t hdr[REC_HEADER_SIZE];
+    UINT bw;
+
+    if (g_recording || !path || max_seconds == 0u) return false;
+
+    // Capacidad en mitades enteras: así cada f_write es un bloque de sectores completo
+    uint32_t halves = (max_seconds * REC_FS_HZ + REC_HALF_SAMPLES - 1u) / REC_HALF_SAMPLES;
+    g_capacity = halves * REC_HALF_BYTES;
+
+    if (f_open(&g_fil, path, FA_CREATE_ALWAYS | FA_WRITE) != FR_OK) return false;
+
+    // Clusters contiguos reservados ya: f_write no toca la FAT para alocar
+    if (f_expand(&g_fil, (FSIZE_t)REC_HEADER_SIZE + g_capacity, 1) != FR_OK) {
+        f_close(&g_fil);
+        f_unlink(path);
+        return false;
+    }
+
+    // El header ya declara todo lo reservado: si se corta la alimentación el WAV abre igual
+    wav_header(hdr, g_capacity);
+    if (f_write(&g_fil, hdr, sizeof(hdr), &bw) != FR_OK || bw != sizeof(hdr) ||
+        f_sync(&g_fil) != FR_OK) {
+        f_close(&g_fil);
+        f_unlink(path);
+        return false;
+    }
+
+    memset(&g_stats, 0, sizeof(g_stats));
+    g_write_cycles = 0;
+    g_halves_done = 0;
+    g_halves_freed = 0;
+    g_full = false;
+
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;     // DWT->CYCCNT para medir cada f_write
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    rec_adc_init();
+    rec_dma_init();
+
+    PIT_Init(REC_PIT, REC_FS_HZ);   // arranca a disparar el ADC
+    PIT_DisableInterrupt(REC_PIT);  // solo el trigger, sin IRQ
+
+    g_recording = true;
+    return true;
+}
+
+bool Recorder_Service(void)
+{
+    if (!g_recording || g_full) return false;
+
+    for (;;) {
+        uint32_t seq;
+        CRIT_ALLOC();
+
+        CRIT_ENTER(CRIT_RECORDER);
+        seq = g_halves_freed;
+        bool ready = (g_halves_done != seq);
+        CRIT_EXIT(CRIT_RECORDER);
+        if (!ready) return true;
+
+        if (g_stats.bytes_written + REC_HALF_BYTES > g_capacity) {
+            g_full = true;
+            return false;
+        }
+
+        // ADC16 single-ended es unsigned; WAV de 16 bits es signed
+        uint16_t *half = &rec_ring[(seq & 1u) * REC_HALF_SAMPLES];
+        for (uint32_t i = 0; i < REC_HALF_SAMPLES; i++) half[i] ^= 0x8000u;
+
+        // Si el DMA ya la empezó a pisar, el callback la contó como perdida: no se escribe
+        if (g_halves_freed != seq) continue;
+        if (!rec_write(half, REC_HALF_BYTES)) return false;
+
+        bool lost;
+        CRIT_ENTER(CRIT_RECORDER);
+        lost = (g_halves_freed != seq);
+        if (!lost) g_halves_freed = seq + 1u;
+        CRIT_EXIT(CRIT_RECORDER);
+
+        // Pisada durante el f_write: se retrocede, la próxima mitad va en su lugar
+        if (lost) {
+            g_stats.bytes_written -= REC_HALF_BYTES;
+            if (f_lseek(&g_fil, f_tell(&g_fil) - REC_HALF_BYTES) != FR_OK) return false;
+        }
+    }
+}
+
+bool Recorder_Stop(void)
+{
+    uint8_t hdr[REC_HEADER_SIZE];
+    UINT bw;
+    bool ok = true;
+
+    if (!g_recording) return false;
+
+    rec_hw_stop();
+    ok &= (Recorder_Service() || g_full);   // lleno no es error
+
+    // Lo que quedó a medias en la mitad actual (CITER cuenta para abajo)
+    uint32_t pos = REC_RING_SAMPLES - DMA_GetCurrMajorLoopCount(REC_DMA_CH);
+    if (pos >= REC_RING_SAMPLES) pos = 0;
+    uint32_t start = (g_halves_done & 1u) * REC_HALF_SAMPLES;
+    if (!g_full && pos > start) {
+        uint32_t n = pos - start;
+        if (g_stats.bytes_written + n * 2u > g_capacity) n = (g_capacity - g_stats.bytes_written) / 2u;
+
+        for (uint32_t i = 0; i < n; i++) rec_ring[start + i] ^= 0x8000u;
+        g_stats.samples_captured += n;
+        ok &= rec_write(&rec_ring[start], n * 2u);
+    }
+
+    // Devuelve lo reservado que no se usó y corrige los tamaños del header
+    if (f_truncate(&g_fil) != FR_OK) ok = false;
+    wav_header(hdr, g_stats.bytes_written);
+    if (f_lseek(&g_fil, 0) != FR_OK ||
+        f_write(&g_fil, hdr, sizeof(hdr), &bw) != FR_OK || bw != sizeof(hdr)) ok = false;
+    if (f_close(&g_fil) != FR_OK) ok = false;
+
+    g_recording = false;
+    return ok;
+}
+
+bool Recorder_IsRecording(void)
+{
+    return g_recording;
+}
+
+void Recorder_GetStats(recorder_stats_t *st)
+{
+    if (!st) return;
+
+    CRIT_ALLOC();
+    CRIT_ENTER(CRIT_RECORDER);
+    *st = g_stats;
+    CRIT_EXIT(CRIT_RECORDER);
+
+    uint32_t cyc_per_ms = SystemCoreClock / 1000u;
+    uint32_t ms = (uint32_t)(g_write_cycles / cyc_per_ms);
+    st->write_kbps = ms ? (uint32_t)((uint64_t)st->bytes_written / ms) : 0u;   // bytes/ms == KB/s
+}
+
+static bool rec_write(const void *p, uint32_t n)
+{
+    UINT bw;
+
+    uint32_t t0 = DWT->CYCCNT;
+    FRESULT fr = f_write(&g_fil, p, n, &bw);
+    uint32_t cyc = DWT->CYCCNT - t0;
+
+    uint32_t us = cyc / (SystemCoreClock / 1000000u);
+    g_write_cycles += cyc;
+    g_stats.writes++;
+    if (us > g_stats.max_write_us) g_stats.max_write_us = us;
+    g_stats.bytes_written += bw;
+
+    return (fr == FR_OK) && (bw == n);
+}
+
+static void put_le32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); p[2] = (uint8_t)(v >> 16); p[3] = (uint8_t)(v >> 24);
+}
+
+static void put_le16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8);
+}
+
+/**
+ * @brief RIFF/WAVE header, mono 16-bit PCM, padded to REC_HEADER_SIZE with
+ *        a JUNK chunk so the first sample lands on a sector boundary.
+ */
+static void wav_header(uint8_t *h, uint32_t data_bytes)
+{
+    memset(h, 0, REC_HEADER_SIZE);
+
+    memcpy(&h[0], "RIFF", 4);
+    put_le32(&h[4], REC_HEADER_SIZE - 8u + data_bytes);
+    memcpy(&h[8], "WAVE", 4);
+
+    memcpy(&h[12], "fmt ", 4);
+    put_le32(&h[16], 16u);
+    put_le16(&h[20], 1u);                   // PCM
+    put_le16(&h[22], 1u);                   // mono
+    put_le32(&h[24], REC_FS_HZ);
+    put_le32(&h[28], REC_FS_HZ * 2u);       // byte rate
+    put_le16(&h[32], 2u);                   // block align
+    put_le16(&h[34], 16u);                  // bits per sample
+
+    memcpy(&h[36], "JUNK", 4);
+    put_le32(&h[40], REC_HEADER_SIZE - 44u - 8u);
+
+    memcpy(&h[REC_HEADER_SIZE - 8u], "data", 4);
+    put_le32(&h[REC_HEADER_SIZE - 4u], data_bytes);
+}
@@ -0,0 +1,74 @@
+/**
+ * @file     Recorder.h
+ * @brief Audio capture to a WAV file: PIT-triggered ADC16, DMA into a ring.
+ *
+ * PIT2 hardware-triggers ADC0 at ::REC_FS_HZ; every conversion requests DMA
+ * channel 2, which copies the result into a ring of 16-bit samples split in
+ * two halves. Each time a half fills, ::Recorder_Service() writes it to a
+ * WAV file whose clusters were preallocated with f_expand(), so the writes
+ * are sector-aligned multi-block transfers with no FAT allocation in between.
+ *
+ * If the card is slower than the ADC for longer than one half, the DMA
+ * overwrites samples before they are written; those are counted as dropped.
+ *
+ * @author   Grupo 3
+  	  	  	  - Ezequiel Díaz Guzmán
+  	  	  	  - José Iván Hertter
+  	  	  	  - Cristian Damián Meichtry
+  	  	  	  - Lucía Inés Ruiz
+ */
+
+#ifndef RECORDER_H_
+#define RECORDER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "Audio.h"
+
+#define REC_FS_HZ           AUDIO_FS_HZ
+#define REC_ADC_CHANNEL     1u          // ADC0_DP1: pin analógico dedicado, sin mux de PORT
+#define REC_RING_SAMPLES    8192u       // 2 mitades de 8 KB: ~185 ms de margen a 22050 Hz
+#define REC_HALF_SAMPLES    (REC_RING_SAMPLES / 2u)
+#define REC_HEADER_SIZE     512u        // header WAV + JUNK: los datos arrancan alineados a sector
+
+typedef struct {
+    uint32_t samples_captured;  // samples DMA'd from the ADC into the ring
+    uint32_t samples_dropped;   // overwritten in the ring before reaching the card
+    uint32_t overruns;          // halves lost (samples_dropped / REC_HALF_SAMPLES)
+    uint32_t bytes_written;     // PCM bytes in the file
+    uint32_t writes;            // f_write() calls
+    uint32_t max_write_us;      // slowest f_write(): needs to stay below one half
+    uint32_t write_kbps;        // bytes_written over the time spent inside f_write()
+} recorder_stats_t;
+
+/**
+ * @brief Creates @p path, preallocates room for @p max_seconds of mono
+ *        16-bit audio and starts capturing.
+ *
+ * @return false if the file cannot be created or the volume has no
+ *         contiguous free run that large (f_expand() fails).
+ * @note   The volume must be mounted. Uses PIT2, ADC0 and DMA channel 2.
+ */
+bool Recorder_Start(const char *path, uint32_t max_seconds);
+
+/**
+ * @brief Writes every filled half of the ring to the file.
+ *
+ * Must be called at least once per half (REC_HALF_SAMPLES / REC_FS_HZ).
+ *
+ * @return false once the file is full or a write failed; call
+ *         ::Recorder_Stop() to close it.
+ */
+bool Recorder_Service(void);
+
+/**
+ * @brief Stops the capture, writes the samples still in the ring, trims the
+ *        unused preallocation and patches the WAV header with the real size.
+ */
+bool Recorder_Stop(void);
+
+bool Recorder_IsRecording(void);
+
+void Recorder_GetStats(recorder_stats_t *st);
+
+#endif /* RECORDER_H_ */
@@ -0,0 +1,194 @@
+/**
+ * @file     Resampler.c
+ * @brief Streaming polyphase sample-rate converter (see Resampler.h).
+ *
+ * The input position of each output sample is kept as an integer index
+ * into the history plus a 32-bit fraction, advanced by in_hz / out_hz per
+ * output; the average rate is exact. The upper bits of the fraction pick the
+ * bank row, the next 15 bits interpolate between that row and the next one.
+ *
+ * @author   Grupo 3
+  	  	  	  - Ezequiel Díaz Guzmán
+  	  	  	  - José Iván Hertter
+  	  	  	  - Cristian Damián Meichtry
+  	  	  	  - Lucía Inés Ruiz
+ */
+
+#include "Resampler.h"
+#include <string.h>
+#include <math.h>
+
+#ifndef HOST_BUILD
+#include "MK64F12.h"
+#define SRC_MAC(h, x, acc)  ((int64_t)__SMLALD((uint32_t)(h), (uint32_t)(x), (uint64_t)(acc)))
+#else
+#define SRC_MAC(h, x, acc)  ((acc) + (int32_t)(int16_t)(h) * (int16_t)(x) + \
+                             (int32_t)(int16_t)((uint32_t)(h) >> 16) * (int16_t)((uint32_t)(x) >> 16))
+#endif
+
+#if (SRC_TAPS & 1u) || (SRC_TAPS < 4u)
+#error "SRC_TAPS must be even and >= 4"
+#endif
+
+#define SRC_PHASE_BITS      6u      // log2(SRC_PHASES)
+#define SRC_MU_SHIFT        (32u - SRC_PHASE_BITS - 15u)
+
+#if ((1u << SRC_PHASE_BITS) != SRC_PHASES)
+#error "SRC_PHASE_BITS does not match SRC_PHASES"
+#endif
+
+static const uint32_t k_src_in_hz[SRC_RATES] = { 48000u, 44100u, 32000u };
+
+// [tasa][fase 0..SRC_PHASES][tap]; la fila SRC_PHASES es la fase 0 corrida un sample
+static int16_t g_bank[SRC_RATES][SRC_PHASES + 1u][SRC_TAPS] __attribute__((aligned(4)));
+static bool    g_bank_ok[SRC_RATES];
+static uint32_t g_out_hz = 0;
+
+// Estado del stream
+static const int16_t (*g_rows)[SRC_TAPS] = NULL;
+static int16_t  g_hist[2][SRC_TAPS + SRC_BLOCK_MAX];     // L, R: el dot product lee samples seguidos
+static uint32_t g_nhist = 0;
+static uint32_t g_ipos = 0;                 // primer tap de la próxima salida
+static uint32_t g_frac = 0;                 // posición fraccionaria (Q32)
+static uint32_t g_step_int = 0;             // in_hz / out_hz en entero + Q32
+static uint32_t g_step_frac = 0;
+
+/*******************************************************************************
+ * Bancos de filtros
+ ******************************************************************************/
+
+static float src_sinc(float x)
+{
+    if (fabsf(x) < 1e-6f) return 1.0f;
+    return sinf((float)M_PI * x) / ((float)M_PI * x);
+}
+
+static float src_blackman(float u)
+{
+    if (fabsf(u) >= 1.0f) return 0.0f;
+    return 0.42f + 0.5f * cosf((float)M_PI * u) + 0.08f * cosf(2.0f * (float)M_PI * u);
+}
+
+static void src_build_bank(int16_t bank[SRC_PHASES + 1u][SRC_TAPS], uint32_t in_hz, uint32_t out_hz)
+{
+    const float fc   = SRC_ROLLOFF * (float)out_hz / (float)in_hz;    // 2 * corte / in_hz
+    const float half = (float)(SRC_TAPS / 2u);
+    float row[SRC_TAPS];
+
+    for (uint32_t p = 0; p <= SRC_PHASES; p++) {
+        const float f = (float)p / (float)SRC_PHASES;
+        float sum = 0.0f;
+
+        // la salida cae entre el tap TAPS/2 - 1 y el TAPS/2, a f del primero
+        for (uint32_t k = 0; k < SRC_TAPS; k++) {
+            float tau = (half - 1.0f) + f - (float)k;
+            row[k] = fc * src_sinc(fc * tau) * src_blackman(tau / half);
+            sum += row[k];
+        }
+        // ganancia 1 en DC en todas las fases: sin ripple al barrer la fracción
+        for (uint32_t k = 0; k < SRC_TAPS; k++) {
+            bank[p][k] = (int16_t)lrintf(32767.0f * row[k] / sum);
+        }
+    }
+}
+
+bool Resampler_Init(uint32_t out_hz)
+{
+    if (out_hz == 0u) return false;
+    if (out_hz == g_out_hz) return true;
+
+    g_out_hz = out_hz;
+    g_rows = NULL;
+    for (uint32_t i = 0; i < SRC_RATES; i++) {
+        g_bank_ok[i] = (k_src_in_hz[i] > out_hz);
+        if (g_bank_ok[i]) src_build_bank(g_bank[i], k_src_in_hz[i], out_hz);
+    }
+    return true;
+}
+
+bool Resampler_Start(uint32_t in_hz)
+{
+    g_rows = NULL;
+    for (uint32_t i = 0; i < SRC_RATES; i++) {
+        if (k_src_in_hz[i] == in_hz && g_bank_ok[i]) g_rows = (const int16_t (*)[SRC_TAPS])g_bank[i];
+    }
+    if (!g_rows) return false;
+
+    g_step_int  = in_hz / g_out_hz;
+    g_step_frac = (uint32_t)((((uint64_t)(in_hz % g_out_hz)) << 32) / g_out_hz);
+
+    // historia en cero: el principio entra desde silencio
+    memset(g_hist, 0, sizeof(g_hist));
+    g_nhist = SRC_TAPS / 2u;
+    g_ipos = 0;
+    g_frac = 0;
+    return true;
+}
+
+uint32_t Resampler_OutHz(void)
+{
+    return g_out_hz;
+}
+
+/*******************************************************************************
+ * Conversión
+ ******************************************************************************/
+
+static inline uint32_t rd_q15x2(const int16_t *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));       // LDR sin alinear (el M4 lo soporta; LDRD no)
+    return v;
+}
+
+static inline int32_t src_dot(const int16_t *h, const int16_t *x)
+{
+    int64_t acc = 0;
+    for (uint32_t k = 0; k < SRC_TAPS; k += 2u) {
+        acc = SRC_MAC(rd_q15x2(&h[k]), rd_q15x2(&x[k]), acc);
+    }
+    return (int32_t)(acc >> 15);
+}
+
+// Un canal en la posición actual: las dos filas vecinas, interpoladas
+static inline uint32_t src_eval(const int16_t *x, uint32_t p, int32_t mu)
+{
+    int32_t y0 = src_dot(g_rows[p], x);
+    int32_t y1 = src_dot(g_rows[p + 1u], x);
+    int32_t y  = y0 + (int32_t)(((int64_t)(y1 - y0) * mu) >> 15);
+
+    if (y > 32767) y = 32767;
+    if (y < -32768) y = -32768;
+    return (uint32_t)y & 0xFFFFu;
+}
+
+uint32_t Resampler_Process(const uint32_t *in, uint32_t n, uint32_t *out)
+{
+    uint32_t m = 0;
+
+    if (!g_rows || n > SRC_BLOCK_MAX) return 0;
+
+    for (uint32_t k = 0; k < n; k++) {
+        g_hist[0][g_nhist + k] = (int16_t)(in[k] & 0xFFFFu);
+        g_hist[1][g_nhist + k] = (int16_t)(in[k] >> 16);
+    }
+    g_nhist += n;
+
+    while (g_ipos + SRC_TAPS <= g_nhist) {
+        uint32_t p  = g_frac >> (32u - SRC_PHASE_BITS);
+        int32_t  mu = (int32_t)((g_frac >> SRC_MU_SHIFT) & 0x7FFFu);
+
+        out[m++] = src_eval(&g_hist[0][g_ipos], p, mu) | (src_eval(&g_hist[1][g_ipos], p, mu) << 16);
+
+        uint32_t f = g_frac + g_step_frac;
+        g_ipos += g_step_int + (f < g_frac ? 1u : 0u);
+        g_frac = f;
+    }
+
+    // lo consumido se descarta; quedan < SRC_TAPS samples
+    g_nhist -= g_ipos;
+    memmove(g_hist[0], &g_hist[0][g_ipos], g_nhist * sizeof(int16_t));
+    memmove(g_hist[1], &g_hist[1][g_ipos], g_nhist * sizeof(int16_t));
+    g_ipos = 0;
+    return m;
+}
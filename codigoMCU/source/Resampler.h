@@ -0,0 +1,64 @@
+/**
+ * @file     Resampler.h
+ * @brief Streaming polyphase sample-rate converter for a fixed output rate.
+ *
+ * Converts stereo int16 PCM from 48, 44.1 or 32 kHz down to one fixed output
+ * rate (::AUDIO_FS_HZ in the player). Frames are packed like the player's
+ * ring: left in the low half-word, right in the high one.
+ *
+ * Each output sample is a SRC_TAPS-tap FIR evaluated at the exact
+ * fractional input position: the filter bank holds the windowed-sinc
+ * lowpass at SRC_PHASES fractional offsets and the two nearest rows are
+ * interpolated linearly. The banks are computed once per input rate by
+ * ::Resampler_Init(); the dot products use the M4 dual 16-bit MAC (SMLALD).
+ *
+ * Cost is SRC_TAPS dual MACs (two rows) per channel and output frame,
+ * independent of the ratio. Tests/SRC_bench.c measures cycles per frame and
+ * stopband rejection for the compiled SRC_TAPS.
+ *
+ * @author   Grupo 3
+  	  	  	  - Ezequiel Díaz Guzmán
+  	  	  	  - José Iván Hertter
+  	  	  	  - Cristian Damián Meichtry
+  	  	  	  - Lucía Inés Ruiz
+ */
+
+#ifndef RESAMPLER_H_
+#define RESAMPLER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifndef SRC_TAPS
+#define SRC_TAPS            32u     // taps por fase (par); 16: ~25 dB, 32: ~65 dB de rechazo (SRC_bench)
+#endif
+#define SRC_PHASES          64u     // posiciones fraccionarias tabuladas (interpoladas)
+#define SRC_BLOCK_MAX       256u    // frames de entrada por Resampler_Process()
+#define SRC_ROLLOFF         0.90f   // corte en 0.9 * Nyquist de salida
+#define SRC_RATES           3u      // 48000, 44100, 32000
+
+/**
+ * @brief Builds the filter banks for every supported input rate above
+ *        @p out_hz. Float math: call it once, outside the audio path.
+ */
+bool Resampler_Init(uint32_t out_hz);
+
+/**
+ * @brief Selects the bank for @p in_hz and clears the filter history.
+ * @return false if there is no bank for that rate (play it unconverted).
+ */
+bool Resampler_Start(uint32_t in_hz);
+
+/**
+ * @brief Converts @p n frames (n <= SRC_BLOCK_MAX) into @p out.
+ *
+ * Frames are delayed by SRC_TAPS / 2 inputs; the filter keeps them between
+ * calls, so a stream can be fed in blocks of any size.
+ *
+ * @return frames written to @p out (never more than @p n when downsampling).
+ */
+uint32_t Resampler_Process(const uint32_t *in, uint32_t n, uint32_t *out);
+
+uint32_t Resampler_OutHz(void);
+
+#endif /* RESAMPLER_H_ */
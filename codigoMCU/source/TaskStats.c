@@ -0,0 +1,106 @@
+/**
+ * @file     TaskStats.c
+ * @brief Task report implementation (see TaskStats.h).
+ *
+ * - Walks OSTaskDbgListPtr (OS_CFG_DBG_EN), every task created so far,
+ *   the kernel's own included
+ * - Copies each TCB's counters inside a critical section and prints
+ *   outside of it: PRINTF blocks on the UART
+ * @author   Grupo 3
+  	  	  	  - Ezequiel Díaz Guzmán
+  	  	  	  - José Iván Hertter
+  	  	  	  - Cristian Damián Meichtry
+  	  	  	  - Lucía Inés Ruiz
+ */
+
+#include "TaskStats.h"
+#include <stdint.h>
+#include "os.h"
+#include "cpu.h"
+#include "fsl_debug_console.h"
+
+#if (OS_CFG_DBG_EN == 0u) || (OS_CFG_TASK_PROFILE_EN == 0u) || (OS_CFG_STAT_TASK_STK_CHK_EN == 0u) || \
+    (OS_CFG_SCHED_LOCK_TIME_MEAS_EN == 0u) || !defined(CPU_CFG_INT_DIS_MEAS_EN)
+#error "TaskStats needs the profiling, stack check and IRQ-off / scheduler lock measurement options"
+#endif
+#if OS_CFG_TS_EN == 0u
+#warning "OS_CFG_TS_EN is 0: per-task CPU% will read 0"
+#endif
+
+typedef struct {
+    const char  *name;
+    OS_PRIO      prio;
+    OS_CPU_USAGE cpu;           // centésimas de %
+    OS_CPU_USAGE cpu_max;
+    OS_CTX_SW_CTR ctx;
+    CPU_TS       int_dis;       // ciclos del DWT
+    CPU_TS       sched_lock;
+    CPU_STK_SIZE used;          // elementos de CPU_STK (4 bytes)
+    CPU_STK_SIZE size;
+} task_row_t;
+
+void TaskStats_Init(void)
+{
+    OS_ERR err;
+
+    OSStatTaskCPUUsageInit(&err);
+}
+
+static uint32_t ts_to_us(CPU_TS ts)
+{
+    return (uint32_t)(((uint64_t)ts * 1000000u) / SystemCoreClock);
+}
+
+static void print_row(const task_row_t *r)
+{
+    PRINTF("%-18s %3u %3u.%02u %3u.%02u %9u %6u %6u %5u/%-5u %3u%%\r\n",
+           r->name ? r->name : "?", r->prio,
+           r->cpu / 100u, r->cpu % 100u, r->cpu_max / 100u, r->cpu_max % 100u,
+           r->ctx, ts_to_us(r->int_dis), ts_to_us(r->sched_lock),
+           r->used, r->size, r->size ? (r->used * 100u) / r->size : 0u);
+}
+
+void TaskStats_Print(void)
+{
+    CPU_SR_ALLOC();
+    task_row_t r;
+    OS_CPU_USAGE total, total_max;
+    OS_CTX_SW_CTR ctx_sw;
+    CPU_TS int_dis, sched_lock;
+
+    PRINTF("%-18s %3s %6s %6s %9s %6s %6s %11s %4s\r\n",
+           "task", "pri", "cpu%", "peak%", "ctx", "irqoff", "schdlk", "stack", "used");
+
+    // la lista se recorre de a un TCB por sección crítica: no hay tareas que se borren
+    CPU_CRITICAL_ENTER();
+    OS_TCB *p = OSTaskDbgListPtr;
+    CPU_CRITICAL_EXIT();
+    while (p != (OS_TCB *)0) {
+        CPU_CRITICAL_ENTER();
+        r.name       = (const char *)p->NamePtr;
+        r.prio       = p->Prio;
+        r.cpu        = p->CPUUsage;
+        r.cpu_max    = p->CPUUsageMax;
+        r.ctx        = p->CtxSwCtr;
+        r.int_dis    = p->IntDisTimeMax;
+        r.sched_lock = p->SchedLockTimeMax;
+        r.used       = p->StkUsed;
+        r.size       = p->StkSize;
+        p = p->DbgNextPtr;
+        CPU_CRITICAL_EXIT();
+        print_row(&r);
+    }
+
+    CPU_CRITICAL_ENTER();
+    total      = OSStatTaskCPUUsage;
+    total_max  = OSStatTaskCPUUsageMax;
+    ctx_sw     = OSTaskCtxSwCtr;
+    int_dis    = OSIntDisTimeMax;
+    sched_lock = OSSchedLockTimeMax;
+    CPU_CRITICAL_EXIT();
+
+    PRINTF("cpu %u.%02u%% (peak %u.%02u%%) ctx sw %u irq off max %uus sched lock max %uus%s\r\n",
+           total / 100u, total % 100u, total_max / 100u, total_max % 100u,
+           ctx_sw, ts_to_us(int_dis), ts_to_us(sched_lock),
+           OSStatTaskRdy ? "" : " (stat task not started)");
+}
@@ -0,0 +1,42 @@
+/**
+ * @file     TaskStats.h
+ * @brief Per-task CPU, context-switch, interrupt-disable and stack report.
+ *
+ * Reads what the uC/OS-III statistic task already computes (os_cfg.h:
+ * OS_CFG_STAT_TASK_EN, OS_CFG_TASK_PROFILE_EN, OS_CFG_STAT_TASK_STK_CHK_EN,
+ * OS_CFG_TS_EN, OS_CFG_SCHED_LOCK_TIME_MEAS_EN; CPU_CFG_INT_DIS_MEAS_EN in
+ * cpu_cfg.h) and prints one line per task through the debug console:
+ * - CPU%: share of the DWT cycles of the last statistic period (10 Hz), and
+ *   its peak. The idle task's share is the free CPU.
+ * - ctx: times the task was switched in since start
+ * - irq off: longest interrupt-disable section (CPU_CRITICAL_ENTER only)
+ *   seen while the task was running, ISRs that interrupted it included;
+ *   application sections are in CritSect.h
+ * - sched lock: longest OSSchedLock() / kernel scheduler lock
+ * - stack: high-water mark against the size given to OSTaskCreate()
+ *
+ * @author   Grupo 3
+  	  	  	  - Ezequiel Díaz Guzmán
+  	  	  	  - José Iván Hertter
+  	  	  	  - Cristian Damián Meichtry
+  	  	  	  - Lucía Inés Ruiz
+ */
+
+#ifndef TASKSTATS_H_
+#define TASKSTATS_H_
+
+/**
+ * @brief Starts the statistic task: until this runs, it only waits.
+ *
+ * Must be called from a task (it sleeps 100 ms to calibrate the idle
+ * counter, so the overall CPU% the kernel reports is only approximate if
+ * other tasks run meanwhile; the per-task shares are not affected).
+ */
+void TaskStats_Init(void);
+
+/**
+ * @brief Prints the table (PRINTF; the debug console must be initialized).
+ */
+void TaskStats_Print(void);
+
+#endif /* TASKSTATS_H_ */
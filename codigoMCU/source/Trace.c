@@ -0,0 +1,172 @@
+/**
+ * @file     Trace.c
+ * @brief Trace module implementation.
+ *
+ * - Records are reserved and written with PRIMASK set, so tasks and ISRs can
+ *   share the ring and the timestamps come out in order
+ * - The writer never overwrites undrained records: a full ring drops the new
+ *   one and counts it
+ * - ::Trace_Service() copies up to TRACE_TX_RECORDS records behind a header
+ *   into g_tx and hands it to DMA channel 3 (UART0 TDRE request, DREQ set:
+ *   the channel stops by itself at the end of the frame)
+ * @author   Grupo 3
+  	  	  	  - Ezequiel Díaz Guzmán
+  	  	  	  - José Iván Hertter
+  	  	  	  - Cristian Damián Meichtry
+  	  	  	  - Lucía Inés Ruiz
+ */
+
+#include "Trace.h"
+#include <string.h>
+#include "MK64F12.h"
+#include "os.h"
+#include "drivers/DMA/DMA.h"
+#include "CritSect.h"
+
+#define TRACE_MASK          (TRACE_RING_LEN - 1u)
+#define TRACE_DMA_CH        DMA_CH3
+#define TRACE_HDR_SIZE      16u
+
+#if (TRACE_RING_LEN & TRACE_MASK) != 0u
+#error "TRACE_RING_LEN must be a power of 2"
+#endif
+
+static trace_rec_t g_ring[TRACE_RING_LEN];
+static volatile uint32_t g_wr = 0;
+static volatile uint32_t g_rd = 0;      // lo mueve solo Trace_Service / Trace_Clear
+
+static uint8_t g_tx[TRACE_HDR_SIZE + TRACE_TX_RECORDS * sizeof(trace_rec_t)] __attribute__((aligned(4)));
+static bool g_draining = false;
+static bool g_tx_busy = false;
+
+static trace_stats_t g_stats;
+
+void Trace_Init(void)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    Trace_Clear();
+}
+
+void Trace_Clear(void)
+{
+    CRIT_ALLOC();
+    CRIT_ENTER(CRIT_TRACE);
+    g_rd = g_wr;
+    CRIT_EXIT(CRIT_TRACE);
+}
+
+void Trace_Record(uint8_t ev, uint16_t arg)
+{
+    uint32_t ipsr = __get_IPSR();
+    uint8_t ctx;
+
+    if (ipsr != 0u)                 ctx = (uint8_t)(TRACE_CTX_ISR | (ipsr & 0x7Fu));
+    else if (OSTCBCurPtr != NULL)   ctx = (uint8_t)OSTCBCurPtr->Prio;
+    else                            ctx = TRACE_CTX_NONE;
+
+    // PRIMASK guardado: se puede llamar desde adentro de otra sección crítica
+    CRIT_ALLOC();
+    CRIT_ENTER(CRIT_TRACE);
+    uint32_t wr = g_wr;
+    if (wr - g_rd < TRACE_RING_LEN) {
+        trace_rec_t *r = &g_ring[wr & TRACE_MASK];
+        r->cycles = DWT->CYCCNT;
+        r->ev     = ev;
+        r->ctx    = ctx;
+        r->arg    = arg;
+        g_wr = wr + 1u;
+        g_stats.recorded++;
+    } else {
+        g_stats.dropped++;
+    }
+    CRIT_EXIT(CRIT_TRACE);
+}
+
+void Trace_StartDrain(uint32_t baud)
+{
+    uint32_t clk = SystemCoreClock;                         // UART0 va con el clock del core
+    uint32_t sbr = clk / (16u * baud);
+    uint32_t brfa = ((2u * clk) / baud) - 32u * sbr;        // fracción en 1/32
+
+    SIM->SCGC4 |= SIM_SCGC4_UART0_MASK;
+    PORTB->PCR[17] = PORT_PCR_MUX(3);                       // UART0_TX (OpenSDA)
+
+    UART0->C2 = 0;
+    UART0->BDH = UART_BDH_SBR(sbr >> 8);
+    UART0->BDL = UART_BDL_SBR(sbr);
+    UART0->C4 = (UART0->C4 & ~UART_C4_BRFA_MASK) | UART_C4_BRFA(brfa);
+    UART0->C1 = 0;                                          // 8N1
+    UART0->C5 |= UART_C5_TDMAS_MASK;                        // TDRE pide DMA en vez de IRQ
+    UART0->C2 = UART_C2_TE_MASK | UART_C2_TIE_MASK;
+
+    DMA_Init();
+    DMA_SetEnableRequest(TRACE_DMA_CH, false);
+    DMAMUX_ConfigChannel(TRACE_DMA_CH, true, false, kDmaRequestMux0UART0Tx);
+
+    DMA_SetSourceAddrOffset(TRACE_DMA_CH, 1);
+    DMA_SetSourceLastAddrOffset(TRACE_DMA_CH, 0);
+    DMA_SetDestAddr(TRACE_DMA_CH, (uint32_t)&UART0->D);
+    DMA_SetDestAddrOffset(TRACE_DMA_CH, 0);
+    DMA_SetDestLastAddrOffset(TRACE_DMA_CH, 0);
+    DMA_SetSourceTransfSize(TRACE_DMA_CH, DMA_TransSize_8Bit);
+    DMA_SetDestTransfSize(TRACE_DMA_CH, DMA_TransSize_8Bit);
+    DMA_SetMinorLoopTransCount(TRACE_DMA_CH, 1);            // un byte por TDRE
+    DMA0->TCD[TRACE_DMA_CH].CSR = DMA_CSR_DREQ_MASK;        // sin IRQ; ERQ se apaga al final del frame
+
+    g_tx_busy = false;
+    g_draining = true;
+}
+
+static void trace_put32(uint8_t *p, uint32_t v)
+{
+    memcpy(p, &v, sizeof(v));       // el M4 es little endian, como el formato
+}
+
+void Trace_Service(void)
+{
+    if (!g_draining) return;
+    if (g_tx_busy) {
+        if (!(DMA0->TCD[TRACE_DMA_CH].CSR & DMA_CSR_DONE_MASK)) return;
+        g_tx_busy = false;
+    }
+
+    uint32_t rd = g_rd;
+    uint32_t n = g_wr - rd;
+    if (n == 0u) return;
+    if (n > TRACE_TX_RECORDS) n = TRACE_TX_RECORDS;
+
+    trace_put32(&g_tx[0], TRACE_MAGIC);
+    trace_put32(&g_tx[4], n);                               // u16 count + u16 reservado
+    trace_put32(&g_tx[8], g_stats.dropped);
+    trace_put32(&g_tx[12], SystemCoreClock);
+
+    // copia (el ring puede dar la vuelta) y recién ahí se libera
+    uint8_t *dst = &g_tx[TRACE_HDR_SIZE];
+    for (uint32_t i = 0; i < n; i++, dst += sizeof(trace_rec_t)) {
+        memcpy(dst, &g_ring[(rd + i) & TRACE_MASK], sizeof(trace_rec_t));
+    }
+    g_rd = rd + n;
+
+    uint16_t len = (uint16_t)(TRACE_HDR_SIZE + n * sizeof(trace_rec_t));
+    DMA_ClearChannelDoneFlag(TRACE_DMA_CH);
+    DMA_SetSourceAddr(TRACE_DMA_CH, (uint32_t)g_tx);
+    DMA_SetCurrMajorLoopCount(TRACE_DMA_CH, len);
+    DMA_SetStartMajorLoopCount(TRACE_DMA_CH, len);
+    DMA0->TCD[TRACE_DMA_CH].CSR = DMA_CSR_DREQ_MASK;
+    g_tx_busy = true;
+    DMA_SetEnableRequest(TRACE_DMA_CH, true);               // TDRE ya está en 1: arranca
+
+    g_stats.sent += n;
+    g_stats.frames++;
+}
+
+void Trace_GetStats(trace_stats_t *st)
+{
+    if (!st) return;
+
+    CRIT_ALLOC();
+    CRIT_ENTER(CRIT_TRACE);
+    *st = g_stats;
+    CRIT_EXIT(CRIT_TRACE);
+}
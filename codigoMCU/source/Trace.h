@@ -0,0 +1,114 @@
+/**
+ * @file     Trace.h
+ * @brief Cycle-stamped event trace: RAM ring filled from tasks and ISRs,
+ *        drained over UART0 by DMA.
+ *
+ * Each record is (DWT->CYCCNT, event, context, 16-bit argument). The context
+ * is the priority of the running task, or 0x80 | exception number inside an
+ * ISR, so a dump can be split into one timeline per task and per interrupt.
+ * Events are begin/end pairs (a stage) or instants.
+ *
+ * Recording costs a few instructions with interrupts masked; nothing is
+ * printed. ::Trace_Service() sends what was recorded in frames of up to
+ * TRACE_TX_RECORDS records through a DMA channel, one frame at a time, from
+ * a low-priority task. Without draining, the ring keeps the first
+ * TRACE_RING_LEN records after ::Trace_Clear() (read them with the debugger).
+ *
+ * Tests/trace2json.c turns a capture of the UART into Chrome trace JSON
+ * (chrome://tracing, ui.perfetto.dev).
+ *
+ * Frame on the wire (little endian):
+ *   u32 magic "TRC1", u16 count, u16 reserved, u32 dropped, u32 cpu_hz,
+ *   count x { u32 cycles, u8 event | phase << 6, u8 context, u16 arg }
+ *
+ * @author   Grupo 3
+  	  	  	  - Ezequiel Díaz Guzmán
+  	  	  	  - José Iván Hertter
+  	  	  	  - Cristian Damián Meichtry
+  	  	  	  - Lucía Inés Ruiz
+ */
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifndef TRACE_ENABLE
+#define TRACE_ENABLE        1       // 0: los macros no generan código
+#endif
+#define TRACE_RING_LEN      1024u   // records (8 KB); potencia de 2
+#define TRACE_TX_RECORDS    64u     // records por frame de UART
+#define TRACE_UART_BAUD     115200u // el puente del OpenSDA no pasa de acá con seguridad
+#define TRACE_MAGIC         0x31435254u     // "TRC1"
+
+#define TRACE_PH_INSTANT    0u
+#define TRACE_PH_BEGIN      1u
+#define TRACE_PH_END        2u
+
+#define TRACE_CTX_ISR       0x80u   // | número de excepción (16 + IRQn)
+#define TRACE_CTX_NONE      0x7Fu   // antes de que arranque el OS
+
+// Mantener en el mismo orden que k_event_names en Tests/trace2json.c
+typedef enum {
+    TRACE_EV_MARK = 0,          // libre, para depurar
+    TRACE_EV_DECODE,            // MP3Decode() de un frame; fin: bytes consumidos
+    TRACE_EV_DECODE_LOOP,       // MP3Player_DecodeAsMuchAsPossibleToRing(); fin: 1 si avanzó
+    TRACE_EV_SD_READ,           // lectura del mp3 a inbuf; inicio: pedidos, fin: leídos
+    TRACE_EV_AUDIO_ISR,         // callback del DMA de audio; arg: latencia en ticks del PIT
+    TRACE_EV_AUDIO_FILL,        // Audio_Service() llenando un buffer; fin: frames del ring
+    TRACE_EV_COUNT
+} trace_ev_t;
+
+typedef struct {
+    uint32_t cycles;            // DWT->CYCCNT
+    uint8_t  ev;                // trace_ev_t | fase << 6
+    uint8_t  ctx;
+    uint16_t arg;
+} trace_rec_t;
+
+typedef struct {
+    uint32_t recorded;
+    uint32_t dropped;           // ring lleno: el drenaje no da abasto (o no hay)
+    uint32_t sent;              // records que salieron por la UART
+    uint32_t frames;
+} trace_stats_t;
+
+/**
+ * @brief Enables the DWT cycle counter and empties the ring.
+ */
+void Trace_Init(void);
+
+void Trace_Clear(void);
+
+/**
+ * @brief Appends one record. Callable from tasks and ISRs (any priority).
+ */
+void Trace_Record(uint8_t ev, uint16_t arg);
+
+/**
+ * @brief Sets UART0 (PTB17 TX, 8N1 at @p baud) and DMA channel 3 for
+ *        ::Trace_Service(). UART0 is the debug console too: do not print
+ *        on it while draining.
+ */
+void Trace_StartDrain(uint32_t baud);
+
+/**
+ * @brief Starts the next frame once the previous one left. Call it
+ *        periodically from a low-priority task.
+ */
+void Trace_Service(void);
+
+void Trace_GetStats(trace_stats_t *st);
+
+#if TRACE_ENABLE && !defined(HOST_BUILD)
+#define TRACE_BEGIN(ev, arg)    Trace_Record((uint8_t)((ev) | (TRACE_PH_BEGIN << 6)), (uint16_t)(arg))
+#define TRACE_END(ev, arg)      Trace_Record((uint8_t)((ev) | (TRACE_PH_END << 6)), (uint16_t)(arg))
+#define TRACE_INSTANT(ev, arg)  Trace_Record((uint8_t)(ev), (uint16_t)(arg))
+#else
+#define TRACE_BEGIN(ev, arg)    do { (void)(arg); } while (0)
+#define TRACE_END(ev, arg)      do { (void)(arg); } while (0)
+#define TRACE_INSTANT(ev, arg)  do { (void)(arg); } while (0)
+#endif
+
+#endif /* TRACE_H_ */
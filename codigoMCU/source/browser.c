@@ -0,0 +1,382 @@
+/**
+ * @file     browser.c
+ * @brief    Folder browsing with lazy directory enumeration.
+ *
+ * Cursor positions are split in two parts: a fixed prefix (the library
+ * tracks in the root, the ".." entry elsewhere) and the enumeration index of
+ * the directory itself, i.e. the n-th visible entry returned by f_readdir().
+ *
+ * @author   Grupo 3
+ */
+
+#include "browser.h"
+#include "mp3_player.h"
+#include <string.h>
+#include <ctype.h>
+
+#define BROWSER_ROOT            "0:/"
+#define BROWSER_UNKNOWN         0xFFFFFFFFu
+#define BROWSER_FLAG_DIR        0x01u
+
+// Listado cacheado: ventana de entradas consecutivas, empaquetadas [len][flags][chars]
+typedef struct {
+    uint32_t id;            // start cluster + 1 (0 = slot libre)
+    uint32_t stamp;         // LRU
+    uint32_t count;         // entradas del directorio, BROWSER_UNKNOWN hasta llegar al final
+    uint32_t cursor;        // última posición del cursor en este directorio
+    uint32_t first;         // índice de la primera entrada de la ventana
+    uint16_t used;          // bytes usados del arena
+    uint8_t  n;             // entradas en la ventana
+    uint8_t  arena[BROWSER_ARENA_SIZE];
+} browser_listing_t;
+
+static browser_listing_t g_cache[BROWSER_CACHE_DIRS];
+static uint32_t g_clock = 0;
+
+// Directorio actual
+static char g_path[LIBRARY_PATH_LEN];
+static uint32_t g_depth = 0;
+static uint32_t g_stack[BROWSER_MAX_DEPTH];     // cursor del padre en cada nivel
+static DIR g_dp;
+static FILINFO g_fno;
+static browser_listing_t *g_list = NULL;
+static uint32_t g_next = 0;                     // índice que devuelve el próximo f_readdir
+static uint32_t g_base = 0;                     // entradas antes de la enumeración (tracks o "..")
+static uint32_t g_pos = 0;
+static bool g_root_files = false;               // sin índice todavía: el root lista sus mp3
+
+static browser_entry_t g_cur;
+static volatile bool g_cur_valid = false;
+
+/*******************************************************************************
+ * Listing cache
+ ******************************************************************************/
+
+// Descarta lo enumerado; el cursor se conserva
+static void listing_forget(browser_listing_t *l)
+{
+    l->count = BROWSER_UNKNOWN;
+    l->first = 0;
+    l->used  = 0;
+    l->n     = 0;
+}
+
+// FAT no actualiza la fecha de un directorio cuando cambia su contenido: los listados se
+// descartan al montar (Browser_Init) y cuando se publica el índice (Browser_Refresh)
+static void listing_forget_all(void)
+{
+    for (uint32_t i = 0; i < BROWSER_CACHE_DIRS; i++) listing_forget(&g_cache[i]);
+}
+
+static browser_listing_t *listing_get(uint32_t id)
+{
+    browser_listing_t *victim = &g_cache[0];
+
+    for (uint32_t i = 0; i < BROWSER_CACHE_DIRS; i++) {
+        browser_listing_t *l = &g_cache[i];
+        if (l->id == id) {
+            l->stamp = ++g_clock;
+            return l;
+        }
+        if (l->id == 0u || (victim->id != 0u && l->stamp < victim->stamp)) victim = l;
+    }
+
+    victim->id     = id;
+    victim->stamp  = ++g_clock;
+    victim->cursor = 0;
+    listing_forget(victim);
+    return victim;
+}
+
+static bool window_find(const browser_listing_t *l, uint32_t idx, browser_entry_t *e)
+{
+    if (idx < l->first || idx >= l->first + l->n) return false;
+
+    const uint8_t *p = l->arena;
+    for (uint32_t i = l->first; i < idx; i++) p += 2u + p[0];
+
+    memcpy(e->name, &p[2], p[0]);
+    e->name[p[0]] = '\0';
+    e->title[0] = '\0';
+    e->is_dir = (p[1] & BROWSER_FLAG_DIR) != 0u;
+    return true;
+}
+
+static void window_drop_first(browser_listing_t *l)
+{
+    uint16_t sz = (uint16_t)(2u + l->arena[0]);
+    memmove(l->arena, &l->arena[sz], l->used - sz);
+    l->used -= sz;
+    l->first++;
+    l->n--;
+}
+
+// La ventana se desliza: guarda las últimas BROWSER_WINDOW entradas leídas
+static void window_store(browser_listing_t *l, uint32_t idx, const char *name, bool is_dir)
+{
+    uint32_t len = strlen(name);
+    uint32_t sz = 2u + len;
+
+    if (sz > BROWSER_ARENA_SIZE) return;
+    if (l->n == 0u || idx != l->first + l->n) {
+        l->first = idx;
+        l->used  = 0;
+        l->n     = 0;
+    }
+    while (l->n > 0u && (l->n >= BROWSER_WINDOW || l->used + sz > BROWSER_ARENA_SIZE)) {
+        window_drop_first(l);
+    }
+
+    uint8_t *p = &l->arena[l->used];
+    p[0] = (uint8_t)len;
+    p[1] = is_dir ? BROWSER_FLAG_DIR : 0u;
+    memcpy(&p[2], name, len);
+    l->used += (uint16_t)sz;
+    l->n++;
+}
+
+/*******************************************************************************
+ * Lazy enumeration
+ ******************************************************************************/
+
+static bool visible(const FILINFO *fno)
+{
+    if (fno->fattrib & (AM_HID | AM_SYS)) return false;
+    if (fno->fattrib & AM_DIR) return (fno->fname[0] != '.');
+    // en el root los tracks salen del índice de la biblioteca; mientras se arma el primero
+    // se listan en orden de directorio
+    return (g_depth > 0u || g_root_files) && is_mp3_file(fno->fname);
+}
+
+static bool read_entry(uint32_t idx, browser_entry_t *e)
+{
+    if (window_find(g_list, idx, e)) return true;
+    if (g_list->count != BROWSER_UNKNOWN && idx >= g_list->count) return false;
+
+    if (idx < g_next) {
+        // hacia atrás fuera de la ventana: rewind y volver a leer
+        if (f_readdir(&g_dp, NULL) != FR_OK) return false;
+        g_next = 0;
+    }
+
+    while (1) {
+        if (f_readdir(&g_dp, &g_fno) != FR_OK) return false;
+        if (g_fno.fname[0] == 0) {
+            g_list->count = g_next;
+            return false;
+        }
+        if (!visible(&g_fno)) continue;
+
+        bool is_dir = (g_fno.fattrib & AM_DIR) != 0u;
+        window_store(g_list, g_next, g_fno.fname, is_dir);
+        if (g_next++ == idx) {
+            strncpy(e->name, g_fno.fname, LIBRARY_NAME_LEN - 1u);
+            e->name[LIBRARY_NAME_LEN - 1u] = '\0';
+            e->title[0] = '\0';
+            e->is_dir = is_dir;
+            return true;
+        }
+    }
+}
+
+static uint32_t listing_count(void)
+{
+    browser_entry_t e;
+
+    // hay que llegar al final una vez; después queda cacheado
+    while (g_list->count == BROWSER_UNKNOWN) {
+        if (!read_entry(g_next, &e)) break;
+    }
+    return (g_list->count == BROWSER_UNKNOWN) ? 0u : g_list->count;
+}
+
+static bool entry_at(uint32_t pos, browser_entry_t *e)
+{
+    if (pos < g_base) {
+        if (g_depth > 0u) {
+            strcpy(e->name, BROWSER_PARENT_NAME);
+            e->title[0] = '\0';
+            e->is_dir = true;
+            return true;
+        }
+        const library_track_t *t = Library_Get(pos);
+        if (!t) return false;
+        strcpy(e->name, t->name);
+        strcpy(e->title, t->title);     // del índice: el tag no se vuelve a leer
+        e->is_dir = false;
+        return true;
+    }
+    return read_entry(pos - g_base, e);
+}
+
+static bool load(uint32_t pos)
+{
+    browser_entry_t e;
+
+    // si la posición no existe el cursor queda donde estaba
+    if (!entry_at(pos, &e)) return false;
+    g_cur_valid = false;
+    g_cur = e;
+    g_pos = pos;
+    g_list->cursor = pos;
+    g_cur_valid = true;
+    return true;
+}
+
+static bool open_dir(uint32_t pos)
+{
+    f_closedir(&g_dp);
+    g_cur_valid = false;
+    if (f_opendir(&g_dp, g_path) != FR_OK) return false;
+
+    g_list = listing_get(g_dp.obj.sclust + 1u);
+    g_next = 0;
+    g_base = (g_depth > 0u) ? 1u : Library_Count();
+    if (g_depth == 0u && g_root_files != (g_base == 0u)) {
+        listing_forget(g_list);
+        g_root_files = (g_base == 0u);
+    }
+
+    if (pos == BROWSER_UNKNOWN) pos = g_list->cursor;
+    if (!load(pos)) (void)load(0);
+    return true;
+}
+
+/*******************************************************************************
+ * API
+ ******************************************************************************/
+
+bool Browser_Init(void)
+{
+    // tarjeta recién montada: puede ser otra, o haber cambiado afuera
+    memset(g_cache, 0, sizeof(g_cache));
+    g_list = NULL;
+    strcpy(g_path, BROWSER_ROOT);
+    g_depth = 0;
+    return open_dir(0);
+}
+
+bool Browser_Next(void)
+{
+    if (load(g_pos + 1u)) return true;
+    return load(0);
+}
+
+bool Browser_NextTrack(void)
+{
+    browser_entry_t e;
+
+    // sin wrap: al final del listado el álbum terminó
+    for (uint32_t pos = g_pos + 1u; entry_at(pos, &e); pos++) {
+        if (!e.is_dir) return load(pos);
+    }
+    return false;
+}
+
+bool Browser_Prev(void)
+{
+    if (g_pos > 0u) return load(g_pos - 1u);
+
+    uint32_t total = g_base + listing_count();
+    return (total > 0u) ? load(total - 1u) : false;
+}
+
+bool Browser_JumpLetter(void)
+{
+    if (!g_cur_valid) return false;
+
+    // tracks del root: búsqueda en el índice ordenado; después de la última letra, las carpetas
+    if (g_depth == 0u && g_pos < g_base) {
+        uint32_t next = Library_NextLetter(g_pos);
+        if (next < g_base) return load(next);
+        return load(g_base) || load(0);
+    }
+
+    // carpetas: avance lineal, el listado está en orden de directorio
+    browser_entry_t e;
+    int c = tolower((unsigned char)g_cur.name[0]);
+    for (uint32_t pos = g_pos + 1u; entry_at(pos, &e); pos++) {
+        if (tolower((unsigned char)e.name[0]) != c) return load(pos);
+    }
+    return load(0);
+}
+
+bool Browser_Enter(void)
+{
+    if (!g_cur_valid || !g_cur.is_dir) return false;
+    if (strcmp(g_cur.name, BROWSER_PARENT_NAME) == 0) return Browser_Up();
+    if (g_depth >= BROWSER_MAX_DEPTH) return false;
+
+    size_t pl = strlen(g_path);
+    size_t nl = strlen(g_cur.name);
+    bool slash = (g_path[pl - 1u] == '/');
+    if (pl + nl + (slash ? 0u : 1u) + 1u > sizeof(g_path)) return false;
+
+    if (!slash) g_path[pl++] = '/';
+    memcpy(&g_path[pl], g_cur.name, nl + 1u);
+
+    g_stack[g_depth++] = g_pos;
+    return open_dir(BROWSER_UNKNOWN);
+}
+
+bool Browser_Up(void)
+{
+    if (g_depth == 0u) return false;
+
+    char *slash = strrchr(g_path, '/');
+    if (slash == &g_path[sizeof(BROWSER_ROOT) - 2u]) slash[1] = '\0';   // "0:/x" -> "0:/"
+    else *slash = '\0';
+
+    return open_dir(g_stack[--g_depth]);
+}
+
+void Browser_Refresh(void)
+{
+    listing_forget_all();
+    if (g_depth > 0u) {
+        g_next = BROWSER_UNKNOWN;
+        (void)load(g_pos);
+        return;
+    }
+
+    // cambió el índice: las carpetas del root se corren (y se vuelven a contar), los tracks
+    // se buscan por nombre
+    uint32_t old_base = g_base;
+    uint32_t pos = g_pos;
+    bool old_files = g_root_files;
+    g_base = Library_Count();
+    g_root_files = (g_base == 0u);
+    if (!g_list) return;
+    g_next = BROWSER_UNKNOWN;       // fuerza el rewind en la próxima lectura
+
+    if (g_cur_valid && !g_cur.is_dir && (pos < old_base || old_files)) {
+        pos = Library_FindPrefix(g_cur.name);
+    } else if (old_files != g_root_files) {
+        pos = g_base;               // el listado interino mezclaba tracks y carpetas
+    } else if (pos >= old_base) {
+        pos = pos - old_base + g_base;
+    }
+
+    if (!load(pos)) (void)load(0);
+}
+
+const browser_entry_t *Browser_Current(void)
+{
+    return g_cur_valid ? &g_cur : NULL;
+}
+
+bool Browser_GetPath(char *path, uint32_t len)
+{
+    if (!g_cur_valid || g_cur.is_dir) return false;
+    return Library_GetPathFor(g_path, g_cur.name, path, len);
+}
+
+bool Browser_GetPathAt(int32_t delta, char *path, uint32_t len)
+{
+    browser_entry_t e;
+
+    if (!g_cur_valid) return false;
+    if (delta < 0 && (uint32_t)(-delta) > g_pos) return false;
+    if (!entry_at(g_pos + (uint32_t)delta, &e) || e.is_dir) return false;
+    return Library_GetPathFor(g_path, e.name, path, len);
+}
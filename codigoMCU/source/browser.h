@@ -0,0 +1,105 @@
+/**
+ * @file     browser.h
+ * @brief    Folder browsing with lazy directory enumeration.
+ *
+ * Only the directory under the cursor is ever open. Its entries are read with
+ * f_readdir() on demand, in directory order, as the cursor moves; nothing is
+ * enumerated ahead of time and the tree is never walked as a whole.
+ *
+ * The root listing is the sorted track index of ::library.h followed by the
+ * root subfolders. Every other listing starts with a ".." entry (entering it
+ * goes back to the parent) followed by subfolders and .mp3 files.
+ *
+ * The last ::BROWSER_CACHE_DIRS visited listings keep, in a small packed
+ * arena of length-prefixed names, a window of the entries read last, their
+ * entry count once known and the cursor position, so going back and forth
+ * between a folder and its parent does not re-read the card. A listing is
+ * keyed on the folder's start cluster. FAT does not touch a folder's date
+ * when its entries change, so listings are dropped on every mount
+ * (::Browser_Init()) and whenever the index is published (::Browser_Refresh()).
+ * Until the first index is published the root lists its mp3 files in
+ * directory order, so a fresh card is browsable while it is being indexed.
+ *
+ * @note Not thread safe: every call except ::Browser_Current() must be
+ *       serialized with the ::library.h calls (App.c holds LibMutex).
+ *
+ * @author   Grupo 3
+ */
+
+#ifndef BROWSER_H_
+#define BROWSER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "library.h"
+
+#define BROWSER_MAX_DEPTH       8u          // folder levels below the root
+#define BROWSER_CACHE_DIRS      4u          // recently visited listings kept in RAM
+#define BROWSER_WINDOW          8u          // entries cached per listing
+#define BROWSER_ARENA_SIZE      512u        // packed names per listing
+#define BROWSER_PARENT_NAME     ".."
+
+typedef struct {
+    char name[LIBRARY_NAME_LEN];
+    char title[ID3_TEXT_LEN];       // ID3 title of indexed tracks, "" otherwise
+    bool is_dir;
+} browser_entry_t;
+
+/**
+ * @brief Opens the root directory with the cursor on the first entry.
+ *        Library_Init() must have been called.
+ */
+bool Browser_Init(void);
+
+/**
+ * @brief Moves the cursor one entry forward / back, wrapping around.
+ */
+bool Browser_Next(void);
+bool Browser_Prev(void);
+
+/**
+ * @brief Moves the cursor to the next track in the current folder, skipping
+ *        folders, without wrapping. Used to queue the next song.
+ * @return false (cursor unchanged) if there are no more tracks.
+ */
+bool Browser_NextTrack(void);
+
+/**
+ * @brief Moves the cursor to the first entry whose initial differs from the
+ *        current one (next letter). Wraps to the first entry.
+ */
+bool Browser_JumpLetter(void);
+
+/**
+ * @brief Enters the folder under the cursor (or the parent for "..").
+ * @return false if the cursor is not on a folder or the path is too deep.
+ */
+bool Browser_Enter(void);
+
+/**
+ * @brief Goes back to the parent folder, restoring its cursor.
+ */
+bool Browser_Up(void);
+
+/**
+ * @brief Re-reads the entry under the cursor after the library index changed.
+ */
+void Browser_Refresh(void);
+
+/**
+ * @brief Entry under the cursor (RAM copy, safe from any task). NULL if empty.
+ */
+const browser_entry_t *Browser_Current(void);
+
+/**
+ * @brief Builds the full path of the entry under the cursor into @p path.
+ */
+bool Browser_GetPath(char *path, uint32_t len);
+
+/**
+ * @brief Same for the entry @p delta positions away from the cursor, without
+ *        moving it (no wrap). false for folders or past either end.
+ */
+bool Browser_GetPathAt(int32_t delta, char *path, uint32_t len);
+
+#endif /* BROWSER_H_ */
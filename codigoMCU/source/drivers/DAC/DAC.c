@@ -21,11 +21,8 @@ void DAC_Init (DAC_t dac)
 		SIM->SCGC2 |= SIM_SCGC2_DAC1_MASK;
 	}
 
-	if(dac == DAC0){
-		dac->C0 = DAC_C0_DACEN_MASK | DAC_C0_DACRFS_MASK ;
-	}
-	else if(dac == DAC1)			
-		dac->C0 &= ~DAC_C0_DACEN_MASK;
+	// los dos con la misma referencia (VDDA): L y R con la misma escala
+	dac->C0 = DAC_C0_DACEN_MASK | DAC_C0_DACRFS_MASK ;
 
 }
 
@@ -16,10 +16,12 @@ void DMA_Init(){
     // Limpiar todos los eventos pendientes
     NVIC_ClearPendingIRQ(DMA0_IRQn);
     NVIC_ClearPendingIRQ(DMA1_IRQn);
+    NVIC_ClearPendingIRQ(DMA2_IRQn);
 
     // Interrupciones DMA
     NVIC_EnableIRQ(DMA0_IRQn);
     NVIC_EnableIRQ(DMA1_IRQn);
+    NVIC_EnableIRQ(DMA2_IRQn);
 }
 
 void DMA_StartTransfer(DMAChannel_t channel){
@@ -146,6 +148,14 @@ uint32_t DMA_GetMinorLoopTransCount(DMAChannel_t channel){
 	return DMA0->TCD[channel].NBYTES_MLOFFNO;  // contador para loop chikito
 }
 
+void DMA_SetMinorLoopDestOffset(DMAChannel_t channel, uint32_t MLsize, int32_t offset){
+	// con EMLM el NBYTES de los canales sin SMLOE/DMLOE sigue siendo el mismo (30 bits)
+	DMA0->CR |= DMA_CR_EMLM_MASK;
+	DMA0->TCD[channel].NBYTES_MLOFFYES = DMA_NBYTES_MLOFFYES_DMLOE_MASK |
+	                                     DMA_NBYTES_MLOFFYES_MLOFF(offset) |
+	                                     DMA_NBYTES_MLOFFYES_NBYTES(MLsize);  // al terminar cada minor loop, DADDR += offset
+}
+
 
 void DMA_SetCurrMajorLoopCount(DMAChannel_t channel, uint16_t count){
 	DMA0->TCD[channel].CITER_ELINKNO = count & DMA_CITER_ELINKNO_CITER_MASK; //setea loop grande
@@ -193,3 +203,14 @@ void DMA1_IRQHandler(){
 	}
 	OSIntExit();
 }
+
+void DMA2_IRQHandler(){
+	OSIntEnter();
+
+	if (DMA0->INT & (1u << 2)) {
+		DMA_ClearChannelDoneFlag(DMA_CH2);
+		DMA_ClearChannelIntFlag(DMA_CH2);
+		if (callback[2]) callback[2]();
+	}
+	OSIntExit();
+}
@@ -272,6 +272,19 @@ void DMA_SetMinorLoopTransCount(DMAChannel_t channel, uint32_t MLsize);
  */
 uint32_t DMA_GetMinorLoopTransCount(DMAChannel_t channel);
 
+/**
+ * @brief Configura el minor loop con offset de destino para un canal DMA
+ *
+ * Habilita los offsets de minor loop (DMA_CR_EMLM, global). Sirve para
+ * escribir varios registros por request y volver al primero: DOFF los
+ * recorre y @p offset deshace el avance al terminar el minor loop.
+ *
+ * @param channel Canal DMA
+ * @param MLsize Bytes por minor loop
+ * @param offset Se suma a la dirección de destino al terminar cada minor loop
+ */
+void DMA_SetMinorLoopDestOffset(DMAChannel_t channel, uint32_t MLsize, int32_t offset);
+
 /**
  * @brief Configura el contador de major loop actual para un canal DMA
  *
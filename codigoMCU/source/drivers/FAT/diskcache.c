@@ -0,0 +1,128 @@
+/***************************************************************************//**
+  @file     diskcache.c
+  @brief    N-way LRU sector cache for FatFs metadata (FAT + directory sectors)
+  @author   Grupo 3
+ ******************************************************************************/
+
+#include "diskcache.h"
+#include <string.h>
+#include "source/drivers/SD/sd.h"
+
+#if ((DISKCACHE_SETS & (DISKCACHE_SETS - 1u)) != 0u)
+#error "DISKCACHE_SETS must be a power of 2"
+#endif
+
+#if (DISKCACHE_WAYS == 0u)
+#error "DISKCACHE_WAYS must be at least 1"
+#endif
+
+#define DISKCACHE_SET_MASK  (DISKCACHE_SETS - 1u)
+#define DISKCACHE_INVALID   0xFFFFFFFFu
+
+typedef struct {
+    DWORD    sector;        // DISKCACHE_INVALID if empty
+    uint32_t stamp;         // last access time (bigger = more recent)
+} diskcache_tag_t;
+
+static diskcache_tag_t g_tags[DISKCACHE_SETS][DISKCACHE_WAYS];
+static uint32_t g_data[DISKCACHE_SETS][DISKCACHE_WAYS][SD_BLOCK_SIZE / 4] __attribute__((aligned(4)));
+
+static uint32_t g_clock = 0;
+static const BYTE *g_win = NULL;
+static diskcache_stats_t g_stats;
+
+static inline uint32_t set_of(DWORD sector)
+{
+    return (uint32_t)sector & DISKCACHE_SET_MASK;
+}
+
+static int find_way(uint32_t set, DWORD sector)
+{
+    for (uint32_t w = 0; w < DISKCACHE_WAYS; w++) {
+        if (g_tags[set][w].sector == sector) return (int)w;
+    }
+    return -1;
+}
+
+void diskcache_init(void)
+{
+    for (uint32_t s = 0; s < DISKCACHE_SETS; s++) {
+        for (uint32_t w = 0; w < DISKCACHE_WAYS; w++) {
+            g_tags[s][w].sector = DISKCACHE_INVALID;
+            g_tags[s][w].stamp  = 0;
+        }
+    }
+    g_clock = 0;
+    memset(&g_stats, 0, sizeof(g_stats));
+}
+
+void diskcache_set_window(const BYTE *win)
+{
+    g_win = win;
+}
+
+bool diskcache_is_metadata(const BYTE *buff, UINT count)
+{
+    return (g_win != NULL) && (buff == g_win) && (count == 1u);
+}
+
+bool diskcache_lookup(DWORD sector, BYTE *buff)
+{
+    uint32_t set = set_of(sector);
+    int w = find_way(set, sector);
+
+    if (w < 0) {
+        g_stats.misses++;
+        return false;
+    }
+
+    g_tags[set][w].stamp = ++g_clock;
+    memcpy(buff, g_data[set][w], SD_BLOCK_SIZE);
+    g_stats.hits++;
+    return true;
+}
+
+void diskcache_insert(DWORD sector, const BYTE *buff)
+{
+    uint32_t set = set_of(sector);
+    int w = find_way(set, sector);
+
+    if (w < 0) {
+        // way libre o el menos usado recientemente
+        uint32_t victim = 0;
+        for (uint32_t i = 0; i < DISKCACHE_WAYS; i++) {
+            if (g_tags[set][i].sector == DISKCACHE_INVALID) { victim = i; break; }
+            if (g_tags[set][i].stamp < g_tags[set][victim].stamp) victim = i;
+        }
+        if (g_tags[set][victim].sector != DISKCACHE_INVALID) g_stats.evictions++;
+        w = (int)victim;
+    }
+
+    memcpy(g_data[set][w], buff, SD_BLOCK_SIZE);
+    g_tags[set][w].sector = sector;
+    g_tags[set][w].stamp  = ++g_clock;
+}
+
+void diskcache_write_through(DWORD sector, const BYTE *buff, UINT count)
+{
+    while (count--) {
+        uint32_t set = set_of(sector);
+        int w = find_way(set, sector);
+        if (w >= 0) {
+            memcpy(g_data[set][w], buff, SD_BLOCK_SIZE);
+            g_stats.write_updates++;
+        }
+        buff += SD_BLOCK_SIZE;
+        sector++;
+    }
+}
+
+void diskcache_count_bypass(void)
+{
+    g_stats.bypass++;
+}
+
+void diskcache_get_stats(diskcache_stats_t *st)
+{
+    if (st) *st = g_stats;
+}
@@ -0,0 +1,88 @@
+/***************************************************************************//**
+  @file     diskcache.h
+  @brief    N-way LRU sector cache for FatFs metadata (FAT + directory sectors)
+  @author   Grupo 3
+ ******************************************************************************/
+
+#ifndef DISKCACHE_H_
+#define DISKCACHE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ff.h"
+
+/*******************************************************************************
+ * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
+ ******************************************************************************/
+
+// Tamaño del cache, fijo en compilación: SETS * WAYS sectores de 512 bytes
+#ifndef DISKCACHE_SETS
+#define DISKCACHE_SETS      4u      // must be a power of 2
+#endif
+
+#ifndef DISKCACHE_WAYS
+#define DISKCACHE_WAYS      4u      // entries per set (LRU replacement inside the set)
+#endif
+
+#define DISKCACHE_SECTORS   (DISKCACHE_SETS * DISKCACHE_WAYS)
+
+/*******************************************************************************
+ * ENUMERATIONS AND STRUCTURES AND TYPEDEFS
+ ******************************************************************************/
+
+typedef struct {
+    uint32_t hits;          // metadata reads served from RAM
+    uint32_t misses;        // metadata reads that went to the card
+    uint32_t bypass;        // data reads that skipped the cache
+    uint32_t evictions;     // valid entries replaced by LRU
+    uint32_t write_updates; // writes that refreshed a cached sector
+} diskcache_stats_t;
+
+/*******************************************************************************
+ * FUNCTION PROTOTYPES WITH GLOBAL SCOPE
+ ******************************************************************************/
+
+/**
+ * @brief Drops every cached sector and resets the counters.
+ */
+void diskcache_init(void);
+
+/**
+ * @brief Registers the FatFs window buffer (FATFS.win) of the mounted volume.
+ *
+ * FatFs reads FAT and directory sectors through its window only, while file
+ * data goes straight to the caller's buffer or to FIL.buf (FF_FS_TINY == 0).
+ * Single-sector reads whose destination is this window are treated as
+ * metadata and cached; everything else bypasses the cache.
+ */
+void diskcache_set_window(const BYTE *win);
+
+/**
+ * @brief True if a read of @p count sectors into @p buff should use the cache.
+ */
+bool diskcache_is_metadata(const BYTE *buff, UINT count);
+
+/**
+ * @brief Looks up a sector. On a hit copies 512 bytes into @p buff.
+ * @return true on hit.
+ */
+bool diskcache_lookup(DWORD sector, BYTE *buff);
+
+/**
+ * @brief Stores a sector just read from the card (replaces the LRU way).
+ */
+void diskcache_insert(DWORD sector, const BYTE *buff);
+
+/**
+ * @brief Write-through hook: refreshes any cached copy of the written sectors.
+ */
+void diskcache_write_through(DWORD sector, const BYTE *buff, UINT count);
+
+/**
+ * @brief Counts a read that bypassed the cache (bulk file data).
+ */
+void diskcache_count_bypass(void);
+
+void diskcache_get_stats(diskcache_stats_t *st);
+
+#endif /* DISKCACHE_H_ */
@@ -9,14 +9,16 @@
 
 #include "ff.h"			/* Obtains integer types */
 #include "diskio.h"		/* Declarations of disk functions */
-#include "source/drivers/SD/sd.h"
-#include <string.h>
-
-static sd_card_t sd_card;
-static DSTATUS sd_stat = STA_NOINIT;
-
-/* Buffer alineado para DATPORT (512 bytes) */
-static uint32_t sd_bounce[SD_BLOCK_SIZE / 4] __attribute__((aligned(4)));
+#include "diskcache.h"	/* Metadata sector cache */
+#include "diskio_backend.h"	/* SD card / host image backends */
+#include <stddef.h>
+
+#ifdef HOST_BUILD
+static const diskio_backend_t *backend = NULL;	/* diskio_image_open() */
+#else
+static const diskio_backend_t *backend = &diskio_sd_backend;
+#endif
+static DSTATUS disk_stat = STA_NOINIT;
 
 
 /* Definitions of physical drive number for each drive */
@@ -25,6 +27,22 @@ static uint32_t sd_bounce[SD_BLOCK_SIZE / 4] __attribute__((aligned(4)));
 //#define DEV_USB		2	/* Example: Map USB MSD to physical drive 2 */
 
 
+/*-----------------------------------------------------------------------*/
+/* Backend selection                                                     */
+/*-----------------------------------------------------------------------*/
+
+void disk_set_backend(const diskio_backend_t *be)
+{
+    backend   = be;
+    disk_stat = STA_NOINIT;
+}
+
+const diskio_backend_t *disk_get_backend(void)
+{
+    return backend;
+}
+
+
 /*-----------------------------------------------------------------------*/
 /* Get Drive Status                                                      */
 /*-----------------------------------------------------------------------*/
@@ -34,7 +52,7 @@ DSTATUS disk_status (BYTE pdrv)
     if (pdrv != DEV_MMC)
         return STA_NOINIT;
 
-    return sd_stat;
+    return disk_stat;
 }
 
 /*-----------------------------------------------------------------------*/
@@ -43,17 +61,16 @@ DSTATUS disk_status (BYTE pdrv)
 
 DSTATUS disk_initialize (BYTE pdrv)
 {
-    if (pdrv != DEV_MMC)
+    if (pdrv != DEV_MMC || backend == NULL)
         return STA_NOINIT;
 
-    sd_error_t err = sd_init(&sd_card);
-    if (err != SD_OK) {
-        sd_stat = STA_NOINIT;
-        return sd_stat;
-    }
+    disk_stat = backend->init();
+    if (disk_stat & STA_NOINIT)
+        return disk_stat;
+
+    diskcache_init();
 
-    sd_stat = 0;   // drive ready
-    return sd_stat;
+    return disk_stat;
 }
 
 
@@ -62,36 +79,26 @@ DSTATUS disk_initialize (BYTE pdrv)
 /* Read Sector(s)                                                        */
 /*-----------------------------------------------------------------------*/
 
-static volatile sd_error_t g_last_sd_err;
-static volatile DWORD g_last_sector;
-static volatile UINT g_last_count;
-
 DRESULT disk_read(BYTE pdrv, BYTE *buff, DWORD sector, UINT count)
 {
     if (pdrv != DEV_MMC || count == 0) return RES_PARERR;
-    if (sd_stat & STA_NOINIT) return RES_NOTRDY;
-
-    g_last_sector = sector;
-    g_last_count  = count;
-
-    while (count--)
-    {
-        sd_error_t e;
-
-        if (((uintptr_t)buff & 0x3u) == 0u) {
-            e = sd_read_blocks(&sd_card, sector, (uint32_t*)buff, 1);
-        } else {
-            e = sd_read_blocks(&sd_card, sector, sd_bounce, 1);
-            if (e == SD_OK) memcpy(buff, sd_bounce, 512);
-        }
+    if (disk_stat & STA_NOINIT) return RES_NOTRDY;
+
+    // FAT/directorio: se sirve desde el cache; datos de audio van directo al backend
+    bool cacheable = diskcache_is_metadata(buff, count);
+    if (cacheable) {
+        if (diskcache_lookup(sector, buff)) return RES_OK;
+    } else {
+        diskcache_count_bypass();
+    }
 
-        if (e != SD_OK) {
-            g_last_sd_err = e;
-            return RES_ERROR;
-        }
+    DRESULT res = backend->read(buff, sector, count);
+    if (res != RES_OK)
+        return res;
 
-        buff += 512;
-        sector++;
+    if (cacheable) {
+        for (UINT i = 0; i < count; i++)
+            diskcache_insert(sector + i, buff + i * FF_MIN_SS);
     }
 
     return RES_OK;
@@ -115,20 +122,14 @@ DRESULT disk_write (
     if (pdrv != DEV_MMC || !count)
         return RES_PARERR;
 
-    if (sd_stat & STA_NOINIT)
+    if (disk_stat & STA_NOINIT)
         return RES_NOTRDY;
 
-    while (count--)
-    {
-        memcpy(sd_bounce, buff, SD_BLOCK_SIZE);
-
-        sd_error_t err = sd_write_blocks(&sd_card, sector, sd_bounce, 1);
-        if (err != SD_OK)
-            return RES_ERROR;
+    DRESULT res = backend->write(buff, sector, count);
+    if (res != RES_OK)
+        return res;
 
-        buff   += SD_BLOCK_SIZE;
-        sector += 1;
-    }
+    diskcache_write_through(sector, buff, count);
 
     return RES_OK;
 }
@@ -148,29 +149,10 @@ DRESULT disk_ioctl (
     if (pdrv != DEV_MMC)
         return RES_PARERR;
 
-    if (sd_stat & STA_NOINIT)
+    if (disk_stat & STA_NOINIT)
         return RES_NOTRDY;
 
-    switch (cmd)
-    {
-    case CTRL_SYNC:
-        return RES_OK;
-
-    case GET_SECTOR_SIZE:
-        *(WORD*)buff = SD_BLOCK_SIZE;
-        return RES_OK;
-
-    case GET_BLOCK_SIZE:
-
-        *(DWORD*)buff = 1;
-        return RES_OK;
-
-    case GET_SECTOR_COUNT:
-
-        return RES_PARERR;
-    }
-
-    return RES_PARERR;
+    return backend->ioctl(cmd, buff);
 }
 
 
@@ -0,0 +1,64 @@
+/***************************************************************************//**
+  @file     diskio_backend.h
+  @brief    Pluggable storage backend behind the FatFs diskio glue
+  @author   Grupo 3
+ ******************************************************************************/
+
+#ifndef DISKIO_BACKEND_H_
+#define DISKIO_BACKEND_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ff.h"
+#include "diskio.h"
+#ifndef HOST_BUILD
+#include "source/drivers/SD/sd.h"
+#endif
+
+/*******************************************************************************
+ * ENUMERATIONS AND STRUCTURES AND TYPEDEFS
+ ******************************************************************************/
+
+/**
+ * diskio.c keeps the FatFs entry points, the parameter checks and the
+ * metadata cache; a backend only moves 512-byte sectors. Builds for the K64
+ * default to ::diskio_sd_backend. Host builds (HOST_BUILD defined) have no
+ * default and must register one, e.g. through diskio_image_open().
+ */
+typedef struct {
+    const char *name;
+    DSTATUS (*init)(void);
+    DRESULT (*read)(BYTE *buff, DWORD sector, UINT count);
+    DRESULT (*write)(const BYTE *buff, DWORD sector, UINT count);
+    DRESULT (*ioctl)(BYTE cmd, void *buff);
+} diskio_backend_t;
+
+/*******************************************************************************
+ * VARIABLE PROTOTYPES WITH GLOBAL SCOPE
+ ******************************************************************************/
+
+#ifndef HOST_BUILD
+extern const diskio_backend_t diskio_sd_backend;     // SDHC + sd.c (diskio_sd.c)
+#endif
+
+/*******************************************************************************
+ * FUNCTION PROTOTYPES WITH GLOBAL SCOPE
+ ******************************************************************************/
+
+/**
+ * @brief Selects the backend for drive 0. Call before f_mount(); the drive
+ *        goes back to STA_NOINIT.
+ */
+void disk_set_backend(const diskio_backend_t *backend);
+
+const diskio_backend_t *disk_get_backend(void);
+
+#ifndef HOST_BUILD
+/**
+ * @brief Card state behind ::diskio_sd_backend: retry/downgrade counters
+ *        (rec), current clock and streaming counters. Read-only.
+ */
+const sd_card_t *diskio_sd_card(void);
+#endif
+
+#endif /* DISKIO_BACKEND_H_ */
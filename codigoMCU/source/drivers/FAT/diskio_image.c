@@ -0,0 +1,199 @@
+/***************************************************************************//**
+  @file     diskio_image.c
+  @brief    diskio backend serving sectors from a FAT image file (host builds)
+  @author   Grupo 3
+ ******************************************************************************/
+
+#ifdef HOST_BUILD
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "diskio_image.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define IMG_SECTOR_SIZE     512u
+
+static FILE *g_img = NULL;
+static DWORD g_sectors;
+static diskio_image_model_t g_model = DISKIO_IMAGE_MODEL_IDEAL;
+static bool g_realtime;
+static diskio_image_stats_t g_stats;
+static uint32_t g_since_stall;      // sectores escritos desde el último stall
+
+/*******************************************************************************
+ * Modelo de tiempos
+ ******************************************************************************/
+
+static uint32_t transfer_us(uint32_t sectors, uint32_t kbps)
+{
+    if (kbps == 0u) return 0u;
+    return (uint32_t)(((uint64_t)sectors * IMG_SECTOR_SIZE * 1000000u) / ((uint64_t)kbps * 1024u));
+}
+
+static void charge(uint32_t us)
+{
+    g_stats.busy_us += us;
+    if (us > g_stats.max_op_us) g_stats.max_op_us = us;
+
+    if (g_realtime && us) {
+        struct timespec ts = { (time_t)(us / 1000000u), (long)(us % 1000000u) * 1000L };
+        while (nanosleep(&ts, &ts) != 0) { }
+    }
+}
+
+static uint32_t read_cost(UINT count)
+{
+    uint32_t cmds = g_model.per_sector_cmd ? count : 1u;
+    return cmds * g_model.cmd_us + transfer_us(count, g_model.read_kbps);
+}
+
+static uint32_t write_cost(UINT count)
+{
+    uint32_t cmds = g_model.per_sector_cmd ? count : 1u;
+    uint32_t us   = cmds * (g_model.cmd_us + g_model.write_busy_us) + transfer_us(count, g_model.write_kbps);
+
+    if (g_model.stall_every) {
+        g_since_stall += count;
+        while (g_since_stall >= g_model.stall_every) {
+            g_since_stall -= g_model.stall_every;
+            us += g_model.stall_us;
+            g_stats.stalls++;
+        }
+    }
+    return us;
+}
+
+/*******************************************************************************
+ * Backend
+ ******************************************************************************/
+
+static bool seek_sector(DWORD sector, UINT count)
+{
+    if (sector >= g_sectors || count > g_sectors - sector) return false;
+    return fseek(g_img, (long)sector * (long)IMG_SECTOR_SIZE, SEEK_SET) == 0;
+}
+
+static DSTATUS image_init(void)
+{
+    return g_img ? 0 : STA_NOINIT;
+}
+
+static DRESULT image_read(BYTE *buff, DWORD sector, UINT count)
+{
+    if (!seek_sector(sector, count)) return RES_PARERR;
+    if (fread(buff, IMG_SECTOR_SIZE, count, g_img) != count) return RES_ERROR;
+
+    g_stats.reads++;
+    g_stats.sectors_read += count;
+    charge(read_cost(count));
+    return RES_OK;
+}
+
+static DRESULT image_write(const BYTE *buff, DWORD sector, UINT count)
+{
+    if (!seek_sector(sector, count)) return RES_PARERR;
+    if (fwrite(buff, IMG_SECTOR_SIZE, count, g_img) != count) return RES_ERROR;
+
+    g_stats.writes++;
+    g_stats.sectors_written += count;
+    charge(write_cost(count));
+    return RES_OK;
+}
+
+static DRESULT image_ioctl(BYTE cmd, void *buff)
+{
+    switch (cmd)
+    {
+    case CTRL_SYNC:
+        return (fflush(g_img) == 0) ? RES_OK : RES_ERROR;
+
+    case GET_SECTOR_SIZE:
+        *(WORD*)buff = IMG_SECTOR_SIZE;
+        return RES_OK;
+
+    case GET_BLOCK_SIZE:
+        *(DWORD*)buff = 1;
+        return RES_OK;
+
+    case GET_SECTOR_COUNT:
+        *(DWORD*)buff = g_sectors;
+        return RES_OK;
+    }
+
+    return RES_PARERR;
+}
+
+static const diskio_backend_t image_backend = {
+    .name  = "image",
+    .init  = image_init,
+    .read  = image_read,
+    .write = image_write,
+    .ioctl = image_ioctl,
+};
+
+/*******************************************************************************
+ * API
+ ******************************************************************************/
+
+bool diskio_image_open(const char *path, const diskio_image_model_t *model)
+{
+    diskio_image_close();
+
+    g_img = fopen(path, "r+b");
+    if (!g_img) return false;
+
+    long size = -1;
+    if (fseek(g_img, 0, SEEK_END) == 0) size = ftell(g_img);
+    if (size <= 0 || (size % (long)IMG_SECTOR_SIZE) != 0) {
+        fclose(g_img);
+        g_img = NULL;
+        return false;
+    }
+
+    g_sectors = (DWORD)(size / (long)IMG_SECTOR_SIZE);
+    diskio_image_set_model(model);
+    diskio_image_reset_stats();
+    disk_set_backend(&image_backend);
+    return true;
+}
+
+void diskio_image_close(void)
+{
+    if (!g_img) return;
+
+    if (disk_get_backend() == &image_backend) disk_set_backend(NULL);
+    fclose(g_img);
+    g_img = NULL;
+    g_sectors = 0;
+}
+
+void diskio_image_set_model(const diskio_image_model_t *model)
+{
+    static const diskio_image_model_t ideal = DISKIO_IMAGE_MODEL_IDEAL;
+    g_model = model ? *model : ideal;
+    g_since_stall = 0;
+}
+
+void diskio_image_set_realtime(bool enable)
+{
+    g_realtime = enable;
+}
+
+void diskio_image_get_stats(diskio_image_stats_t *out)
+{
+    if (out) *out = g_stats;
+}
+
+void diskio_image_reset_stats(void)
+{
+    memset(&g_stats, 0, sizeof(g_stats));
+}
+
+uint64_t diskio_image_time_us(void)
+{
+    return g_stats.busy_us;
+}
+
+#endif /* HOST_BUILD */
@@ -0,0 +1,102 @@
+/***************************************************************************//**
+  @file     diskio_image.h
+  @brief    diskio backend serving sectors from a FAT image file (host builds)
+
+  Lets FatFs, the library scanner and mp3_player.c run on a build machine
+  against a dump of a real card (dd if=/dev/sdX of=card.img) or a freshly
+  formatted image (mkfs.vfat -C card.img 65536). Only built with HOST_BUILD:
+
+    gcc -DHOST_BUILD -I. -Isource -Isource/helix/pub \
+        source/drivers/FAT/{ff,ffunicode,ffsystem,fattime,diskio,diskcache,diskio_image}.c \
+        <test>.c -o test
+
+  Every access is charged to a virtual clock following a latency/throughput
+  model, so a run reports how long the same access pattern would take on the
+  card. With realtime enabled the backend also sleeps for that long.
+
+  @author   Grupo 3
+ ******************************************************************************/
+
+#ifndef DISKIO_IMAGE_H_
+#define DISKIO_IMAGE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "diskio_backend.h"
+
+/*******************************************************************************
+ * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
+ ******************************************************************************/
+
+// Sin costo: solo el tiempo del archivo en el host
+#define DISKIO_IMAGE_MODEL_IDEAL    { 0u, 0u, 0u, 0u, false, 0u, 0u }
+
+/* Placa actual: SDHC 1-bit @ 25 MHz, un CMD18/CMD25 (ACMD23 + CMD25 al
+ * escribir) por transferencia, cualquiera sea la cantidad de sectores.
+ * 25 Mbit/s de bus dan ~3 MB/s de techo; con el polling de DATPORT quedan
+ * ~2.8 MB/s. Cada comando suma ~120 us (CMD + R1 + espera del token), una
+ * escritura ~800 us de busy, y la tarjeta mete un stall de ~20 ms cada
+ * ~512 sectores escritos (borrado de AU). Estimaciones: reemplazar por lo
+ * que mida Tests/SD_bench.c. */
+#define DISKIO_IMAGE_MODEL_SDHC_1BIT_25MHZ  { 120u, 2800u, 2800u, 800u, false, 512u, 20000u }
+
+// El driver anterior: un CMD17/CMD24 por sector, para comparar
+#define DISKIO_IMAGE_MODEL_SDHC_1BIT_25MHZ_SINGLE  { 120u, 2800u, 2800u, 800u, true, 512u, 20000u }
+
+/*******************************************************************************
+ * ENUMERATIONS AND STRUCTURES AND TYPEDEFS
+ ******************************************************************************/
+
+typedef struct {
+    uint32_t cmd_us;            // fixed cost per command
+    uint32_t read_kbps;         // read throughput in KB/s (0 = infinite)
+    uint32_t write_kbps;        // write throughput in KB/s (0 = infinite)
+    uint32_t write_busy_us;     // programming busy after each write command
+    bool     per_sector_cmd;    // one command per sector (no multi-block)
+    uint32_t stall_every;       // written sectors between stalls (0 = never)
+    uint32_t stall_us;          // stall length
+} diskio_image_model_t;
+
+typedef struct {
+    uint32_t reads;             // disk_read calls reaching the image
+    uint32_t writes;
+    uint32_t sectors_read;
+    uint32_t sectors_written;
+    uint32_t stalls;
+    uint64_t busy_us;           // modeled card time, total
+    uint32_t max_op_us;         // worst single read/write
+} diskio_image_stats_t;
+
+/*******************************************************************************
+ * FUNCTION PROTOTYPES WITH GLOBAL SCOPE
+ ******************************************************************************/
+
+/**
+ * @brief Opens @p path read/write and registers it as the drive 0 backend.
+ * @param model latency model, NULL for ::DISKIO_IMAGE_MODEL_IDEAL.
+ * @return false if the file cannot be opened or its size is not a multiple
+ *         of 512.
+ */
+bool diskio_image_open(const char *path, const diskio_image_model_t *model);
+
+/**
+ * @brief Flushes and closes the image and unregisters the backend.
+ */
+void diskio_image_close(void);
+
+void diskio_image_set_model(const diskio_image_model_t *model);
+
+/**
+ * @brief Also sleep for the modeled time on every access.
+ */
+void diskio_image_set_realtime(bool enable);
+
+void diskio_image_get_stats(diskio_image_stats_t *out);
+void diskio_image_reset_stats(void);
+
+/**
+ * @brief Modeled card time since the last reset, in microseconds.
+ */
+uint64_t diskio_image_time_us(void);
+
+#endif /* DISKIO_IMAGE_H_ */
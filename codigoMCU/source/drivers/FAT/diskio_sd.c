@@ -0,0 +1,123 @@
+/***************************************************************************//**
+  @file     diskio_sd.c
+  @brief    diskio backend for the SD card on the K64 SDHC
+  @author   Grupo 3
+ ******************************************************************************/
+
+#ifndef HOST_BUILD
+
+#include "diskio_backend.h"
+#include "source/drivers/SD/sd.h"
+#include <string.h>
+
+static sd_card_t sd_card;
+
+/* Buffer alineado para DATPORT (512 bytes) */
+static uint32_t sd_bounce[SD_BLOCK_SIZE / 4] __attribute__((aligned(4)));
+
+static volatile sd_error_t g_last_sd_err;
+static volatile DWORD g_last_sector;
+static volatile UINT g_last_count;
+
+static DSTATUS sd_backend_init(void)
+{
+    return (sd_init(&sd_card) == SD_OK) ? 0 : STA_NOINIT;
+}
+
+static DRESULT sd_backend_read(BYTE *buff, DWORD sector, UINT count)
+{
+    g_last_sector = sector;
+    g_last_count  = count;
+
+    while (count)
+    {
+        sd_error_t e;
+        UINT n = 1;
+
+        if (((uintptr_t)buff & 0x3u) == 0u) {
+            // alineado: CMD18 directo al buffer, hasta lo que entra en un descriptor ADMA2
+            n = (count > SD_MAX_XFER_BLOCKS) ? SD_MAX_XFER_BLOCKS : count;
+            e = sd_read_blocks(&sd_card, sector, (uint32_t*)buff, n);
+        } else {
+            e = sd_read_blocks(&sd_card, sector, sd_bounce, 1);
+            if (e == SD_OK) memcpy(buff, sd_bounce, 512);
+        }
+
+        if (e != SD_OK) {
+            g_last_sd_err = e;
+            return RES_ERROR;
+        }
+
+        buff   += n * SD_BLOCK_SIZE;
+        sector += n;
+        count  -= n;
+    }
+
+    return RES_OK;
+}
+
+static DRESULT sd_backend_write(const BYTE *buff, DWORD sector, UINT count)
+{
+    while (count)
+    {
+        sd_error_t err;
+        UINT n = 1;
+
+        if (((uintptr_t)buff & 0x3u) == 0u) {
+            // alineado: ACMD23 + CMD25 directo desde el buffer del llamador
+            n = (count > SD_MAX_XFER_BLOCKS) ? SD_MAX_XFER_BLOCKS : count;
+            err = sd_write_blocks(&sd_card, sector, (const uint32_t*)buff, n);
+        } else {
+            memcpy(sd_bounce, buff, SD_BLOCK_SIZE);
+            err = sd_write_blocks(&sd_card, sector, sd_bounce, 1);
+        }
+
+        if (err != SD_OK) {
+            g_last_sd_err = err;
+            return RES_ERROR;
+        }
+
+        buff   += n * SD_BLOCK_SIZE;
+        sector += n;
+        count  -= n;
+    }
+
+    return RES_OK;
+}
+
+static DRESULT sd_backend_ioctl(BYTE cmd, void *buff)
+{
+    switch (cmd)
+    {
+    case CTRL_SYNC:
+        return RES_OK;
+
+    case GET_SECTOR_SIZE:
+        *(WORD*)buff = SD_BLOCK_SIZE;
+        return RES_OK;
+
+    case GET_BLOCK_SIZE:
+        *(DWORD*)buff = 1;
+        return RES_OK;
+
+    case GET_SECTOR_COUNT:
+        return RES_PARERR;
+    }
+
+    return RES_PARERR;
+}
+
+const sd_card_t *diskio_sd_card(void)
+{
+    return &sd_card;
+}
+
+const diskio_backend_t diskio_sd_backend = {
+    .name  = "sd",
+    .init  = sd_backend_init,
+    .read  = sd_backend_read,
+    .write = sd_backend_write,
+    .ioctl = sd_backend_ioctl,
+};
+
+#endif /* HOST_BUILD */
@@ -0,0 +1,118 @@
+/***************************************************************************//**
+  @file     ffcontig.c
+  @brief    Direct sector reads for files stored in one contiguous run
+  @author   Grupo 3
+ ******************************************************************************/
+
+#include "ffcontig.h"
+#include "diskio.h"
+#include <string.h>
+
+#define SS      FF_MIN_SS       // FF_MIN_SS == FF_MAX_SS == 512
+
+// tabla de link map para un solo fragmento: [tamaño, largo, cluster, 0]
+#define CONTIG_CLMT_LEN     4u
+
+static bool chain_is_contiguous(FIL *fp)
+{
+#if FF_FS_EXFAT
+    // exFAT: el flag NoFatChain del directorio ya lo dice (stat == 2)
+    if (fp->obj.fs->fs_type == FS_EXFAT) return (fp->obj.stat & 3u) == 2u;
+#endif
+#if FF_USE_FASTSEEK
+    DWORD clmt[CONTIG_CLMT_LEN] = { CONTIG_CLMT_LEN };
+
+    fp->cltbl = clmt;
+    FRESULT fr = f_lseek(fp, CREATE_LINKMAP);      // no mueve fptr
+    fp->cltbl = NULL;
+    return (fr == FR_OK) && (clmt[0] == CONTIG_CLMT_LEN);
+#else
+    return false;
+#endif
+}
+
+// disk_read() no pasa por FatFs: el volumen se toma a mano
+static FRESULT read_sectors(FATFS *fs, void *buff, DWORD sect, UINT count)
+{
+    DRESULT dr;
+
+#if FF_FS_REENTRANT
+    if (!ff_req_grant(fs->sobj)) return FR_TIMEOUT;
+#endif
+    dr = disk_read(fs->pdrv, (BYTE *)buff, sect, count);
+#if FF_FS_REENTRANT
+    ff_rel_grant(fs->sobj);
+#endif
+    return (dr == RES_OK) ? FR_OK : FR_DISK_ERR;
+}
+
+bool ffcontig_open(ffcontig_t *c, FIL *fp)
+{
+    memset(c, 0, sizeof(*c));
+    c->fp = fp;
+    if (!fp || !fp->obj.fs) return false;
+
+    c->pos  = f_tell(fp);
+    c->size = f_size(fp);
+
+    FATFS *fs = fp->obj.fs;
+    if (fp->obj.sclust < 2u || (fp->flag & FA_WRITE)) return false;
+    if (!chain_is_contiguous(fp)) return false;
+
+    c->first_sect = fs->database + (DWORD)fs->csize * (fp->obj.sclust - 2u);
+    c->active = true;
+    return true;
+}
+
+FRESULT ffcontig_read(ffcontig_t *c, void *buff, UINT btr, UINT *br)
+{
+    BYTE *dst = (BYTE *)buff;
+    FRESULT fr;
+
+    if (!c->active) {
+        fr = f_read(c->fp, buff, btr, br);
+        c->pos += *br;
+        return fr;
+    }
+
+    *br = 0;
+    FATFS *fs = c->fp->obj.fs;
+    if (fs->id != c->fp->obj.id) return FR_INVALID_OBJECT;     // se desmontó el volumen
+
+    if ((FSIZE_t)btr > c->size - c->pos) btr = (UINT)(c->size - c->pos);
+
+    while (btr > 0u) {
+        DWORD sect = c->first_sect + (DWORD)(c->pos / SS);
+        UINT  ofs  = (UINT)(c->pos % SS);
+        UINT  n;
+
+        if (ofs == 0u && btr >= SS && ((uintptr_t)dst & 0x3u) == 0u) {
+            // sectores completos: directo al buffer del llamador, multi-bloque
+            UINT count = btr / SS;
+            if (count > FFCONTIG_MAX_SECTORS) count = FFCONTIG_MAX_SECTORS;
+
+            fr = read_sectors(fs, dst, sect, count);
+            if (fr != FR_OK) return fr;
+            c->direct_reads++;
+            c->direct_sectors += count;
+            n = count * SS;
+        } else {
+            // cabeza/cola de un sector: pasa por buf (el próximo read suele empezar ahí)
+            if (c->buf_sect != sect) {
+                c->buf_sect = 0;
+                fr = read_sectors(fs, c->buf, sect, 1u);
+                if (fr != FR_OK) return fr;
+                c->buf_sect = sect;
+            }
+            n = SS - ofs;
+            if (n > btr) n = btr;
+            memcpy(dst, (const BYTE *)c->buf + ofs, n);
+        }
+
+        dst    += n;
+        btr    -= n;
+        c->pos += n;
+        *br    += n;
+    }
+    return FR_OK;
+}
@@ -0,0 +1,71 @@
+/***************************************************************************//**
+  @file     ffcontig.h
+  @brief    Direct sector reads for files stored in one contiguous run
+  @author   Grupo 3
+ ******************************************************************************/
+
+#ifndef FFCONTIG_H_
+#define FFCONTIG_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ff.h"
+
+/*******************************************************************************
+ * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
+ ******************************************************************************/
+
+// Sectores por disk_read(): un descriptor ADMA2 mueve hasta 64 KB - 1
+#ifndef FFCONTIG_MAX_SECTORS
+#define FFCONTIG_MAX_SECTORS    64u
+#endif
+
+/*******************************************************************************
+ * ENUMERATIONS AND STRUCTURES AND TYPEDEFS
+ ******************************************************************************/
+
+typedef struct {
+    FIL     *fp;
+    bool     active;            // false: every read goes through f_read()
+    DWORD    first_sect;        // sector holding file offset 0
+    FSIZE_t  pos;
+    FSIZE_t  size;
+    DWORD    buf_sect;          // sector cached in buf (0: none)
+    uint32_t buf[FF_MIN_SS / 4];
+    uint32_t direct_reads;      // disk_read() calls issued by the fast path
+    uint32_t direct_sectors;
+} ffcontig_t;
+
+/*******************************************************************************
+ * FUNCTION PROTOTYPES WITH GLOBAL SCOPE
+ ******************************************************************************/
+
+/**
+ * @brief Starts reading @p fp from its current position.
+ *
+ * A file is contiguous when it is flagged NoFatChain on exFAT, or when its
+ * FAT chain is a single fragment (checked once with a fast-seek link map).
+ * For those, sector addresses are computed from the start cluster and reads
+ * go straight to disk_read() as multi-sector transfers, without touching
+ * the FAT or FIL.buf. Other files fall back to f_read().
+ *
+ * @return true if the fast path is active.
+ * @note   The file must be open read-only and only read through
+ *         ffcontig_read() afterwards: FIL.fptr is not kept up to date.
+ */
+bool ffcontig_open(ffcontig_t *c, FIL *fp);
+
+/**
+ * @brief f_read() replacement; same contract.
+ */
+FRESULT ffcontig_read(ffcontig_t *c, void *buff, UINT btr, UINT *br);
+
+/**
+ * @brief true once everything up to the end of the file has been read.
+ */
+static inline bool ffcontig_eof(const ffcontig_t *c)
+{
+    return c->pos >= c->size;
+}
+
+#endif /* FFCONTIG_H_ */
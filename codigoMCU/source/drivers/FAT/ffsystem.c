@@ -2,13 +2,29 @@
 /* Sample Code of OS Dependent Functions for FatFs                        */
 /* (C)ChaN, 2018                                                          */
 /*------------------------------------------------------------------------*/
+/* uC/OS-III: un OS_MUTEX por volumen (con herencia de prioridad, así el  */
+/* lector de playback no espera detrás del indexador de baja prioridad)   */
+/* y los buffers de LFN en una partición OS_MEM.                          */
+/*------------------------------------------------------------------------*/
 
 
 #include "ff.h"
+#include "ffsystem.h"
+#include <string.h>
+
+#ifdef HOST_BUILD
+#include <stdlib.h>
+#else
+#include "os.h"
+#include "cpu.h"
+#include "MK64F12.h"
+#endif
 
 
 #if FF_USE_LFN == 3	/* Dynamic memory allocation */
 
+#ifdef HOST_BUILD
+
 /*------------------------------------------------------------------------*/
 /* Allocate a memory block                                                */
 /*------------------------------------------------------------------------*/
@@ -32,12 +48,84 @@ void ff_memfree (
 	free(mblock);	/* Free the memory block with POSIX API */
 }
 
+#else
+
+/* FatFs pide el buffer de LFN con el volumen tomado y lo libera antes de
+/  soltarlo: alcanza con un bloque por volumen (+1 de margen). */
+#define FF_LFN_BLOCK_SIZE	((FF_MAX_LFN + 1) * 2 + (FF_FS_EXFAT ? (FF_MAX_LFN + 44) / 15 * 32 : 0))
+#define FF_LFN_BLOCKS		(FF_VOLUMES + 1)
+
+static OS_MEM ff_lfn_part;
+static CPU_INT32U ff_lfn_pool[FF_LFN_BLOCKS][(FF_LFN_BLOCK_SIZE + 3) / 4];
+static CPU_BOOLEAN ff_lfn_ready = DEF_NO;
+
+/* Se crea en el primer f_mount() (ff_cre_syncobj), antes de cualquier uso */
+static int ff_lfn_init (void)
+{
+	OS_ERR err;
+
+	if (ff_lfn_ready) return 1;
+	OSMemCreate(&ff_lfn_part, "FatFs LFN", ff_lfn_pool, FF_LFN_BLOCKS,
+	            sizeof(ff_lfn_pool[0]), &err);
+	ff_lfn_ready = (err == OS_ERR_NONE) ? DEF_YES : DEF_NO;
+	return (int)ff_lfn_ready;
+}
+
+void* ff_memalloc (	/* Returns pointer to the allocated memory block (null if not enough core) */
+	UINT msize		/* Number of bytes to allocate */
+)
+{
+	OS_ERR err;
+
+	if (!ff_lfn_ready || msize > sizeof(ff_lfn_pool[0])) return 0;	/* f_mkfs(work = NULL): no soportado */
+
+	void *blk = OSMemGet(&ff_lfn_part, &err);
+	return (err == OS_ERR_NONE) ? blk : 0;
+}
+
+void ff_memfree (
+	void* mblock	/* Pointer to the memory block to free (nothing to do if null) */
+)
+{
+	OS_ERR err;
+
+	if (mblock) OSMemPut(&ff_lfn_part, mblock, &err);
+}
+
+#endif /* HOST_BUILD */
+
 #endif
 
 
 
 #if FF_FS_REENTRANT	/* Mutal exclusion */
 
+typedef struct {
+	OS_MUTEX   mutex;
+	CPU_TS32   t_grant;			/* CPU_TS del último ff_req_grant() */
+	CPU_TS32   max_wait;		/* en cuentas de CPU_TS, se pasan a us al leer */
+	CPU_TS32   max_hold;
+	CPU_INT64U total_hold;
+	ff_lock_stats_t st;
+} ff_vol_lock_t;
+
+static ff_vol_lock_t ff_lock[FF_VOLUMES];
+
+/* CPU_TS32_to_uSec() sobre 64 bits, en tramos de 2^31 cuentas: pierde < 1 us por tramo (~18 s a 120 MHz) */
+static CPU_INT64U ff_ts64_to_us (CPU_INT64U ts)
+{
+	return (ts >> 31) * CPU_TS32_to_uSec(0x80000000u) + CPU_TS32_to_uSec((CPU_TS32)(ts & 0x7FFFFFFFu));
+}
+
+static const char *ff_cur_task_name (void)
+{
+#if OS_CFG_DBG_EN > 0u
+	return (OSTCBCurPtr != (OS_TCB *)0) ? OSTCBCurPtr->NamePtr : "";
+#else
+	return "";
+#endif
+}
+
 /*------------------------------------------------------------------------*/
 /* Create a Synchronization Object                                        */
 /*------------------------------------------------------------------------*/
@@ -46,35 +134,22 @@ void ff_memfree (
 /  When a 0 is returned, the f_mount() function fails with FR_INT_ERR.
 */
 
-//const osMutexDef_t Mutex[FF_VOLUMES];	/* Table of CMSIS-RTOS mutex */
-
-
 int ff_cre_syncobj (	/* 1:Function succeeded, 0:Could not create the sync object */
 	BYTE vol,			/* Corresponding volume (logical drive number) */
 	FF_SYNC_t* sobj		/* Pointer to return the created sync object */
 )
 {
-	/* Win32 */
-	*sobj = CreateMutex(NULL, FALSE, NULL);
-	return (int)(*sobj != INVALID_HANDLE_VALUE);
-
-	/* uITRON */
-//	T_CSEM csem = {TA_TPRI,1,1};
-//	*sobj = acre_sem(&csem);
-//	return (int)(*sobj > 0);
-
-	/* uC/OS-II */
-//	OS_ERR err;
-//	*sobj = OSMutexCreate(0, &err);
-//	return (int)(err == OS_NO_ERR);
-
-	/* FreeRTOS */
-//	*sobj = xSemaphoreCreateMutex();
-//	return (int)(*sobj != NULL);
-
-	/* CMSIS-RTOS */
-//	*sobj = osMutexCreate(&Mutex[vol]);
-//	return (int)(*sobj != NULL);
+	OS_ERR err;
+
+	if (vol >= FF_VOLUMES) return 0;
+#if FF_USE_LFN == 3
+	if (!ff_lfn_init()) return 0;
+#endif
+
+	memset(&ff_lock[vol], 0, sizeof(ff_lock[vol]));
+	OSMutexCreate(&ff_lock[vol].mutex, "FatFs volume", &err);
+	*sobj = &ff_lock[vol];
+	return (int)(err == OS_ERR_NONE);
 }
 
 
@@ -90,23 +165,11 @@ int ff_del_syncobj (	/* 1:Function succeeded, 0:Could not delete due to an error
 	FF_SYNC_t sobj		/* Sync object tied to the logical drive to be deleted */
 )
 {
-	/* Win32 */
-	return (int)CloseHandle(sobj);
-
-	/* uITRON */
-//	return (int)(del_sem(sobj) == E_OK);
-
-	/* uC/OS-II */
-//	OS_ERR err;
-//	OSMutexDel(sobj, OS_DEL_ALWAYS, &err);
-//	return (int)(err == OS_NO_ERR);
+	OS_ERR err;
+	ff_vol_lock_t *lk = (ff_vol_lock_t *)sobj;
 
-	/* FreeRTOS */
-//  vSemaphoreDelete(sobj);
-//	return 1;
-
-	/* CMSIS-RTOS */
-//	return (int)(osMutexDelete(sobj) == osOK);
+	OSMutexDel(&lk->mutex, OS_OPT_DEL_ALWAYS, &err);
+	return (int)(err == OS_ERR_NONE);
 }
 
 
@@ -121,22 +184,32 @@ int ff_req_grant (	/* 1:Got a grant to access the volume, 0:Could not get a gran
 	FF_SYNC_t sobj	/* Sync object to wait */
 )
 {
-	/* Win32 */
-	return (int)(WaitForSingleObject(sobj, FF_FS_TIMEOUT) == WAIT_OBJECT_0);
-
-	/* uITRON */
-//	return (int)(wai_sem(sobj) == E_OK);
-
-	/* uC/OS-II */
-//	OS_ERR err;
-//	OSMutexPend(sobj, FF_FS_TIMEOUT, &err));
-//	return (int)(err == OS_NO_ERR);
-
-	/* FreeRTOS */
-//	return (int)(xSemaphoreTake(sobj, FF_FS_TIMEOUT) == pdTRUE);
-
-	/* CMSIS-RTOS */
-//	return (int)(osMutexWait(sobj, FF_FS_TIMEOUT) == osOK);
+	OS_ERR err;
+	ff_vol_lock_t *lk = (ff_vol_lock_t *)sobj;
+
+	if (OSRunning != OS_STATE_OS_RUNNING) return 1;	/* tests bare-metal (Tests/): no hay con quién competir */
+
+	/* primero sin bloquear: así se distingue un acceso libre de uno disputado */
+	OSMutexPend(&lk->mutex, 0u, OS_OPT_PEND_NON_BLOCKING, (CPU_TS *)0, &err);
+	if (err == OS_ERR_PEND_WOULD_BLOCK) {
+		CPU_TS32 t0 = CPU_TS_Get32();
+
+		OSMutexPend(&lk->mutex, FF_FS_TIMEOUT, OS_OPT_PEND_BLOCKING, (CPU_TS *)0, &err);
+		if (err != OS_ERR_NONE) {
+			lk->st.timeouts++;
+			return 0;
+		}
+
+		CPU_TS32 wait = CPU_TS_Get32() - t0;
+		lk->st.contended++;
+		if (wait > lk->max_wait) lk->max_wait = wait;
+	} else if (err != OS_ERR_NONE) {
+		return 0;
+	}
+
+	lk->st.grants++;
+	lk->t_grant = CPU_TS_Get32();
+	return 1;
 }
 
 
@@ -150,21 +223,70 @@ void ff_rel_grant (
 	FF_SYNC_t sobj	/* Sync object to be signaled */
 )
 {
-	/* Win32 */
-	ReleaseMutex(sobj);
+	OS_ERR err;
+	ff_vol_lock_t *lk = (ff_vol_lock_t *)sobj;
 
-	/* uITRON */
-//	sig_sem(sobj);
+	if (OSRunning != OS_STATE_OS_RUNNING) return;
 
-	/* uC/OS-II */
-//	OSMutexPost(sobj);
+	CPU_TS32 hold = CPU_TS_Get32() - lk->t_grant;
+	lk->total_hold += hold;
+	if (hold > lk->max_hold) {
+		lk->max_hold = hold;
+		lk->st.max_hold_task = ff_cur_task_name();
+	}
 
-	/* FreeRTOS */
-//	xSemaphoreGive(sobj);
-
-	/* CMSIS-RTOS */
-//	osMutexRelease(sobj);
+	OSMutexPost(&lk->mutex, OS_OPT_POST_NONE, &err);
 }
 
 #endif
 
+
+
+/*------------------------------------------------------------------------*/
+/* Lock statistics                                                        */
+/*------------------------------------------------------------------------*/
+
+void ff_lock_get_stats (BYTE vol, ff_lock_stats_t *st)
+{
+	if (!st) return;
+	memset(st, 0, sizeof(*st));
+
+#if FF_FS_REENTRANT
+	if (vol >= FF_VOLUMES) return;
+
+	CPU_SR_ALLOC();
+	CPU_TS32   max_wait, max_hold;
+	CPU_INT64U total_hold;
+
+	/* solo los contadores: el OS_MUTEX no se copia */
+	CPU_CRITICAL_ENTER();
+	*st        = ff_lock[vol].st;
+	max_wait   = ff_lock[vol].max_wait;
+	max_hold   = ff_lock[vol].max_hold;
+	total_hold = ff_lock[vol].total_hold;
+	CPU_CRITICAL_EXIT();
+
+	st->max_wait_us   = (uint32_t)CPU_TS32_to_uSec(max_wait);
+	st->max_hold_us   = (uint32_t)CPU_TS32_to_uSec(max_hold);
+	st->total_hold_us = ff_ts64_to_us(total_hold);
+#else
+	(void)vol;
+#endif
+}
+
+void ff_lock_reset_stats (BYTE vol)
+{
+#if FF_FS_REENTRANT
+	if (vol >= FF_VOLUMES) return;
+
+	CPU_SR_ALLOC();
+	CPU_CRITICAL_ENTER();
+	memset(&ff_lock[vol].st, 0, sizeof(ff_lock[vol].st));
+	ff_lock[vol].max_wait   = 0;
+	ff_lock[vol].max_hold   = 0;
+	ff_lock[vol].total_hold = 0;
+	CPU_CRITICAL_EXIT();
+#else
+	(void)vol;
+#endif
+}
@@ -0,0 +1,39 @@
+/***************************************************************************//**
+  @file     ffsystem.h
+  @brief    FatFs volume lock statistics (uC/OS-III glue in ffsystem.c)
+  @author   Grupo 3
+ ******************************************************************************/
+
+#ifndef FFSYSTEM_H_
+#define FFSYSTEM_H_
+
+#include <stdint.h>
+#include "ff.h"
+
+/*******************************************************************************
+ * ENUMERATIONS AND STRUCTURES AND TYPEDEFS
+ ******************************************************************************/
+
+typedef struct {
+    uint32_t    grants;         // FatFs calls that got the volume
+    uint32_t    contended;      // grants that had to wait for another task
+    uint32_t    timeouts;       // calls that failed with FR_TIMEOUT
+    uint32_t    max_wait_us;    // longest wait for the volume
+    uint32_t    max_hold_us;    // longest single FatFs call holding the volume
+    uint64_t    total_hold_us;
+    const char *max_hold_task;  // task that held the volume for max_hold_us
+} ff_lock_stats_t;
+
+/*******************************************************************************
+ * FUNCTION PROTOTYPES WITH GLOBAL SCOPE
+ ******************************************************************************/
+
+/**
+ * @brief Copies the lock counters of volume @p vol. All zero when
+ *        FF_FS_REENTRANT is 0 (host builds).
+ */
+void ff_lock_get_stats(BYTE vol, ff_lock_stats_t *st);
+
+void ff_lock_reset_stats(BYTE vol);
+
+#endif /* FFSYSTEM_H_ */
@@ -3,10 +3,7 @@
  ******************************************************************************/
 
 #include "cqueue.h"
-#include "MK64F12.h" // o lo que uses para __disable_irq/__enable_irq
-
-static inline uint32_t irq_save(void){ uint32_t prim = __get_PRIMASK(); __disable_irq(); return prim; }
-static inline void irq_restore(uint32_t prim){ if(!prim) __enable_irq(); }
+#include "../../CritSect.h"
 
 /*******************************************************************************
  * CONSTANT AND MACRO DEFINITIONS USING #DEFINE
@@ -51,11 +48,13 @@ void i2c_QueueInit(void)
 */
 unsigned char i2c_PushQueue(dataByte_t data)
 {	
-    uint32_t prim = irq_save();
+    CRIT_ALLOC();
+    CRIT_ENTER(CRIT_I2C_QUEUE);
 
 	if (news > QSIZE-1)		//test for Queue overflow
 	{
 		news=QOVERFLOW;		// inform queue has overflowed
+		CRIT_EXIT(CRIT_I2C_QUEUE);
 		return news;		
 	}	
 
@@ -65,7 +64,7 @@ unsigned char i2c_PushQueue(dataByte_t data)
 	if (pin == buffer+QSIZE)	// if queue size is exceded reset pointer
 		pin=buffer;
 
-    irq_restore(prim);
+    CRIT_EXIT(CRIT_I2C_QUEUE);
 	return(news);			// inform Queue state
 }
 
@@ -74,7 +73,8 @@ unsigned char i2c_PushQueue(dataByte_t data)
 */
 unsigned char i2c_PullQueue(void)
 {
-    uint32_t prim = irq_save();
+    CRIT_ALLOC();
+    CRIT_ENTER(CRIT_I2C_QUEUE);
 
 	dataByte_t *data;
 	data=pout;			// Aux data pointer
@@ -84,7 +84,7 @@ unsigned char i2c_PullQueue(void)
 	if (pout == buffer+QSIZE)	// Check for Queue boundaries
 		pout=buffer;		// if queue size is exceded reset pointer
 
-    irq_restore(prim);
+    CRIT_EXIT(CRIT_I2C_QUEUE);
 	return (data->byte);			// rerturn retrieved data
 }
 
@@ -38,6 +38,14 @@ void PIT_SetCallback(PIT_Callback_t cb, PIT_MOD pit){
 	PIT_Callbacks[pit] = cb;
 }
 
+void PIT_SetLoadValue(PIT_MOD pit, uint32_t ldval){
+    PIT->CHANNEL[pit].LDVAL = ldval;
+}
+
+uint32_t PIT_GetElapsed(PIT_MOD pit){
+    return PIT->CHANNEL[pit].LDVAL - PIT->CHANNEL[pit].CVAL;   // cuenta para abajo desde LDVAL
+}
+
 void PIT_EnableInterrupt(uint8_t pit, uint32_t freq){
 	NVIC_EnableIRQ(PIT0_IRQn + pit);
     PIT->CHANNEL[pit].TCTRL = 0;                 
@@ -41,6 +41,12 @@ void PIT_DisableInterrupt(uint8_t pit);
 
 void PIT_SetCallback(PIT_Callback_t cb, PIT_MOD pit);
 
+// Nuevo LDVAL (ticks - 1): el período actual termina igual, se usa desde el próximo
+void PIT_SetLoadValue(PIT_MOD pit, uint32_t ldval);
+
+// Ticks desde el último timeout (mientras LDVAL no haya cambiado en este período)
+uint32_t PIT_GetElapsed(PIT_MOD pit);
+
 
 
 #endif /* PIT_H_ */
@@ -5,6 +5,7 @@
 #include "hardware.h"
 #include "MK64F12.h"
 #include "board.h"
+#include "os.h"
 
 static sdhc_error_t sd_send_cmd0_with_retry(void);
 static inline sdhc_error_t sd_send_cmd(uint8_t idx, uint32_t arg,
@@ -13,6 +14,8 @@ static inline sdhc_error_t sd_send_cmd(uint8_t idx, uint32_t arg,
 static inline sdhc_error_t sd_send_acmd(uint32_t rca16, uint8_t acmd_idx, uint32_t acmd_arg,
                                        sdhc_response_type_t acmd_resp,
                                        sdhc_command_t *out_acmd);
+static sd_error_t sd_wait_ready(const sd_card_t *card);
+static sd_error_t sd_identify(sd_card_t *card);
 
 static sd_error_t sd_map_sdhc_err(sdhc_error_t e)
 {
@@ -82,9 +85,26 @@ static sd_error_t sd_acmd41(sd_card_t *card, uint32_t *ocr_out)
 sd_error_t sd_init(sd_card_t *card)
 {
     if (!card) return SDHC_ERROR_DATA;
+    card->acmd23_ok = 0;
+    card->acmd23_fail = 0;
+    card->stream_enabled = SD_STREAM_READS;
+    card->stream_starts = card->stream_hits = card->stream_stops = 0;
+    card->clock_hz = SD_CLOCK_MAX_HZ;
+    card->err_streak = 0;
+    card->ok_streak = 0;
+    memset(&card->rec, 0, sizeof(card->rec));
+
+    return sd_identify(card);
+}
+
+// CMD0 .. CMD7: deja la tarjeta en "tran" a card->clock_hz. Conserva los contadores.
+static sd_error_t sd_identify(sd_card_t *card)
+{
     card->rca  = 0;
     card->is_sdhc = false;
     card->ocr  = 0;
+    card->initialized = false;
+    card->stream_open = false;
 
     //CMD0: reset a IDLE
     sdhc_error_t e = sd_send_cmd0_with_retry();
@@ -146,19 +166,74 @@ sd_error_t sd_init(sd_card_t *card)
         if (e != SDHC_ERROR_OK) return sd_map_sdhc_err(e);
     }
 
-    sdhc_set_clock(25000000u);
+    sdhc_set_clock(card->clock_hz);
 
     card->initialized = true;
 
     return SDHC_ERROR_OK;
 }
 
-sd_error_t sd_read_blocks(sd_card_t *card, uint32_t lba, uint32_t *buf_w, uint32_t block_count)
+sd_error_t sd_stream_stop(sd_card_t *card)
+{
+    if (!card || !card->stream_open) return SD_OK;
+
+    card->stream_open = false;
+    card->stream_stops++;
+    sdhc_stream_abort();
+
+    // La tarjeta sigue en "data" con el clock frenado: CMD12 la devuelve a "tran".
+    // Puede traer OUT_OF_RANGE si el prefetch pasó el final: no importa acá.
+    sd_error_t e = sd_cmd(SD_CMD_STOP_TRANSMISSION, 0, SDHC_RESPONSE_TYPE_R1b, NULL);
+    if (e != SD_OK) return e;
+    return sd_wait_ready(card);
+}
+
+void sd_stream_enable(sd_card_t *card, bool enable)
+{
+    if (!card) return;
+    if (!enable) (void)sd_stream_stop(card);
+    card->stream_enabled = enable;
+}
+
+static sd_error_t sd_stream_read(sd_card_t *card, uint32_t lba, uint32_t *buf_w, uint32_t block_count)
+{
+    uint32_t r1 = 0;
+
+    if (card->stream_open && lba != card->stream_next_lba) {
+        sd_error_t e = sd_stream_stop(card);
+        if (e != SD_OK) return e;
+    }
+
+    bool start = !card->stream_open;
+    sdhc_error_t he = sdhc_stream_read(sd_addr_arg(card, lba), buf_w, block_count, start, &r1);
+    if (he != SDHC_ERROR_OK) {
+        card->stream_open = true;       // lo que haya quedado del lado de la tarjeta se corta igual
+        (void)sd_stream_stop(card);
+        return sd_map_sdhc_err(he);
+    }
+
+    card->stream_open = true;
+    if (start) {
+        card->stream_starts++;
+        if (r1 & SD_R1_ERROR_MASK) {
+            (void)sd_stream_stop(card);
+            return (r1 & SD_R1_ILLEGAL_COMMAND) ? SD_ERR_ILLEGAL_CMD : SD_ERR_IO;
+        }
+    } else {
+        card->stream_hits++;
+    }
+    card->stream_next_lba = lba + block_count;
+    return SD_OK;
+}
+
+static sd_error_t sd_read_once(sd_card_t *card, uint32_t lba, uint32_t *buf_w, uint32_t block_count)
 {
     if (!card || !card->initialized) return SD_ERR_NOT_READY;
     if (!buf_w || block_count == 0u) return SD_ERR_PARAM;
     if (((uintptr_t)buf_w & 0x3u) != 0u) return SD_ERR_PARAM;
 
+    if (card->stream_enabled) return sd_stream_read(card, lba, buf_w, block_count);
+
     sdhc_command_t cmd = {0};
     sdhc_data_t data = {0};
 
@@ -185,34 +260,55 @@ sd_error_t sd_read_blocks(sd_card_t *card, uint32_t lba, uint32_t *buf_w, uint32
     return SD_OK;
 }
 
-sd_error_t sd_write_blocks(sd_card_t *card, uint32_t lba, const uint32_t *buf_w, uint32_t block_count)
+// Espera a que la tarjeta termine de programar y vuelva a "tran" (CMD13)
+static sd_error_t sd_wait_ready(const sd_card_t *card)
+{
+    uint32_t r[4];
+
+    for (uint32_t i = 0; i < SD_READY_RETRIES; i++)
+    {
+        sd_error_t e = sd_cmd(SD_CMD_SEND_STATUS, ((uint32_t)card->rca) << 16, SDHC_RESPONSE_TYPE_R1, r);
+        if (e != SD_OK) return e;
+        if (r[0] & SD_R1_ERROR_MASK) return SD_ERR_IO;
+
+        if ((r[0] & SD_R1_READY_FOR_DATA) && (SD_R1_CURRENT_STATE(r[0]) == SD_STATE_TRAN))
+            return SD_OK;
+    }
+    return SD_ERR_TIMEOUT;
+}
+
+static sd_error_t sd_write_once(sd_card_t *card, uint32_t lba, const uint32_t *buf_w, uint32_t block_count)
 {
     if (!card || !card->initialized) return SD_ERR_NOT_READY;
-    if (!buf_w || block_count == 0u) return SD_ERR_PARAM;
+    if (!buf_w || block_count == 0u || block_count > SD_MAX_XFER_BLOCKS) return SD_ERR_PARAM;
     if (((uintptr_t)buf_w & 0x3u) != 0u) return SD_ERR_PARAM;
 
+    sd_error_t se = sd_stream_stop(card);
+    if (se != SD_OK) return se;
+
     if (block_count > 1u) {
+        // ACMD23 (SET_WR_BLK_ERASE_COUNT): la tarjeta puede borrar de antemano
+        // todo el rango. Es solo una pista: si falla, CMD25 funciona igual.
         uint32_t r[4];
         sd_error_t e = sd_cmd55(card, r);
-        if (e != SD_OK) return e;
-
-        e = sd_cmd(23, block_count, SDHC_RESPONSE_TYPE_R1, NULL); // ACMD23
+        if (e == SD_OK && (r[0] & SD_R1_APP_CMD)) {
+            e = sd_cmd(SD_ACMD_SET_WR_BLK_ERASE_COUNT, block_count & 0x7FFFFFu, SDHC_RESPONSE_TYPE_R1, r);
+            if (e == SD_OK && (r[0] & SD_R1_ERROR_MASK) == 0u) card->acmd23_ok++;
+            else card->acmd23_fail++;
+        } else {
+            card->acmd23_fail++;
+        }
     }
 
     sdhc_command_t cmd = {0};
     sdhc_data_t data = {0};
 
     cmd.commandType = 0;
-
-    if (block_count == 1u) {
-        cmd.index = 24; // CMD24
-        cmd.responseType = SDHC_RESPONSE_TYPE_R1;
-    } else {
-        cmd.index = 25; // CMD25
-        cmd.responseType = SDHC_RESPONSE_TYPE_R1;
-    }
+    cmd.index = (block_count == 1u) ? SD_CMD_WRITE_BLOCK : SD_CMD_WRITE_MULTIPLE_BLOCK;
+    cmd.responseType = SDHC_RESPONSE_TYPE_R1;
     cmd.argument = sd_addr_arg(card, lba);
 
+    // ADMA2 lee directo del buffer del llamador; CMD12 lo manda el host (AC12EN)
     data.blockSize = SD_BLOCK_SIZE;
     data.blockCount = block_count;
     data.readBuffer = NULL;
@@ -220,9 +316,143 @@ sd_error_t sd_write_blocks(sd_card_t *card, uint32_t lba, const uint32_t *buf_w,
     data.transferMode = SDHC_TRANSFER_MODE_ADMA2;
 
     sdhc_error_t he = sdhc_transfer(&cmd, &data);
-    if (he != SDHC_ERROR_OK) return sd_map_sdhc_err(he);
+    if (he != SDHC_ERROR_OK) {
+        // Si el CMD12 automático no salió la tarjeta queda en "rcv": se fuerza
+        if (block_count > 1u) {
+            sdhc_reset(SDHC_RESET_DATA);
+            (void)sd_cmd(SD_CMD_STOP_TRANSMISSION, 0, SDHC_RESPONSE_TYPE_R1b, NULL);
+        }
+        (void)sd_wait_ready(card);
+        return sd_map_sdhc_err(he);
+    }
+    if (cmd.response[0] & SD_R1_ERROR_MASK) {
+        (void)sd_wait_ready(card);
+        return (cmd.response[0] & SD_R1_ILLEGAL_COMMAND) ? SD_ERR_ILLEGAL_CMD : SD_ERR_IO;
+    }
 
-    return SD_OK;
+    return sd_wait_ready(card);
+}
+
+/*
+ * Recuperación: cada lectura/escritura se reintenta hasta SD_RETRY_MAX veces
+ * con espera exponencial. Errores CRC/timeout seguidos bajan el clock a la
+ * mitad (el bus ya es de 1 bit); una racha larga sin errores lo vuelve a subir.
+ * Si la tarjeta no contesta CMD13 o no vuelve a "tran" se re-inicializa.
+ */
+static void sd_delay_ms(uint32_t ms)
+{
+    if (OSRunning == OS_STATE_OS_RUNNING && OSIntNestingCtr == 0u) {
+        OS_ERR err;
+        OS_TICK ticks = (OS_TICK)((ms * OSCfg_TickRate_Hz + 999u) / 1000u);
+        OSTimeDly(ticks ? ticks : 1u, OS_OPT_TIME_DLY, &err);
+        return;
+    }
+    // sin OS (Tests/): espera activa, ~4 ciclos por vuelta
+    for (volatile uint32_t i = ms * (SystemCoreClock / 4000u); i > 0u; i--) {}
+}
+
+static void sd_set_clock(sd_card_t *card, uint32_t hz)
+{
+    card->clock_hz = hz;
+    sdhc_set_clock(hz);
+}
+
+static sd_error_t sd_reinit(sd_card_t *card)
+{
+    card->rec.reinits++;
+    sdhc_reset(SDHC_RESET_CMD);
+    sdhc_reset(SDHC_RESET_DATA);
+    sdhc_set_clock(SD_CLOCK_INIT_HZ);
+    return sd_identify(card);
+}
+
+// Devuelve la tarjeta a "tran" después de un error; si no se puede, re-init
+static void sd_recover(sd_card_t *card)
+{
+    sdhc_reset(SDHC_RESET_CMD);
+    sdhc_reset(SDHC_RESET_DATA);
+    card->stream_open = false;          // si quedó en "data", el CMD12 de abajo la frena
+
+    if (sd_wait_ready(card) == SD_OK) return;
+    if (sd_cmd(SD_CMD_STOP_TRANSMISSION, 0, SDHC_RESPONSE_TYPE_R1b, NULL) == SD_OK &&
+        sd_wait_ready(card) == SD_OK) return;
+
+    (void)sd_reinit(card);
+}
+
+static void sd_note_error(sd_card_t *card, sd_error_t e)
+{
+    card->ok_streak = 0;
+
+    if (e == SD_ERR_CRC)          card->rec.crc_errors++;
+    else if (e == SD_ERR_TIMEOUT) card->rec.timeouts++;
+    else {
+        card->rec.other_errors++;
+        return;
+    }
+
+    if (++card->err_streak >= SD_DOWNGRADE_AFTER && card->clock_hz / 2u >= SD_CLOCK_MIN_HZ) {
+        sd_set_clock(card, card->clock_hz / 2u);
+        card->rec.downgrades++;
+        card->err_streak = 0;
+    }
+}
+
+static void sd_note_ok(sd_card_t *card)
+{
+    card->err_streak = 0;
+    if (card->clock_hz >= SD_CLOCK_MAX_HZ) return;
+
+    if (++card->ok_streak >= SD_UPGRADE_AFTER) {
+        uint32_t hz = card->clock_hz * 2u;
+        sd_set_clock(card, (hz > SD_CLOCK_MAX_HZ) ? SD_CLOCK_MAX_HZ : hz);
+        card->rec.upgrades++;
+        card->ok_streak = 0;
+    }
+}
+
+static sd_error_t sd_xfer(sd_card_t *card, bool write, uint32_t lba, uint32_t *buf_w, uint32_t block_count)
+{
+    sd_error_t e = SD_OK;
+
+    for (uint32_t attempt = 0; attempt < SD_RETRY_MAX; attempt++)
+    {
+        if (attempt) {
+            card->rec.retries++;
+            sd_delay_ms(SD_BACKOFF_MS << (attempt - 1u));
+        }
+
+        if (!card->initialized) {
+            e = sd_reinit(card);
+            if (e != SD_OK) { sd_note_error(card, e); continue; }
+        }
+
+        e = write ? sd_write_once(card, lba, buf_w, block_count)
+                  : sd_read_once(card, lba, buf_w, block_count);
+        if (e == SD_OK) {
+            sd_note_ok(card);
+            return SD_OK;
+        }
+        if (e == SD_ERR_PARAM) return e;
+
+        sd_note_error(card, e);
+        sd_recover(card);
+    }
+
+    card->rec.failures++;
+    return e;
+}
+
+sd_error_t sd_read_blocks(sd_card_t *card, uint32_t lba, uint32_t *buf_w, uint32_t block_count)
+{
+    if (!card || !card->clock_hz) return SD_ERR_NOT_READY;     // nunca pasó por sd_init()
+    return sd_xfer(card, false, lba, buf_w, block_count);
+}
+
+sd_error_t sd_write_blocks(sd_card_t *card, uint32_t lba, const uint32_t *buf_w, uint32_t block_count)
+{
+    if (!card || !card->clock_hz) return SD_ERR_NOT_READY;
+    return sd_xfer(card, true, lba, (uint32_t *)(uintptr_t)buf_w, block_count);
 }
 
 static sdhc_error_t sd_send_cmd0_with_retry(void)
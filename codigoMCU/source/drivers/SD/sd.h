@@ -13,14 +13,69 @@
 #define SD_CMD_SEND_REL_ADDR        3   // CMD3
 #define SD_CMD_SELECT_CARD          7   // CMD7
 #define SD_CMD_SET_BLOCKLEN         16  // CMD16
+#define SD_CMD_STOP_TRANSMISSION    12  // CMD12
+#define SD_CMD_SEND_STATUS          13  // CMD13
+#define SD_CMD_WRITE_BLOCK          24  // CMD24
+#define SD_CMD_WRITE_MULTIPLE_BLOCK 25  // CMD25
+#define SD_ACMD_SET_WR_BLK_ERASE_COUNT 23  // ACMD23
+
+// Card status (R1)
+#define SD_R1_ERROR_MASK            0xFDF98008u // bits de error: OUT_OF_RANGE .. AKE_SEQ_ERROR
+#define SD_R1_ILLEGAL_COMMAND       (1u << 22)
+#define SD_R1_READY_FOR_DATA        (1u << 8)
+#define SD_R1_APP_CMD               (1u << 5)
+#define SD_R1_CURRENT_STATE(r)      (((r) >> 9) & 0xFu)
+#define SD_STATE_TRAN               4u
+
+#define SD_READY_RETRIES            100000u     // CMD13 mientras la tarjeta programa
+
+// Recuperación de errores (sd_read_blocks / sd_write_blocks)
+#define SD_RETRY_MAX                4u          // intentos por transferencia
+#define SD_BACKOFF_MS               1u          // espera antes de reintentar: 1, 2, 4 ms
+#define SD_DOWNGRADE_AFTER          2u          // errores CRC/timeout seguidos antes de bajar el clock
+#define SD_UPGRADE_AFTER            4096u       // transferencias limpias seguidas antes de subirlo
+#define SD_CLOCK_MAX_HZ             25000000u
+#define SD_CLOCK_MIN_HZ             3000000u    // 1 bit a 3 MHz: ~350 KB/s, sobra para un MP3
+#define SD_CLOCK_INIT_HZ            400000u     // identificación (CMD0 .. CMD3)
+
+// Lecturas en streaming: un CMD18 abierto que sigue en el LBA siguiente
+#ifndef SD_STREAM_READS
+#define SD_STREAM_READS             1
+#endif
 
 #define SD_BLOCK_SIZE 512
+#define SD_MAX_XFER_BLOCKS 127u    // un descriptor ADMA2: hasta 64 KB - 1 por transferencia
+
+typedef struct {
+    uint32_t retries;       // reintentos hechos (no cuenta el primer intento)
+    uint32_t crc_errors;
+    uint32_t timeouts;
+    uint32_t other_errors;  // R1 con error, host, comando ilegal
+    uint32_t downgrades;    // bajadas de clock
+    uint32_t upgrades;
+    uint32_t reinits;       // CMD0 .. CMD7 de nuevo
+    uint32_t failures;      // transferencias que agotaron SD_RETRY_MAX
+} sd_recovery_stats_t;
 
 typedef struct {
     uint16_t rca;       // RCA asignado por CMD3
     bool is_sdhc;       // CCS = 1 => block addressing
     bool initialized;
     uint32_t ocr;      // OCR devuelto por ACMD41 (R3)
+    uint32_t acmd23_ok;     // escrituras multi-bloque con pre-erase aceptado
+    uint32_t acmd23_fail;   // ACMD23 rechazado: CMD25 sin pre-erase
+
+    bool stream_enabled;
+    bool stream_open;           // hay un CMD18 parado en el block gap
+    uint32_t stream_next_lba;   // LBA que la tarjeta manda si se reanuda
+    uint32_t stream_starts;     // CMD18 enviados
+    uint32_t stream_hits;       // lecturas servidas reanudando, sin comando
+    uint32_t stream_stops;      // CMD12 por discontinuidad, escritura o error
+
+    uint32_t clock_hz;          // clock de transferencia actual
+    uint32_t err_streak;
+    uint32_t ok_streak;
+    sd_recovery_stats_t rec;
 } sd_card_t;
 
 typedef enum {
@@ -34,10 +89,27 @@ typedef enum {
     SD_ERR_HOST,
 } sd_error_t;
 
-// Inicialización de tarjeta SD en modo 1-bit, usando el host SDHC. Asume SDHC inicializado
+// Inicialización de tarjeta SD en modo 1-bit, usando el host SDHC. Asume SDHC inicializado.
+// Pone en cero los contadores; las re-inicializaciones por error los conservan.
 sd_error_t sd_init(sd_card_t *card);
 
+/**
+ * Lee block_count bloques con ADMA2. Reintenta con backoff y ajusta el clock
+ * según SD_RETRY_MAX / SD_DOWNGRADE_AFTER; un error vuelve recién cuando se
+ * agotaron los intentos (card->rec.failures). Con streaming habilitado (SD_STREAM_READS)
+ * la lectura queda abierta: si la próxima empieza en el LBA siguiente se reanuda
+ * sin mandar ningún comando; si no, se cierra con CMD12 y se abre otra.
+ */
 sd_error_t sd_read_blocks(sd_card_t *card, uint32_t lba, uint32_t *buf_w, uint32_t block_count);
+/**
+ * Escribe block_count bloques (<= SD_MAX_XFER_BLOCKS) con ADMA2 directo desde buf_w
+ * (alineado a 4). Misma recuperación de errores que sd_read_blocks(). Multi-bloque: ACMD23 + CMD25 con CMD12 automático. Vuelve cuando
+ * la tarjeta terminó de programar (CMD13 en "tran").
+ */
 sd_error_t sd_write_blocks(sd_card_t *card, uint32_t lba, const uint32_t *buf_w, uint32_t block_count);
 
+// Cierra la lectura abierta (CMD12). Se llama sola antes de escribir.
+sd_error_t sd_stream_stop(sd_card_t *card);
+void sd_stream_enable(sd_card_t *card, bool enable);
+
 #endif //SD_H
@@ -47,6 +47,7 @@
 #define SDHC_CARD_DETECTED_FLAGS		(SDHC_IRQSTAT_CINS_MASK | SDHC_IRQSTAT_CRM_MASK)
 #define SDHC_DATA_FLAG					(SDHC_IRQSTAT_BRR_MASK | SDHC_IRQSTAT_BWR_MASK)
 #define SDHC_DATA_TIMEOUT_FLAG			(SDHC_IRQSTAT_DTOE_MASK)
+#define SDHC_STREAM_TIMEOUT				0xFFFFFFu	// vueltas de espera (~1 s): 64 KB tardan ~25 ms a 1 bit / 25 MHz
 #define SDHC_ERROR_FLAG ( \
     SDHC_IRQSTAT_DMAE_MASK  | SDHC_IRQSTAT_AC12E_MASK | SDHC_IRQSTAT_DEBE_MASK | SDHC_IRQSTAT_DCE_MASK | \
     SDHC_IRQSTAT_DTOE_MASK  | \
@@ -90,11 +91,19 @@ typedef struct {
 
 #define ADMA2_VALID     (1u << 0)
 #define ADMA2_END       (1u << 1)
+#define ADMA2_INT       (1u << 2)
 #define ADMA2_ACT_TRAN  (2u << 4)
 
 // 1 descriptor for 1 block (512B)
 static sdhc_adma2_desc_t adma2_desc __attribute__((aligned(32)));
 
+// Streaming: [n-1 bloques con INT] + [último bloque con END]. La IRQ del
+// primero pide el stop at block gap, así el host frena justo después del último.
+static sdhc_adma2_desc_t adma2_stream_desc[2] __attribute__((aligned(32)));
+static volatile bool stream_stop_on_dint = false;
+static sdhc_command_t stream_cmd;
+static sdhc_data_t stream_data;
+
 ///*******************************************************************************
 // * STATIC VARIABLES AND CONST VARIABLES WITH FILE LEVEL SCOPE
 // ******************************************************************************/
@@ -415,6 +424,100 @@ sdhc_error_t sdhc_transfer(sdhc_command_t* command, sdhc_data_t* data)
 	return error;
 }
 
+static void sdhc_prepare_stream_adma2(uint32_t *buf, uint32_t block_count)
+{
+    uint32_t head = (block_count - 1u) * SDHC_STREAM_BLOCK_SIZE;
+
+    if (block_count > 1u) {
+        adma2_stream_desc[0].attr_len = ((head & 0xFFFFu) << 16) | ADMA2_ACT_TRAN | ADMA2_INT | ADMA2_VALID;
+        adma2_stream_desc[0].addr = (uint32_t)(uintptr_t)buf;
+        adma2_stream_desc[1].attr_len = (SDHC_STREAM_BLOCK_SIZE << 16) | ADMA2_ACT_TRAN | ADMA2_END | ADMA2_VALID;
+        adma2_stream_desc[1].addr = (uint32_t)(uintptr_t)buf + head;
+    } else {
+        adma2_stream_desc[0].attr_len = (SDHC_STREAM_BLOCK_SIZE << 16) | ADMA2_ACT_TRAN | ADMA2_END | ADMA2_VALID;
+        adma2_stream_desc[0].addr = (uint32_t)(uintptr_t)buf;
+    }
+    SDHC->ADSADDR = (uint32_t)(uintptr_t)adma2_stream_desc;
+}
+
+sdhc_error_t sdhc_stream_read(uint32_t argument, uint32_t *buf, uint32_t block_count, bool start, uint32_t *r1)
+{
+    if (!buf || (((uintptr_t)buf & 0x3u) != 0u)) return SDHC_ERROR_DATA;
+    if (block_count == 0u || block_count > SDHC_STREAM_MAX_BLOCKS) return SDHC_ERROR_DATA;
+
+    if (start) {
+        uint32_t timeout = 0xFFFFFF;
+        while (timeout-- && (SDHC->PRSSTAT & (SDHC_PRSSTAT_CIHB_MASK | SDHC_PRSSTAT_CDIHB_MASK))) {}
+        if (timeout == 0xFFFFFFFFu) return SDHC_ERROR_CMD_BUSY;
+    }
+
+    stream_cmd = (sdhc_command_t){ .index = 18, .argument = argument,
+                                   .commandType = SDHC_COMMAND_TYPE_NORMAL,
+                                   .responseType = SDHC_RESPONSE_TYPE_R1 };
+    stream_data = (sdhc_data_t){ .blockCount = block_count, .blockSize = SDHC_STREAM_BLOCK_SIZE,
+                                 .readBuffer = buf, .transferMode = SDHC_TRANSFER_MODE_ADMA2 };
+
+    sdhc_status.is_available = false;
+    sdhc_status.transfer_completed = false;
+    sdhc_status.current_error = SDHC_ERROR_OK;
+    sdhc_status.current_command = &stream_cmd;
+    sdhc_status.current_data = &stream_data;    // != NULL: el CC no da por terminada la transferencia
+
+    sdhc_prepare_stream_adma2(buf, block_count);
+    stream_stop_on_dint = (block_count > 1u);
+
+    SDHC->IRQSTATEN = (SDHC->IRQSTATEN & ~(SDHC_IRQSTATEN_BRRSEN_MASK | SDHC_IRQSTATEN_BWRSEN_MASK)) | SDHC_IRQSTATEN_DINTSEN_MASK;
+    SDHC->IRQSIGEN  = (SDHC->IRQSIGEN  & ~(SDHC_IRQSIGEN_BRRIEN_MASK | SDHC_IRQSIGEN_BWRIEN_MASK)) | SDHC_IRQSIGEN_DINTIEN_MASK | SDHC_IRQSIGEN_TCIEN_MASK;
+    SDHC->IRQSTAT = 0xFFFFFFFF;
+
+    if (start) {
+        // CMD18 sin block count ni CMD12 automático: la tarjeta sigue mandando hasta el CMD12
+        SDHC->PROCTL = (SDHC->PROCTL & ~(SDHC_PROCTL_DMAS_MASK | SDHC_PROCTL_RWCTL_MASK | SDHC_PROCTL_SABGREQ_MASK))
+                     | SDHC_PROCTL_DMAS(SDHC_TRANSFER_MODE_ADMA2);
+        if (block_count == 1u) SDHC->PROCTL |= SDHC_PROCTL_SABGREQ_MASK;
+
+        SDHC->BLKATTR = (SDHC->BLKATTR & ~(SDHC_BLKATTR_BLKSIZE_MASK | SDHC_BLKATTR_BLKCNT_MASK)) |
+                        SDHC_BLKATTR_BLKSIZE(SDHC_STREAM_BLOCK_SIZE);
+        SDHC->CMDARG = argument;
+        SDHC->XFERTYP = SDHC_XFERTYP_CMDINX(18) | SDHC_RESPONSE_LENGTH_48 | SDHC_COMMAND_CHECK_CCR |
+                        SDHC_COMMAND_CHECK_INDEX | SDHC_XFERTYP_DPSEL_MASK | SDHC_XFERTYP_DTDSEL_MASK |
+                        SDHC_XFERTYP_MSBSEL_MASK | SDHC_XFERTYP_DMAEN_MASK;
+    } else {
+        // Parado en el block gap con el SDCLK frenado: solo se reanuda, sin comando
+        SDHC->PROCTL &= ~SDHC_PROCTL_SABGREQ_MASK;
+        SDHC->PROCTL |= SDHC_PROCTL_CREQ_MASK;
+        if (block_count == 1u) SDHC->PROCTL |= SDHC_PROCTL_SABGREQ_MASK;
+    }
+
+    // Acotado: una tarjeta que se va a mitad del CMD18 puede no dar ni TC ni DTOE, y el
+    // llamador tiene el mutex de FatFs. El error lo levanta sd_stream_stop() (CMD12) y el retry.
+    uint32_t timeout = SDHC_STREAM_TIMEOUT;
+    while (!sdhc_status.transfer_completed)
+    {
+        if (sdhc_status.current_error != SDHC_ERROR_OK) {
+            stream_stop_on_dint = false;
+            return sdhc_status.current_error;
+        }
+        if (--timeout == 0u) {
+            stream_stop_on_dint = false;
+            return SDHC_ERROR_DATA_TIMEOUT;
+        }
+    }
+
+    if (r1) *r1 = start ? stream_cmd.response[0] : 0u;
+    return SDHC_ERROR_OK;
+}
+
+void sdhc_stream_abort(void)
+{
+    stream_stop_on_dint = false;
+    SDHC->PROCTL &= ~SDHC_PROCTL_SABGREQ_MASK;
+    sdhc_reset(SDHC_RESET_DATA);        // suelta CDIHB; la tarjeta se frena con CMD12 (sd.c)
+    SDHC->IRQSTAT = 0xFFFFFFFF;
+    sdhc_status.is_available = true;
+    sdhc_status.current_data = NULL;
+}
+
 void sdhc_initialization_clocks(void)
 {
 	uint32_t timeout = 0xFFFFFF;
@@ -681,6 +784,16 @@ void SDHC_IRQHandler(void)
             SDHC_DataHandler(status & SDHC_DATA_FLAG);
         }
 
+        if (status & SDHC_IRQSTAT_DINT_MASK)
+        {
+            // Streaming: quedan el último bloque en vuelo, frenar en el gap siguiente
+            if (stream_stop_on_dint) {
+                SDHC->PROCTL |= SDHC_PROCTL_SABGREQ_MASK;
+                stream_stop_on_dint = false;
+            }
+            SDHC->IRQSTAT = SDHC_IRQSTAT_DINT_MASK;
+        }
+
         if (status & SDHC_COMMAND_COMPLETED_FLAG)
         {
             SDHC_CommandCompletedHandler(status & SDHC_COMMAND_COMPLETED_FLAG);
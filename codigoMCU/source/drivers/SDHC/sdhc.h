@@ -9,6 +9,8 @@
 #define SDHC_MAXIMUM_BLOCK_SIZE		4096
 #define SDHC_RESET_TIMEOUT			100000
 #define SDHC_CLOCK_FREQUENCY		(96000000U)
+#define SDHC_STREAM_BLOCK_SIZE		512u
+#define SDHC_STREAM_MAX_BLOCKS		128u	// (n-1) bloques en un descriptor ADMA2 de 64 KB - 1
 
 typedef enum {
 	SDHC_TRANSFER_MODE_CPU,		// Data transfer will be executed by the CPU host
@@ -85,5 +87,12 @@ void sdhc_initialization_clocks(void);
 sdhc_error_t sdhc_transfer(sdhc_command_t* command, sdhc_data_t* data);
 void sdhc_set_clock(uint32_t hz);
 
+// Lectura abierta (CMD18 sin CMD12): start = true manda el comando, si no se
+// reanuda la que quedó parada en el block gap. Vuelve con el host parado
+// después del último bloque pedido. r1: respuesta del CMD18 (solo en start).
+sdhc_error_t sdhc_stream_read(uint32_t argument, uint32_t *buf, uint32_t block_count, bool start, uint32_t *r1);
+// Descarta la lectura abierta del lado del host; después hay que mandar CMD12.
+void sdhc_stream_abort(void);
+
 
 #endif //SDHC_H
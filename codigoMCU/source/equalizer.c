@@ -26,9 +26,17 @@ static float32_t f0[4] = {200, 500, 1000, 1500}; // Center freqency [Hz]
 
 static float32_t fs = 22050;
 
-static float32_t pState[] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+// mismos coeficientes para los dos canales, un estado por canal
+static float32_t pState[EQ_CHANNELS][4 * BANDS_QUANT];
 static float32_t pCoeffs [BANDS_QUANT * 5];
-static arm_biquad_casd_df1_inst_f32 Sequ;
+static arm_biquad_casd_df1_inst_f32 Sequ[EQ_CHANNELS];
+
+static void armFilters(void)
+{
+    for(uint8_t ch = 0; ch < EQ_CHANNELS; ch++){
+        arm_biquad_cascade_df1_init_f32(&Sequ[ch], BANDS_QUANT, pCoeffs, pState[ch]);
+    }
+}
 
 void initEqualizer(){
 
@@ -68,7 +76,7 @@ void initEqualizer(){
             pCoeffs[i*5 + 4] = 0;
         }
     }
-    arm_biquad_cascade_df1_init_f32(&Sequ, 4, pCoeffs, pState);
+    armFilters();
 }
 
 void setUpFilter(float32_t nuevaGananciadB, uint8_t nroBanda){
@@ -95,7 +103,7 @@ void setUpFilter(float32_t nuevaGananciadB, uint8_t nroBanda){
         pCoeffs[nroBanda*5 + 3] = 0;
         pCoeffs[nroBanda*5 + 4] = 0;
     }
-    arm_biquad_cascade_df1_init_f32(&Sequ, 4, pCoeffs, pState);
+    armFilters();
 }
 
 void setGenre(Genre_t genre_id)
@@ -106,8 +114,20 @@ void setGenre(Genre_t genre_id)
     }
 }
 
-void blockEqualizer(const float32_t * pSrc, float32_t * pDst, uint32_t 	blockSize){
-    arm_biquad_cascade_df1_f32(&Sequ, pSrc, pDst, blockSize);
+void setEqualizerSampleRate(uint32_t fs_hz)
+{
+    if (fs_hz == 0 || (float32_t)fs_hz == fs) return;
+
+    // los centros y anchos están en Hz: mismas ganancias, nueva fs
+    fs = (float32_t)fs_hz;
+    for(uint8_t i=0; i<BANDS_QUANT; i++)
+    {
+        setUpFilter(G[i], i);
+    }
+}
+
+void blockEqualizer(uint8_t channel, const float32_t * pSrc, float32_t * pDst, uint32_t 	blockSize){
+    arm_biquad_cascade_df1_f32(&Sequ[channel], pSrc, pDst, blockSize);
 }
 
 void eq_preset_to_str(Genre_t genre, char *str) 
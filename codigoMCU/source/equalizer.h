@@ -12,6 +12,8 @@ typedef enum {
 
 #include <arm_math.h>
 
+#define EQ_CHANNELS 2   // L, R
+
 /*!
  * @brief Initializes the filter and the genres array for equalization
  */
@@ -26,12 +28,20 @@ void setGenre(Genre_t genre_id);
 /*!
  * @brief Applies the IIR biquad filtering of 4 bands according to th settings
  *
+ * @param channel: 0 (left) or 1 (right); each one keeps its own filter state
  * @param pSrc: signal array passed by reference, array with data to filter
  * @param pDst: pointer to the array after processing
  * @param blockSize: array's size of pSrc and pDst
  */
-void blockEqualizer(const float32_t * pSrc, float32_t * pDst, uint32_t 	blockSize);
+void blockEqualizer(uint8_t channel, const float32_t * pSrc, float32_t * pDst, uint32_t 	blockSize);
 
 void eq_preset_to_str(Genre_t genre, char *str);
 
+/*!
+ * @brief Recomputes the coefficients of the current preset for a new sample rate
+ *
+ * @param fs_hz: sample rate of the samples that will go through blockEqualizer
+ */
+void setEqualizerSampleRate(uint32_t fs_hz);
+
 #endif // _EQUALIZER_H_
\ No newline at end of file
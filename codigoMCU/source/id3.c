@@ -0,0 +1,202 @@
+/**
+ * @file     id3.c
+ * @brief    Streaming ID3v2 / ID3v1 tag reader (title, artist, album, length).
+ *
+ * Supports ID3v2.2 (3-char ids, 24-bit sizes), v2.3 (32-bit sizes) and v2.4
+ * (syncsafe sizes, per-frame flags). Tags with tag-level unsynchronisation
+ * (v2.2/v2.3) and compressed/encrypted frames are ignored; ID3v1 still fills
+ * in whatever is missing.
+ *
+ * @author   Grupo 3
+ */
+
+#include "id3.h"
+#include <string.h>
+
+#define ID3_HDR_LEN         10u
+#define ID3_V1_LEN          128u
+#define ID3_READ_MAX        (2u * ID3_TEXT_LEN + 3u)   // encoding + BOM + UTF-16 text
+
+typedef enum {
+    ID3_FIELD_TITLE = 0,
+    ID3_FIELD_ARTIST,
+    ID3_FIELD_ALBUM,
+    ID3_FIELD_LENGTH,
+    ID3_FIELD_COUNT,
+} id3_field_t;
+
+#define ID3_FIELDS_ALL      ((1u << ID3_FIELD_COUNT) - 1u)
+
+static const char k_ids_v3[ID3_FIELD_COUNT][4] = { "TIT2", "TPE1", "TALB", "TLEN" };
+static const char k_ids_v2[ID3_FIELD_COUNT][3] = { "TT2",  "TP1",  "TAL",  "TLE"  };
+
+static uint8_t g_buf[ID3_READ_MAX];
+
+static inline uint32_t syncsafe32(const uint8_t *p)
+{
+    return ((uint32_t)(p[0] & 0x7Fu) << 21) | ((uint32_t)(p[1] & 0x7Fu) << 14) |
+           ((uint32_t)(p[2] & 0x7Fu) << 7)  |  (uint32_t)(p[3] & 0x7Fu);
+}
+
+static inline uint32_t be32(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+static void put_char(char *out, uint32_t *n, uint32_t c)
+{
+    if (*n >= ID3_TEXT_LEN - 1u) return;
+    out[(*n)++] = (c >= 0x20u && c < 0x7Fu) ? (char)c : '?';
+}
+
+// enc: 0 ISO-8859-1, 1 UTF-16 con BOM, 2 UTF-16BE, 3 UTF-8
+static void decode_text(uint8_t enc, const uint8_t *p, uint32_t len, char *out)
+{
+    uint32_t n = 0;
+
+    if (enc == 1u || enc == 2u) {
+        bool be = (enc == 2u);
+        if (enc == 1u && len >= 2u) {
+            if (p[0] == 0xFFu && p[1] == 0xFEu)      { be = false; p += 2; len -= 2u; }
+            else if (p[0] == 0xFEu && p[1] == 0xFFu) { be = true;  p += 2; len -= 2u; }
+        }
+        for (uint32_t i = 0; i + 1u < len; i += 2u) {
+            uint32_t c = be ? (((uint32_t)p[i] << 8) | p[i + 1u]) : (((uint32_t)p[i + 1u] << 8) | p[i]);
+            if (c == 0u) break;
+            if (c >= 0xDC00u && c <= 0xDFFFu) continue;     // segunda mitad de un surrogate
+            put_char(out, &n, c);
+        }
+    } else {
+        for (uint32_t i = 0; i < len; i++) {
+            uint32_t c = p[i];
+            if (c == 0u) break;
+            if (enc == 3u && (c & 0xC0u) == 0x80u) continue; // bytes de continuación UTF-8
+            put_char(out, &n, c);
+        }
+    }
+
+    // ID3v1 rellena con espacios
+    while (n > 0u && out[n - 1u] == ' ') n--;
+    out[n] = '\0';
+}
+
+static void store(id3_field_t field, const uint8_t *p, uint32_t len, id3_meta_t *meta)
+{
+    char tmp[ID3_TEXT_LEN];
+
+    if (len == 0u) return;
+
+    switch (field) {
+        case ID3_FIELD_TITLE:  decode_text(p[0], &p[1], len - 1u, meta->title);  break;
+        case ID3_FIELD_ARTIST: decode_text(p[0], &p[1], len - 1u, meta->artist); break;
+        case ID3_FIELD_ALBUM:  decode_text(p[0], &p[1], len - 1u, meta->album);  break;
+        case ID3_FIELD_LENGTH:
+            decode_text(p[0], &p[1], len - 1u, tmp);
+            meta->length_ms = 0;
+            for (const char *c = tmp; *c >= '0' && *c <= '9'; c++) {
+                meta->length_ms = meta->length_ms * 10u + (uint32_t)(*c - '0');
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+static int frame_field(const uint8_t *fh, uint8_t ver)
+{
+    for (uint32_t f = 0; f < ID3_FIELD_COUNT; f++) {
+        if (ver == 2u ? (memcmp(fh, k_ids_v2[f], 3) == 0) : (memcmp(fh, k_ids_v3[f], 4) == 0)) return (int)f;
+    }
+    return -1;
+}
+
+static void read_v2(FIL *fp, const uint8_t *hdr, id3_meta_t *meta)
+{
+    uint8_t  ver    = hdr[3];
+    uint8_t  flags  = hdr[5];
+    uint32_t end    = ID3_HDR_LEN + syncsafe32(&hdr[6]);
+    uint32_t pos    = ID3_HDR_LEN;
+    uint32_t fh_len = (ver == 2u) ? 6u : 10u;
+    uint32_t found  = 0;
+    uint8_t  fh[10];
+    UINT br;
+
+    // unsync a nivel tag (v2.2/v2.3): habría que des-sincronizar todo el tag
+    if ((flags & 0x80u) && ver < 4u) return;
+
+    if ((flags & 0x40u) && ver >= 3u) {
+        // extended header: v2.3 no cuenta sus 4 bytes de tamaño, v2.4 sí
+        if (f_read(fp, fh, 4, &br) != FR_OK || br != 4u) return;
+        pos += (ver == 4u) ? syncsafe32(fh) : 4u + be32(fh);
+    }
+
+    // tope de frames y de bytes: detrás de un APIC grande no se sigue buscando
+    uint32_t limit = (end < ID3_SCAN_BYTES) ? end : ID3_SCAN_BYTES;
+    for (uint32_t i = 0; i < ID3_MAX_FRAMES && found != ID3_FIELDS_ALL && pos + fh_len <= limit; i++) {
+        if (f_lseek(fp, pos) != FR_OK) return;
+        if (f_read(fp, fh, fh_len, &br) != FR_OK || br != fh_len) return;
+        if (fh[0] == 0u) return;    // padding: no hay más frames
+
+        uint32_t size;
+        if (ver == 2u)      size = ((uint32_t)fh[3] << 16) | ((uint32_t)fh[4] << 8) | fh[5];
+        else if (ver == 3u) size = be32(&fh[4]);
+        else                size = syncsafe32(&fh[4]);
+
+        pos += fh_len + size;
+        if (pos > end) return;
+
+        // APIC y cualquier otro frame: el próximo lseek lo saltea sin leerlo
+        int field = frame_field(fh, ver);
+        if (field < 0) continue;
+
+        uint32_t skip = 0;
+        if (ver == 3u && (fh[9] & 0xC0u)) continue;     // comprimido / encriptado
+        if (ver == 4u) {
+            if (fh[9] & 0x0Eu) continue;                // comprimido / encriptado / unsync
+            if (fh[9] & 0x01u) skip = 4u;               // data length indicator
+        }
+        if (size <= skip) continue;
+
+        uint32_t n = size - skip;
+        if (n > ID3_READ_MAX) n = ID3_READ_MAX;
+        if (skip && f_lseek(fp, f_tell(fp) + skip) != FR_OK) return;
+        if (f_read(fp, g_buf, n, &br) != FR_OK) return;
+
+        store((id3_field_t)field, g_buf, br, meta);
+        found |= 1u << field;
+    }
+}
+
+static void read_v1(FIL *fp, id3_meta_t *meta)
+{
+    UINT br;
+
+    if (f_size(fp) < ID3_V1_LEN) return;
+    if (f_lseek(fp, f_size(fp) - ID3_V1_LEN) != FR_OK) return;
+    if (f_read(fp, g_buf, 3, &br) != FR_OK || br != 3u || memcmp(g_buf, "TAG", 3) != 0) return;
+
+    // title[30] artist[30] album[30], Latin-1 con relleno de espacios/ceros
+    if (f_read(fp, g_buf, 90, &br) != FR_OK || br != 90u) return;
+    if (!meta->title[0])  decode_text(0u, &g_buf[0],  30u, meta->title);
+    if (!meta->artist[0]) decode_text(0u, &g_buf[30], 30u, meta->artist);
+    if (!meta->album[0])  decode_text(0u, &g_buf[60], 30u, meta->album);
+}
+
+bool ID3_Read(FIL *fp, id3_meta_t *meta)
+{
+    uint8_t hdr[ID3_HDR_LEN];
+    UINT br;
+
+    if (!fp || !meta) return false;
+    memset(meta, 0, sizeof(*meta));
+
+    if (f_lseek(fp, 0) == FR_OK &&
+        f_read(fp, hdr, sizeof(hdr), &br) == FR_OK && br == sizeof(hdr) &&
+        hdr[0] == 'I' && hdr[1] == 'D' && hdr[2] == '3' && hdr[3] >= 2u && hdr[3] <= 4u) {
+        read_v2(fp, hdr, meta);
+    }
+
+    if (!meta->title[0] || !meta->artist[0] || !meta->album[0]) read_v1(fp, meta);
+
+    return meta->title[0] || meta->artist[0] || meta->album[0] || meta->length_ms;
+}
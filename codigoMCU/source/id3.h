@@ -0,0 +1,44 @@
+/**
+ * @file     id3.h
+ * @brief    Streaming ID3v2 / ID3v1 tag reader (title, artist, album, length).
+ *
+ * Only frame headers are walked: the payload of a text frame we care about is
+ * read (truncated to ::ID3_TEXT_LEN), every other frame (APIC, PRIV, GEOB...)
+ * is skipped with a seek and never touches RAM. Text is reduced to printable
+ * ASCII for the LCD, anything else becomes '?'.
+ *
+ * The walk stops at ::ID3_MAX_FRAMES frames or at the first frame header past
+ * ::ID3_SCAN_BYTES, whichever comes first: taggers put the text frames first,
+ * so a tag that hides them behind large embedded art is left to ID3v1.
+ *
+ * @author   Grupo 3
+ */
+
+#ifndef ID3_H_
+#define ID3_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "drivers/FAT/ff.h"
+
+#define ID3_TEXT_LEN        48u     // incl. '\0'
+#define ID3_MAX_FRAMES      32u     // frame headers walked before giving up
+#define ID3_SCAN_BYTES      4096u   // only frames starting in the first bytes of the file
+
+typedef struct {
+    char     title[ID3_TEXT_LEN];   // TIT2 / TT2
+    char     artist[ID3_TEXT_LEN];  // TPE1 / TP1
+    char     album[ID3_TEXT_LEN];   // TALB / TAL
+    uint32_t length_ms;             // TLEN / TLE, 0 if absent
+} id3_meta_t;
+
+/**
+ * @brief Reads the ID3v2 tag at the start of @p fp, falling back to the
+ *        ID3v1 tag at the end of the file for missing fields.
+ *
+ * Leaves the file pointer anywhere.
+ * @return true if at least one field was found.
+ */
+bool ID3_Read(FIL *fp, id3_meta_t *meta);
+
+#endif /* ID3_H_ */
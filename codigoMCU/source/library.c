@@ -0,0 +1,826 @@
+/**
+ * @file     library.c
+ * @brief    Track library with a persistent, sorted on-card index.
+ *
+ * File layout (little endian), shared by the index and the temporary files
+ * used while sorting:
+ *   sector 0  : library_hdr_t (only meaningful in the index)
+ *   sector 1+ : library_rec_t records, LIBRARY_RECS_PER_SECTOR per sector
+ * Names go to a separate string file as [len][chars] (no terminator),
+ * followed by the ID3 title, artist and album in the same format; each
+ * record keeps the offset and length of its name plus a short sort key, so
+ * most comparisons never touch the string file.
+ *
+ * Rebuild pipeline, each phase advanced a little per Library_ScanStep():
+ *   LIB_SCAN  : directory entries checked against the index; from the first
+ *               difference on (new, changed or missing track) the directory is
+ *               walked again writing records -> LIBTMPA.TMP + names -> LIBTMPS.TMP
+ *   LIB_RUNS  : sorted runs of LIBRARY_RUN_RECORDS records -> LIBTMPB.TMP
+ *   LIB_MERGE : pairwise merge passes, ping-pong between the two temp files
+ * Records keep pointing into LIBTMPS.TMP while sorting. The pass that
+ * produces a single run writes LIBRARY.NEW and LIBRARY.NST (names copied in
+ * sorted order, fence table filled on the way), which then replace the index
+ * and the string file.
+ *
+ * @author   Grupo 3
+ */
+
+#include "library.h"
+#include "mp3_player.h"
+#include "id3.h"
+#include <string.h>
+#include <ctype.h>
+
+#define LIBRARY_MAGIC           "MLIB"
+#define LIBRARY_VERSION         4u
+#define LIBRARY_HDR_SIZE        512u
+#define LIBRARY_NEW_PATH        "0:/LIBRARY.NEW"
+#define LIBRARY_NEW_STR_PATH    "0:/LIBRARY.NST"
+#define LIBRARY_TMP_A_PATH      "0:/LIBTMPA.TMP"
+#define LIBRARY_TMP_B_PATH      "0:/LIBTMPB.TMP"
+#define LIBRARY_TMP_STR_PATH    "0:/LIBTMPS.TMP"
+#define LIBRARY_ARENA_SIZE      (LIBRARY_RUN_RECORDS * LIBRARY_NAME_LEN + 1u)
+#define LIBRARY_INVALID         0xFFFFFFFFu
+
+typedef struct {
+    uint32_t name_off;                      // offset of [len][chars] in the string file
+    uint8_t  name_len;
+    char     key[LIBRARY_KEY_LEN];          // lower-case name prefix, '\0' padded
+    uint32_t size;
+    uint32_t sclust;
+    uint32_t duration_ms;
+    uint16_t fdate;
+    uint16_t ftime;
+    uint32_t reserved;
+} library_rec_t;
+
+typedef struct {
+    char     magic[4];
+    uint16_t version;
+    uint16_t fence_count;
+    uint32_t count;
+    uint16_t dir_fdate;
+    uint16_t dir_ftime;
+    uint32_t fence_stride;                  // sectors covered by each fence
+    uint32_t str_size;                      // expected size of the string file
+    char     fence[LIBRARY_FENCE_MAX][LIBRARY_KEY_LEN];
+} library_hdr_t;
+
+// Chequeos de layout en compilación
+typedef char library_rec_size_check[(sizeof(library_rec_t) == LIBRARY_REC_SIZE) ? 1 : -1];
+typedef char library_hdr_size_check[(sizeof(library_hdr_t) <= LIBRARY_HDR_SIZE) ? 1 : -1];
+typedef char library_name_len_check[(LIBRARY_NAME_LEN <= 256u) ? 1 : -1];
+
+typedef enum {
+    LIB_IDLE = 0,
+    LIB_SCAN,
+    LIB_RUNS,
+    LIB_MERGE,
+} library_phase_t;
+
+static char g_dir[LIBRARY_DIR_LEN];
+static uint16_t g_dir_fdate = 0;
+static uint16_t g_dir_ftime = 0;
+
+// Índice activo
+static FIL g_idx;
+static FIL g_str;
+static bool g_idx_open = false;
+static library_hdr_t g_hdr;
+static volatile uint32_t g_count = 0;
+
+// Cache de una página (un sector de registros) y del último track leído
+static library_rec_t g_page[LIBRARY_RECS_PER_SECTOR] __attribute__((aligned(4)));
+static uint32_t g_page_sect = LIBRARY_INVALID;
+static library_track_t g_view;
+static uint32_t g_view_idx = LIBRARY_INVALID;
+
+// Cursor del menú
+static library_track_t g_cursor;
+static uint32_t g_cursor_idx = 0;
+static volatile bool g_cursor_valid = false;
+
+// Reconstrucción en background
+static library_phase_t g_phase = LIB_IDLE;
+static DIR g_scan_dir;
+static FILINFO g_fno;
+static char g_path[LIBRARY_PATH_LEN];
+static id3_meta_t g_meta;
+static FIL g_src_a;
+static FIL g_src_b;
+static FIL g_src_str;
+static FIL g_dst;
+static FIL g_dst_str;
+static library_hdr_t g_new_hdr;
+static uint32_t g_new_count = 0;
+static bool g_changed = false;        // temporales abiertos: el índice se va a reescribir
+static bool g_final = false;
+static uint8_t g_src_file = 0;      // 0: LIBTMPA es la fuente, 1: LIBTMPB
+static uint32_t g_run_len = 0;
+static uint32_t g_pos = 0;
+static uint32_t g_out = 0;
+static uint32_t g_a, g_a_end, g_b, g_b_end;
+static library_rec_t g_head_a;
+static library_rec_t g_head_b;
+static char g_name_a[LIBRARY_NAME_LEN];
+static char g_name_b[LIBRARY_NAME_LEN];
+
+// Run en RAM: registros + nombres empaquetados [len][chars] en un arena
+static library_rec_t g_run[LIBRARY_RUN_RECORDS];
+static uint8_t g_arena[LIBRARY_ARENA_SIZE];
+static uint16_t g_run_name[LIBRARY_RUN_RECORDS];   // offset del nombre en g_arena
+static uint8_t g_order[LIBRARY_RUN_RECORDS];
+
+static inline FSIZE_t rec_off(uint32_t idx)
+{
+    return (FSIZE_t)LIBRARY_HDR_SIZE + (FSIZE_t)idx * LIBRARY_REC_SIZE;
+}
+
+static int name_cmp_len(const char *a, uint32_t la, const char *b, uint32_t lb)
+{
+    uint32_t n = (la < lb) ? la : lb;
+    for (uint32_t i = 0; i < n; i++) {
+        int d = tolower((unsigned char)a[i]) - tolower((unsigned char)b[i]);
+        if (d) return d;
+    }
+    return (int)la - (int)lb;
+}
+
+static int name_cmp(const char *a, const char *b)
+{
+    return name_cmp_len(a, strlen(a), b, strlen(b));
+}
+
+static void make_key(const char *name, char key[LIBRARY_KEY_LEN])
+{
+    bool end = false;
+    for (uint32_t i = 0; i < LIBRARY_KEY_LEN; i++) {
+        if (!end && name[i] == '\0') end = true;
+        key[i] = end ? '\0' : (char)tolower((unsigned char)name[i]);
+    }
+}
+
+// El key es un prefijo en minúsculas: si difiere decide solo, si no hay que mirar el nombre
+static int rec_cmp(const library_rec_t *ra, const char *na, const library_rec_t *rb, const char *nb)
+{
+    int d = memcmp(ra->key, rb->key, LIBRARY_KEY_LEN);
+    if (d) return d;
+    return name_cmp_len(na, ra->name_len, nb, rb->name_len);
+}
+
+static void dir_stamp(const char *dir, uint16_t *fdate, uint16_t *ftime)
+{
+    FILINFO fno;
+
+    // el root no tiene entrada de directorio => sin stamp, lo valida el rescan
+    *fdate = 0;
+    *ftime = 0;
+    if (f_stat(dir, &fno) == FR_OK) {
+        *fdate = fno.fdate;
+        *ftime = fno.ftime;
+    }
+}
+
+static bool read_rec(FIL *fp, library_rec_t *r)
+{
+    UINT br;
+    return (f_read(fp, r, LIBRARY_REC_SIZE, &br) == FR_OK) && (br == LIBRARY_REC_SIZE);
+}
+
+static bool read_name(FIL *fp, const library_rec_t *r, char *out)
+{
+    UINT br;
+    uint8_t len;
+
+    if (f_lseek(fp, r->name_off) != FR_OK) return false;
+    if (f_read(fp, &len, 1, &br) != FR_OK || br != 1u || len != r->name_len) return false;
+    if (f_read(fp, out, len, &br) != FR_OK || br != len) return false;
+    out[len] = '\0';
+    return true;
+}
+
+static bool write_str(FIL *fp, const char *str, uint8_t len)
+{
+    UINT bw;
+
+    if (f_write(fp, &len, 1, &bw) != FR_OK || bw != 1u) return false;
+    return (f_write(fp, str, len, &bw) == FR_OK) && (bw == len);
+}
+
+static bool write_name(FIL *fp, const char *name, uint8_t len, uint32_t *off)
+{
+    *off = (uint32_t)f_tell(fp);
+    return write_str(fp, name, len);
+}
+
+// Lee un string [len][chars] en la posición actual
+static bool read_str(FIL *fp, char *out, uint32_t max)
+{
+    UINT br;
+    uint8_t len;
+
+    if (f_read(fp, &len, 1, &br) != FR_OK || br != 1u || len >= max) return false;
+    if (f_read(fp, out, len, &br) != FR_OK || br != len) return false;
+    out[len] = '\0';
+    return true;
+}
+
+// Metadata ID3: title, artist, album, inmediatamente después del nombre
+static bool write_meta(FIL *fp, const char *title, const char *artist, const char *album)
+{
+    return write_str(fp, title, (uint8_t)strlen(title)) &&
+           write_str(fp, artist, (uint8_t)strlen(artist)) &&
+           write_str(fp, album, (uint8_t)strlen(album));
+}
+
+static bool read_meta(FIL *fp, library_track_t *t)
+{
+    return read_str(fp, t->title, ID3_TEXT_LEN) &&
+           read_str(fp, t->artist, ID3_TEXT_LEN) &&
+           read_str(fp, t->album, ID3_TEXT_LEN);
+}
+
+/*******************************************************************************
+ * Active index
+ ******************************************************************************/
+
+static void index_close(void)
+{
+    if (g_idx_open) {
+        f_close(&g_idx);
+        f_close(&g_str);
+    }
+    g_idx_open = false;
+    g_count = 0;
+    g_page_sect = LIBRARY_INVALID;
+    g_view_idx = LIBRARY_INVALID;
+    memset(&g_hdr, 0, sizeof(g_hdr));
+}
+
+static bool index_open(void)
+{
+    UINT br;
+
+    index_close();
+    if (f_open(&g_idx, LIBRARY_INDEX_PATH, FA_READ) != FR_OK) return false;
+    if (f_open(&g_str, LIBRARY_STRINGS_PATH, FA_READ) != FR_OK) {
+        f_close(&g_idx);
+        return false;
+    }
+    g_idx_open = true;
+
+    bool ok = (f_read(&g_idx, &g_hdr, sizeof(g_hdr), &br) == FR_OK) && (br == sizeof(g_hdr)) &&
+              (memcmp(g_hdr.magic, LIBRARY_MAGIC, 4) == 0) &&
+              (g_hdr.version == LIBRARY_VERSION) &&
+              (g_hdr.fence_count <= LIBRARY_FENCE_MAX) &&
+              (g_hdr.count == 0u || g_hdr.fence_stride > 0u) &&
+              (f_size(&g_idx) >= rec_off(g_hdr.count)) &&
+              (f_size(&g_str) == g_hdr.str_size) &&
+              (g_hdr.dir_fdate == g_dir_fdate) && (g_hdr.dir_ftime == g_dir_ftime);
+
+    if (!ok) {
+        index_close();
+        return false;
+    }
+
+    g_count = g_hdr.count;
+    return true;
+}
+
+static const library_rec_t *get_rec(uint32_t idx)
+{
+    UINT br;
+
+    if (!g_idx_open || idx >= g_count) return NULL;
+
+    uint32_t sect = idx / LIBRARY_RECS_PER_SECTOR;
+    uint32_t slot = idx % LIBRARY_RECS_PER_SECTOR;
+
+    if (sect != g_page_sect) {
+        g_page_sect = LIBRARY_INVALID;
+        if (f_lseek(&g_idx, LIBRARY_HDR_SIZE + (FSIZE_t)sect * 512u) != FR_OK) return NULL;
+        if (f_read(&g_idx, g_page, sizeof(g_page), &br) != FR_OK) return NULL;
+        if (br < (slot + 1u) * LIBRARY_REC_SIZE) return NULL;
+        g_page_sect = sect;
+    }
+    return &g_page[slot];
+}
+
+/*******************************************************************************
+ * Rebuild helpers
+ ******************************************************************************/
+
+static void rebuild_abort(void)
+{
+    f_closedir(&g_scan_dir);
+    f_close(&g_src_a);
+    f_close(&g_src_b);
+    f_close(&g_src_str);
+    f_close(&g_dst);
+    f_close(&g_dst_str);
+    f_unlink(LIBRARY_TMP_A_PATH);
+    f_unlink(LIBRARY_TMP_B_PATH);
+    f_unlink(LIBRARY_TMP_STR_PATH);
+    f_unlink(LIBRARY_NEW_PATH);
+    f_unlink(LIBRARY_NEW_STR_PATH);
+    g_phase = LIB_IDLE;
+}
+
+static bool open_output(uint32_t out_run_len)
+{
+    g_final = (out_run_len >= g_new_count);
+    const char *path = g_final ? LIBRARY_NEW_PATH : (g_src_file ? LIBRARY_TMP_A_PATH : LIBRARY_TMP_B_PATH);
+
+    if (f_open(&g_dst, path, FA_CREATE_ALWAYS | FA_WRITE) != FR_OK) return false;
+    if (f_lseek(&g_dst, LIBRARY_HDR_SIZE) != FR_OK) return false;
+    g_out = 0;
+
+    if (g_final) {
+        uint32_t nsect  = (g_new_count + LIBRARY_RECS_PER_SECTOR - 1u) / LIBRARY_RECS_PER_SECTOR;
+        uint32_t stride = (nsect + LIBRARY_FENCE_MAX - 1u) / LIBRARY_FENCE_MAX;
+        if (stride == 0u) stride = 1u;
+
+        if (f_open(&g_dst_str, LIBRARY_NEW_STR_PATH, FA_CREATE_ALWAYS | FA_WRITE) != FR_OK) return false;
+
+        memset(&g_new_hdr, 0, sizeof(g_new_hdr));
+        memcpy(g_new_hdr.magic, LIBRARY_MAGIC, 4);
+        g_new_hdr.version      = LIBRARY_VERSION;
+        g_new_hdr.count        = g_new_count;
+        g_new_hdr.dir_fdate    = g_dir_fdate;
+        g_new_hdr.dir_ftime    = g_dir_ftime;
+        g_new_hdr.fence_stride = stride;
+        g_new_hdr.fence_count  = (uint16_t)((nsect + stride - 1u) / stride);
+    }
+    return true;
+}
+
+static bool emit(const library_rec_t *r, const char *name)
+{
+    library_rec_t out = *r;
+    UINT bw;
+
+    if (g_final) {
+        // en la pasada final los nombres (y su metadata) se copian en orden al nuevo arena
+        if (!write_name(&g_dst_str, name, r->name_len, &out.name_off)) return false;
+        if (f_lseek(&g_src_str, r->name_off + 1u + r->name_len) != FR_OK) return false;
+        if (!read_meta(&g_src_str, &g_view)) return false;
+        g_view_idx = LIBRARY_INVALID;   // g_view usado como buffer
+        if (!write_meta(&g_dst_str, g_view.title, g_view.artist, g_view.album)) return false;
+
+        uint32_t span = g_new_hdr.fence_stride * LIBRARY_RECS_PER_SECTOR;
+        if ((g_out % span) == 0u) memcpy(g_new_hdr.fence[g_out / span], r->key, LIBRARY_KEY_LEN);
+    }
+    g_out++;
+    return (f_write(&g_dst, &out, LIBRARY_REC_SIZE, &bw) == FR_OK) && (bw == LIBRARY_REC_SIZE);
+}
+
+static bool commit(void)
+{
+    UINT bw;
+    uint32_t cursor_idx = g_cursor_idx;
+    bool had_cursor = g_cursor_valid;
+
+    g_new_hdr.str_size = (uint32_t)f_size(&g_dst_str);
+    bool ok = (f_lseek(&g_dst, 0) == FR_OK) &&
+              (f_write(&g_dst, &g_new_hdr, sizeof(g_new_hdr), &bw) == FR_OK) && (bw == sizeof(g_new_hdr));
+    ok = (f_close(&g_dst) == FR_OK) && ok;
+    ok = (f_close(&g_dst_str) == FR_OK) && ok;
+
+    f_close(&g_src_str);
+    f_unlink(LIBRARY_TMP_A_PATH);
+    f_unlink(LIBRARY_TMP_B_PATH);
+    f_unlink(LIBRARY_TMP_STR_PATH);
+    g_phase = LIB_IDLE;
+    if (!ok) {
+        f_unlink(LIBRARY_NEW_PATH);
+        f_unlink(LIBRARY_NEW_STR_PATH);
+        return false;
+    }
+
+    // reemplazo: primero los nombres, el índice al final (str_size detecta un corte a mitad)
+    index_close();
+    f_unlink(LIBRARY_STRINGS_PATH);
+    f_unlink(LIBRARY_INDEX_PATH);
+    if (f_rename(LIBRARY_NEW_STR_PATH, LIBRARY_STRINGS_PATH) != FR_OK) return false;
+    if (f_rename(LIBRARY_NEW_PATH, LIBRARY_INDEX_PATH) != FR_OK) return false;
+    (void)index_open();
+
+    // el cursor sigue apuntando al mismo tema aunque haya cambiado de posición
+    if (had_cursor) cursor_idx = Library_FindPrefix(g_cursor.name);
+    if (cursor_idx >= g_count) cursor_idx = 0;
+    (void)Library_Seek(cursor_idx);
+    return true;
+}
+
+static bool load_head(FIL *fp, library_rec_t *r, char *name)
+{
+    return read_rec(fp, r) && read_name(&g_src_str, r, name);
+}
+
+static bool load_pair(void)
+{
+    g_a     = g_pos;
+    g_a_end = g_pos + g_run_len;
+    if (g_a_end > g_new_count) g_a_end = g_new_count;
+    g_b     = g_a_end;
+    g_b_end = g_pos + 2u * g_run_len;
+    if (g_b_end > g_new_count) g_b_end = g_new_count;
+
+    if (f_lseek(&g_src_a, rec_off(g_a)) != FR_OK) return false;
+    if (f_lseek(&g_src_b, rec_off(g_b)) != FR_OK) return false;
+    if (g_a < g_a_end && !load_head(&g_src_a, &g_head_a, g_name_a)) return false;
+    if (g_b < g_b_end && !load_head(&g_src_b, &g_head_b, g_name_b)) return false;
+    return true;
+}
+
+static bool start_merge_pass(void)
+{
+    const char *src = g_src_file ? LIBRARY_TMP_B_PATH : LIBRARY_TMP_A_PATH;
+
+    // dos FIL sobre el mismo archivo: cada run se lee secuencial con su propio buffer de sector
+    if (f_open(&g_src_a, src, FA_READ) != FR_OK) return false;
+    if (f_open(&g_src_b, src, FA_READ) != FR_OK) return false;
+    if (!open_output(2u * g_run_len)) return false;
+
+    g_pos = 0;
+    g_phase = LIB_MERGE;
+    return load_pair();
+}
+
+// Fin de una pasada (runs o merge): o se publica el índice o se arranca la próxima pasada
+static bool end_pass(void)
+{
+    f_close(&g_src_a);
+    f_close(&g_src_b);
+
+    if (g_final) return commit();
+
+    if (f_close(&g_dst) != FR_OK) return false;
+    g_run_len = (g_phase == LIB_RUNS) ? LIBRARY_RUN_RECORDS : 2u * g_run_len;
+    g_src_file ^= 1u;
+    return start_merge_pass();
+}
+
+static bool start_runs(void)
+{
+    if (f_close(&g_dst) != FR_OK) return false;
+    if (f_close(&g_dst_str) != FR_OK) return false;
+
+    g_src_file = 0;
+    if (f_open(&g_src_str, LIBRARY_TMP_STR_PATH, FA_READ) != FR_OK) return false;
+    if (f_open(&g_src_a, LIBRARY_TMP_A_PATH, FA_READ) != FR_OK) return false;
+    if (f_lseek(&g_src_a, LIBRARY_HDR_SIZE) != FR_OK) return false;
+    if (!open_output(LIBRARY_RUN_RECORDS)) return false;
+
+    g_pos = 0;
+    g_phase = LIB_RUNS;
+    if (g_new_count == 0u) return end_pass();
+    return true;
+}
+
+static const library_track_t *find_exact(const char *name)
+{
+    const library_track_t *t = Library_Get(Library_FindPrefix(name));
+    return (t && strcmp(t->name, name) == 0) ? t : NULL;
+}
+
+// Mismo nombre, tamaño y fecha que en el índice => no hace falta abrir el archivo
+static const library_track_t *find_indexed(const FILINFO *fno)
+{
+    const library_track_t *old = find_exact(fno->fname);
+    if (old && old->size == (uint32_t)fno->fsize && old->fdate == fno->fdate && old->ftime == fno->ftime) {
+        return old;
+    }
+    return NULL;
+}
+
+// Primer cambio: recién ahora se crean los temporales y se vuelve a recorrer el directorio
+static bool start_writing(void)
+{
+    if (f_open(&g_dst, LIBRARY_TMP_A_PATH, FA_CREATE_ALWAYS | FA_WRITE) != FR_OK) return false;
+    if (f_lseek(&g_dst, LIBRARY_HDR_SIZE) != FR_OK) return false;
+    if (f_open(&g_dst_str, LIBRARY_TMP_STR_PATH, FA_CREATE_ALWAYS | FA_WRITE) != FR_OK) return false;
+    if (f_rewinddir(&g_scan_dir) != FR_OK) return false;
+    g_new_count = 0;
+    g_changed = true;
+    return true;
+}
+
+static bool scan_entry(const FILINFO *fno)
+{
+    library_rec_t r;
+    UINT bw;
+
+    memset(&r, 0, sizeof(r));
+    make_key(fno->fname, r.key);
+    r.name_len = (uint8_t)strlen(fno->fname);
+    r.size     = (uint32_t)fno->fsize;
+    r.fdate    = fno->fdate;
+    r.ftime    = fno->ftime;
+
+    // metadata ID3 incluida: un tag ya indexado no se vuelve a parsear
+    const library_track_t *old = find_indexed(fno);
+    bool ok;
+    if (old) {
+        r.sclust      = old->sclust;
+        r.duration_ms = old->duration_ms;
+        ok = write_name(&g_dst_str, fno->fname, r.name_len, &r.name_off) &&
+             write_meta(&g_dst_str, old->title, old->artist, old->album);
+    } else {
+        FIL f;
+        memset(&g_meta, 0, sizeof(g_meta));
+        if (Library_GetPathFor(g_dir, fno->fname, g_path, sizeof(g_path)) &&
+            f_open(&f, g_path, FA_READ) == FR_OK) {
+            r.sclust = f.obj.sclust;
+            (void)MP3Player_ProbeFile(&f, &r.duration_ms);
+            (void)ID3_Read(&f, &g_meta);
+            if (r.duration_ms == 0u) r.duration_ms = g_meta.length_ms;
+            f_close(&f);
+        }
+        ok = write_name(&g_dst_str, fno->fname, r.name_len, &r.name_off) &&
+             write_meta(&g_dst_str, g_meta.title, g_meta.artist, g_meta.album);
+    }
+    if (!ok) return false;
+
+    return (f_write(&g_dst, &r, LIBRARY_REC_SIZE, &bw) == FR_OK) && (bw == LIBRARY_REC_SIZE);
+}
+
+static bool step_scan(uint32_t max_entries)
+{
+    for (uint32_t i = 0; i < max_entries; i++) {
+        FRESULT fr = f_readdir(&g_scan_dir, &g_fno);
+        if (fr != FR_OK) return false;
+
+        if (g_fno.fname[0] == 0) {
+            if (g_changed) {
+                f_closedir(&g_scan_dir);
+                return start_runs();
+            }
+            if (g_new_count == g_count) {
+                // el índice estaba al día: no se escribió nada en la SD
+                f_closedir(&g_scan_dir);
+                g_phase = LIB_IDLE;
+                return true;
+            }
+            // se borraron tracks
+            if (!start_writing()) return false;
+            continue;
+        }
+
+        if (g_fno.fattrib & AM_DIR) continue;
+        if (!is_mp3_file(g_fno.fname)) continue;
+
+        if (!g_changed) {
+            if (!find_indexed(&g_fno)) {
+                if (!start_writing()) return false;
+                continue;
+            }
+        } else if (!scan_entry(&g_fno)) {
+            return false;
+        }
+        g_new_count++;
+    }
+    return true;
+}
+
+static bool step_runs(uint32_t max_runs)
+{
+    for (uint32_t k = 0; k < max_runs; k++) {
+        uint32_t n = g_new_count - g_pos;
+        uint32_t used = 0;
+        if (n > LIBRARY_RUN_RECORDS) n = LIBRARY_RUN_RECORDS;
+
+        // registros del run + sus nombres empaquetados en el arena
+        for (uint32_t i = 0; i < n; i++) {
+            if (!read_rec(&g_src_a, &g_run[i])) return false;
+            if (!read_name(&g_src_str, &g_run[i], (char *)&g_arena[used + 1u])) return false;
+            g_arena[used] = g_run[i].name_len;
+            g_run_name[i] = (uint16_t)used;
+            g_order[i] = (uint8_t)i;
+            used += 1u + g_run[i].name_len;
+        }
+
+        // insertion sort sobre los índices: runs chicos, en RAM
+        for (uint32_t i = 1; i < n; i++) {
+            uint8_t o = g_order[i];
+            uint32_t j = i;
+            while (j > 0u) {
+                uint8_t p = g_order[j - 1u];
+                if (rec_cmp(&g_run[p], (const char *)&g_arena[g_run_name[p] + 1u],
+                            &g_run[o], (const char *)&g_arena[g_run_name[o] + 1u]) <= 0) break;
+                g_order[j] = p;
+                j--;
+            }
+            g_order[j] = o;
+        }
+
+        for (uint32_t i = 0; i < n; i++) {
+            uint8_t o = g_order[i];
+            if (!emit(&g_run[o], (const char *)&g_arena[g_run_name[o] + 1u])) return false;
+        }
+
+        g_pos += n;
+        if (g_pos >= g_new_count) return end_pass();
+    }
+    return true;
+}
+
+static bool step_merge(uint32_t max_records)
+{
+    for (uint32_t k = 0; k < max_records; k++) {
+        if (g_a == g_a_end && g_b == g_b_end) {
+            g_pos += 2u * g_run_len;
+            if (g_pos >= g_new_count) return end_pass();
+            if (!load_pair()) return false;
+        }
+
+        bool take_a = (g_b == g_b_end) ||
+                      ((g_a < g_a_end) && (rec_cmp(&g_head_a, g_name_a, &g_head_b, g_name_b) <= 0));
+
+        if (take_a) {
+            if (!emit(&g_head_a, g_name_a)) return false;
+            g_a++;
+            if (g_a < g_a_end && !load_head(&g_src_a, &g_head_a, g_name_a)) return false;
+        } else {
+            if (!emit(&g_head_b, g_name_b)) return false;
+            g_b++;
+            if (g_b < g_b_end && !load_head(&g_src_b, &g_head_b, g_name_b)) return false;
+        }
+    }
+    return true;
+}
+
+/*******************************************************************************
+ * API
+ ******************************************************************************/
+
+bool Library_GetPathFor(const char *dir, const char *name, char *path, uint32_t len)
+{
+    size_t dl = strlen(dir);
+    size_t nl = strlen(name);
+    bool slash = (dl > 0u) && (dir[dl - 1u] == '/');
+
+    if (dl + nl + (slash ? 0u : 1u) + 1u > len) return false;
+
+    memcpy(path, dir, dl);
+    if (!slash) path[dl++] = '/';
+    memcpy(&path[dl], name, nl + 1u);
+    return true;
+}
+
+bool Library_Init(const char *dir)
+{
+    strncpy(g_dir, dir, LIBRARY_DIR_LEN - 1u);
+    g_dir[LIBRARY_DIR_LEN - 1u] = '\0';
+
+    g_phase = LIB_IDLE;
+    dir_stamp(g_dir, &g_dir_fdate, &g_dir_ftime);
+    bool valid = index_open();
+    (void)Library_Seek(0);
+
+    // arranca el rescan; sin índice válido se escriben los temporales desde la primera entrada
+    if (f_opendir(&g_scan_dir, g_dir) == FR_OK) {
+        g_new_count = 0;
+        g_changed = false;
+        g_phase = LIB_SCAN;
+        if (!valid && !start_writing()) rebuild_abort();
+    }
+
+    return valid;
+}
+
+bool Library_ScanStep(uint32_t max_entries)
+{
+    library_phase_t phase = g_phase;
+    bool ok;
+
+    switch (phase) {
+        case LIB_SCAN:  ok = step_scan(max_entries); break;
+        case LIB_RUNS:  ok = step_runs(max_entries); break;
+        case LIB_MERGE: ok = step_merge(max_entries * LIBRARY_RUN_RECORDS); break;
+        default:        return false;
+    }
+
+    if (!ok) {
+        rebuild_abort();
+        return false;
+    }
+    return (g_phase == LIB_IDLE);
+}
+
+bool Library_IsScanning(void)
+{
+    return (g_phase != LIB_IDLE);
+}
+
+uint32_t Library_Count(void)
+{
+    return g_count;
+}
+
+const library_track_t *Library_Get(uint32_t idx)
+{
+    if (idx == g_view_idx) return &g_view;
+
+    const library_rec_t *r = get_rec(idx);
+    if (!r) return NULL;
+
+    g_view_idx = LIBRARY_INVALID;
+    if (!read_name(&g_str, r, g_view.name)) return NULL;
+    if (!read_meta(&g_str, &g_view)) return NULL;
+    g_view.size        = r->size;
+    g_view.sclust      = r->sclust;
+    g_view.duration_ms = r->duration_ms;
+    g_view.fdate       = r->fdate;
+    g_view.ftime       = r->ftime;
+    g_view_idx = idx;
+    return &g_view;
+}
+
+uint32_t Library_FindPrefix(const char *prefix)
+{
+    char key[LIBRARY_KEY_LEN];
+    uint32_t lo = 0, hi = g_count;
+    uint32_t span = g_hdr.fence_stride * LIBRARY_RECS_PER_SECTOR;
+
+    if (g_count == 0u) return 0;
+    make_key(prefix, key);
+
+    // 1) fences en RAM: primera con key >= prefix y primera con key > prefix
+    uint32_t f_lo = 0, f_hi = g_hdr.fence_count;
+    while (f_lo < f_hi) {
+        uint32_t mid = (f_lo + f_hi) / 2u;
+        if (memcmp(g_hdr.fence[mid], key, LIBRARY_KEY_LEN) < 0) f_lo = mid + 1u;
+        else f_hi = mid;
+    }
+    if (f_lo > 0u) lo = (f_lo - 1u) * span;
+
+    f_hi = g_hdr.fence_count;
+    while (f_lo < f_hi) {
+        uint32_t mid = (f_lo + f_hi) / 2u;
+        if (memcmp(g_hdr.fence[mid], key, LIBRARY_KEY_LEN) <= 0) f_lo = mid + 1u;
+        else f_hi = mid;
+    }
+    if (f_lo < g_hdr.fence_count && f_lo * span < hi) hi = f_lo * span;
+
+    // 2) búsqueda binaria en la SD dentro del tramo; el nombre se lee solo si empatan los keys
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2u;
+        const library_rec_t *r = get_rec(mid);
+        if (!r) return g_count;
+
+        int d = memcmp(r->key, key, LIBRARY_KEY_LEN);
+        if (d == 0 && key[LIBRARY_KEY_LEN - 1u] != '\0') {
+            const library_track_t *t = Library_Get(mid);
+            if (!t) return g_count;
+            d = name_cmp(t->name, prefix);
+        }
+        if (d < 0) lo = mid + 1u;
+        else hi = mid;
+    }
+    return lo;
+}
+
+uint32_t Library_NextLetter(uint32_t idx)
+{
+    const library_rec_t *r = get_rec(idx);
+    if (!r) return g_count;
+
+    uint8_t c = (uint8_t)r->key[0];
+    if (c == 0xFFu) return g_count;
+
+    char prefix[2];
+    prefix[0] = (char)(c + 1u);
+    prefix[1] = '\0';
+    return Library_FindPrefix(prefix);
+}
+
+bool Library_Seek(uint32_t idx)
+{
+    const library_track_t *t = Library_Get(idx);
+
+    g_cursor_valid = false;
+    if (!t) return false;
+
+    g_cursor = *t;
+    g_cursor_idx = idx;
+    g_cursor_valid = true;
+    return true;
+}
+
+uint32_t Library_CursorIndex(void)
+{
+    return g_cursor_idx;
+}
+
+const library_track_t *Library_Current(void)
+{
+    return g_cursor_valid ? &g_cursor : NULL;
+}
+
+bool Library_GetPath(uint32_t idx, char *path, uint32_t len)
+{
+    const library_track_t *t = Library_Get(idx);
+    if (!t) return false;
+    return Library_GetPathFor(g_dir, t->name, path, len);
+}
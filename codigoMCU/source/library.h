@@ -0,0 +1,141 @@
+/**
+ * @file     library.h
+ * @brief    Track library with a persistent, sorted on-card index.
+ *
+ * The whole library lives on the card in two files. The index
+ * (::LIBRARY_INDEX_PATH) has one header sector followed by fixed-size track
+ * records sorted by name, ::LIBRARY_RECS_PER_SECTOR per sector. Names are
+ * kept apart in a packed arena of length-prefixed strings
+ * (::LIBRARY_STRINGS_PATH), written in sorted order, so long file names cost
+ * only their actual length. The ID3 title, artist and album follow each name
+ * in the same arena; a tag is parsed once, when its file is first indexed.
+ * Boot only reads the header sector, which carries the record count, the
+ * modification stamp of the scanned directory and a sparse fence table (the
+ * name prefix of the first record of every ::LIBRARY_FENCE_MAX-th slice of
+ * sectors).
+ *
+ * RAM use is constant regardless of the number of tracks: one cached sector
+ * of records (the page around the last lookup), the fence table, the last
+ * track read and a copy of the track under the menu cursor. Jumping to a
+ * name prefix is a binary search over the fence table in RAM followed by a
+ * binary search on the card, so it costs O(log n) sector reads.
+ *
+ * The scanner is incremental: ::Library_ScanStep() walks a handful of
+ * directory entries per call and checks them against the index, so an
+ * unchanged card is never written. At the first difference it creates the
+ * temporary files and walks the directory again, appending records and
+ * names to them. When that pass finishes the records are
+ * sorted with an external merge sort (runs of ::LIBRARY_RUN_RECORDS
+ * records, then pairwise merge passes), also a bounded amount of work per
+ * call, and the result atomically replaces the index.
+ *
+ * @note FatFs is re-entrant, but the library state is not: calls other than
+ *       ::Library_Current() and ::Library_Count() must be serialized by the
+ *       caller (App.c holds LibMutex around them, together with browser.h).
+ *
+ * @author   Grupo 3
+ */
+
+#ifndef LIBRARY_H_
+#define LIBRARY_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "drivers/FAT/ff.h"
+#include "id3.h"
+
+#if FF_USE_LFN
+#define LIBRARY_NAME_LEN        (FF_LFN_BUF + 1u)   // long file name incl. '\0'
+#else
+#define LIBRARY_NAME_LEN        (FF_SFN_BUF + 1u)
+#endif
+#define LIBRARY_DIR_LEN         64u
+#define LIBRARY_PATH_LEN        (LIBRARY_DIR_LEN + LIBRARY_NAME_LEN)
+#define LIBRARY_REC_SIZE        32u
+#define LIBRARY_RECS_PER_SECTOR (512u / LIBRARY_REC_SIZE)
+#define LIBRARY_FENCE_MAX       64u
+#define LIBRARY_KEY_LEN         7u          // fence/record key = first chars of the name, lower case
+#define LIBRARY_RUN_RECORDS     8u          // records sorted in RAM per initial run
+#define LIBRARY_INDEX_PATH      "0:/LIBRARY.IDX"
+#define LIBRARY_STRINGS_PATH    "0:/LIBRARY.STR"
+
+/**
+ * @brief Track as returned by the API. On the card the name lives in the
+ *        string file and the record only keeps its offset, length and key.
+ */
+typedef struct {
+    char     name[LIBRARY_NAME_LEN];        // file name (long name if present), without directory
+    uint32_t size;                          // bytes
+    uint32_t sclust;                        // first cluster of the file
+    uint32_t duration_ms;                   // estimated from the first frame / Xing header
+    uint16_t fdate;                         // FAT modification stamp of the file
+    uint16_t ftime;
+    char     title[ID3_TEXT_LEN];           // ID3 tag, "" if absent
+    char     artist[ID3_TEXT_LEN];
+    char     album[ID3_TEXT_LEN];
+} library_track_t;
+
+/**
+ * @brief Opens the index for @p dir ("0:/") and starts a background rescan.
+ *
+ * The volume must already be mounted.
+ * @return true if a valid index was found, false if the library is empty
+ *         until the first rescan completes.
+ */
+bool Library_Init(const char *dir);
+
+/**
+ * @brief Advances the background rescan / sort by a bounded amount of work.
+ * @param max_entries Directory entries (or ::LIBRARY_RUN_RECORDS-sized sort
+ *                    chunks) to process.
+ * @return true when the index has just been replaced or confirmed up to date.
+ */
+bool Library_ScanStep(uint32_t max_entries);
+
+/**
+ * @brief True while a rescan or sort is in progress.
+ */
+bool Library_IsScanning(void);
+
+uint32_t Library_Count(void);
+
+/**
+ * @brief Reads record @p idx through the page cache.
+ * @return Pointer valid until the next library call, NULL if out of range.
+ */
+const library_track_t *Library_Get(uint32_t idx);
+
+/**
+ * @brief Index of the first track whose name is >= @p prefix (case insensitive).
+ * @return Library_Count() if every name sorts before @p prefix.
+ */
+uint32_t Library_FindPrefix(const char *prefix);
+
+/**
+ * @brief Index of the first track starting with a letter after the one at @p idx.
+ * @return Library_Count() past the last letter (the caller decides where to wrap).
+ */
+uint32_t Library_NextLetter(uint32_t idx);
+
+/**
+ * @brief Moves the menu cursor to @p idx and keeps a RAM copy of that record.
+ */
+bool Library_Seek(uint32_t idx);
+
+/**
+ * @brief Cursor position. Follows the same track when a new index is published.
+ */
+uint32_t Library_CursorIndex(void);
+
+/**
+ * @brief Record under the cursor (RAM copy, safe from any task). NULL if empty.
+ */
+const library_track_t *Library_Current(void);
+
+/**
+ * @brief Builds "dir/name" for track @p idx into @p path.
+ */
+bool Library_GetPath(uint32_t idx, char *path, uint32_t len);
+bool Library_GetPathFor(const char *dir, const char *name, char *path, uint32_t len);
+
+#endif /* LIBRARY_H_ */
@@ -7,12 +7,22 @@
 
 #include "mp3_player.h"
 #include "helix/pub/mp3dec.h"
+#include "drivers/FAT/ffcontig.h"
+#include "Resampler.h"
 #include <stdint.h>
 #include <stdbool.h>
 #include <stddef.h>
-#include "MK64F12.h"
-#include "drivers/gpio.h"
 #include <string.h>
+#include <ctype.h>
+#include <math.h>
+
+#ifndef HOST_BUILD
+#include "MK64F12.h"
+#include "Audio.h"
+#endif
+// en el build de host (diskio_image) TRACE_* y CRIT_* quedan vacíos
+#include "Trace.h"
+#include "CritSect.h"
 
 
 // Ajustes
@@ -27,24 +37,179 @@
 #define DAC_MID (DAC_MAX/2u)
 #endif
 
-static FIL *g_fp = NULL;
-static HMP3Decoder g_hmp3 = NULL;
-static MP3FrameInfo g_fi;
+#ifndef HOST_BUILD
+#define MP3_OUT_FS_HZ       AUDIO_FS_HZ
+#define MP3_CYCLES()        (DWT->CYCCNT)
+#define MP3_CPU_HZ          SystemCoreClock
+// SIMD del M4: dos productos 16x16 sumados en una instrucción
+#define MIX_PACK(lo, hi)    __PKHBT((lo), (hi), 16)
+#define MIX_DOT(x, y)       ((int32_t)__SMUAD((x), (y)))
+#define MIX_PACK_HI(lo, hi) __PKHTB((hi), (lo), 16)  // las mitades altas: (lo >> 16) | (hi & 0xFFFF0000)
+#define MIX_SAT16(v)        __SSAT((v), 16)
+#else
+#define MP3_OUT_FS_HZ       22050u
+#define MP3_CYCLES()        0u
+#define MP3_CPU_HZ          0u              // sin medición de carga
+#define MIX_PACK(lo, hi)    (((uint32_t)(lo) & 0xFFFFu) | ((uint32_t)(hi) << 16))
+#define MIX_DOT(x, y)       ((int32_t)(int16_t)(x) * (int16_t)(y) + \
+                             (int32_t)(int16_t)((x) >> 16) * (int16_t)((y) >> 16))
+#define MIX_PACK_HI(lo, hi) (((uint32_t)(lo) >> 16) | ((uint32_t)(hi) & 0xFFFF0000u))
+#define MIX_SAT16(v)        ((v) > 32767 ? 32767 : ((v) < -32768 ? -32768 : (v)))
+#endif
+
+// Frame del ring: L | R << 16
+#define PCM_FRAME(l, r)     MIX_PACK((l), (r))
 
-static uint8_t  g_inbuf[MP3_INBUF_SZ];          // lo que traigo de la sd
-static int      g_bytes_left = 0;
-static uint8_t *g_read_ptr   = g_inbuf;
+// Gapless: samples (por canal) a descartar al principio y a emitir en total,
+// sacados del header LAME/Info. Sin header: sin recorte.
+#define MP3_DECODER_DELAY   529u                // retardo del filtro híbrido + polifase
+#define MP3_LEN_UNKNOWN     UINT32_MAX
+#define MP3_SKIP_FRAMES_MAX 4                   // frames enteros descartados por llamada
+#define MP3_PCM_MAX         (1152 * 2)          // un frame MPEG1 estéreo
 
-static int16_t g_pcm[1152*8];
-static int     g_pcm_total = 0;
-static int     g_pcm_idx   = 0;
+// Crossfade: ganancias equal-power (sin/cos) de una tabla Q15 de cuarto de onda
+#define MP3_XFADE_LUT_BITS  8u
+#define MP3_XFADE_LUT_LEN   (1u << MP3_XFADE_LUT_BITS)
+#define MP3_MIX_BLOCK       256u                // samples mezclados por push al ring
+
+#if (MP3_MIX_BLOCK > SRC_BLOCK_MAX)
+#error "MP3_MIX_BLOCK must fit one Resampler_Process() call"
+#endif
+#define MP3_PREROLL_MS      1500u               // la siguiente se abre antes de que haga falta
+
+// Cache de arranque: el principio de los tracks alrededor del cursor ya decodificado.
+// Al retomar, el decoder arranca MP3_WARMUP_FRAMES antes del final del cache y
+// descarta lo que producen: llena el bit reservoir y el overlap del IMDCT.
+#define MP3_CACHE_SAMPLES   ((MP3_CACHE_FS_MAX * MP3_CACHE_MS) / 1000u)
+#define MP3_WARMUP_FRAMES   4u
+#define MP3_CACHE_MAX_FAILS 16u                 // frames que no decodifican antes de abandonar
+
+typedef struct {
+    uint32_t skip;
+    uint32_t left;
+    uint32_t samprate;      // del primer frame (0: no se pudo leer)
+} mp3_trim_t;
+
+// Estado antes de un frame: desde ahí se puede volver a decodificar
+typedef struct {
+    FSIZE_t    off;
+    mp3_trim_t trim;
+    uint32_t   kept;
+} mp3_mark_t;
+
+// Un decoder con su archivo; hay dos para poder mezclar el final de un
+// track con el principio del siguiente
+typedef struct {
+    uint8_t      inbuf[MP3_INBUF_SZ] __attribute__((aligned(4)));  // lo que traigo de la sd
+    int16_t      pcm[MP3_PCM_MAX];
+    FIL         *fp;
+    ffcontig_t   rd;                            // lecturas de fp (directas si es contiguo)
+    mp3_trim_t   trim;
+    bool         end;                           // fp ya no da más audio
+    HMP3Decoder  hmp3;
+    MP3FrameInfo fi;
+    uint8_t     *read_ptr;
+    int          bytes_left;
+    int          pcm_total;
+    int          pcm_idx;
+    FSIZE_t      frame_off;                     // en el archivo, del último frame decodificado
+    uint32_t     kept;                          // samples que pasaron el recorte desde mp3_begin
+    uint32_t     nfr;
+    mp3_mark_t   hist[MP3_WARMUP_FRAMES];       // los últimos frames decodificados
+} mp3_stream_t;
+
+typedef struct {
+    uint32_t     key;                           // 0: libre
+    uint32_t     stamp;                         // para reemplazar el menos usado
+    uint32_t     n;
+    mp3_mark_t   resume;
+    MP3FrameInfo fi;
+    uint32_t     pcm[MP3_CACHE_SAMPLES];        // frames, como en el ring
+} mp3_cache_t;
+
+static mp3_stream_t g_strm[2];
+static mp3_stream_t *g_cur = &g_strm[0];        // el que suena (en un fundido: el que sale)
+static mp3_stream_t *g_in  = &g_strm[1];        // el que entra en un fundido
+
+static FIL *g_next_fp = NULL;                   // en cola: ya abierto, con el header leído
+static mp3_trim_t g_next_trim;
+static FIL *g_finished = NULL;                  // terminó por un cambio de track: lo cierra App
+                                                // (hasta que lo retire no se empieza otro cambio)
+static bool g_done = false;                     // terminó la última pista y no hay cola
+
+static uint32_t g_xfade_ms = 0;                 // 0: gapless
+static bool     g_fading = false;
+static uint32_t g_fade_pos = 0;
+static uint32_t g_fade_total = 0;
+static uint32_t g_fade_step = 0;                // avance de fase por sample (LUT_LEN en Q16)
+static int16_t  g_xfade_lut[MP3_XFADE_LUT_LEN + 2u];     // +1: la interpolación en pi/2 lee uno más
+
+// Carga de CPU: ciclos de MP3Decode + mezcla sobre lo que duran esos samples
+static uint32_t g_work_cyc = 0;
+static uint32_t g_win_cyc[2];                   // [0]: un decoder, [1]: fundido
+static uint32_t g_win_smp[2];
+static mp3_mix_stats_t g_mix_stats;
+static mp3_decode_stats_t g_dec_stats;
+
+// Cada track sale a su frecuencia (Audio reprograma el PIT): el ring lleva
+// marcas de dónde cambia. Las escribe este task y las consume Audio_Service.
+#define RING_RATE_MARKS     4u
+
+typedef struct {
+    uint32_t pos;           // g_pcm_wr del primer sample a esa frecuencia
+    uint32_t fs;
+} ring_rate_t;
+
+static ring_rate_t g_rate_mark[RING_RATE_MARKS];
+static volatile uint32_t g_rate_wr = 0, g_rate_rd = 0;
+static uint32_t g_ring_fs = 0;                  // la de lo último escrito
+static uint32_t g_out_fs  = MP3_OUT_FS_HZ;      // la de lo que está saliendo
+
+// Salida a frecuencia fija (MP3Player_SetOutputRate): lo que no viene a esa
+// frecuencia pasa por el resampler antes del ring. 0: cada track a la suya.
+static uint32_t g_fixed_fs = 0;
+static uint32_t g_src_in = 0;                   // con la que arrancó el resampler (0: ninguna)
+static bool     g_src_on = false;               // false: esa frecuencia sale sin convertir
+static uint32_t g_stage[MP3_MIX_BLOCK];         // un bloque de frames antes de convertir
+static uint32_t g_src_out[MP3_MIX_BLOCK];
+
+// En la SRAM_L (64 KB), que el linker deja vacía: .data/.bss van a la SRAM_U
+#ifndef HOST_BUILD
+__attribute__((section(".bss.$SRAM_LOWER")))
+#endif
+static mp3_cache_t g_cache[MP3_CACHE_SLOTS];
+static uint32_t    g_cache_clock = 0;
 
 volatile uint32_t g_mp3_decode_errs = 0;
 volatile uint32_t g_mp3_frames_ok   = 0;
 
-static uint32_t pcm_ring_push_left_block(const int16_t *pcm, uint32_t interleaved_samps, uint32_t *io_idx);
 static inline void pcm_ring_snapshot(uint32_t *rd, uint32_t *wr);
 
+// Header MPEG Layer III (solo lo necesario para estimar duración)
+typedef struct {
+    uint32_t bitrate_kbps;
+    uint32_t samprate;
+    uint32_t samples_per_frame;
+    uint32_t side_info_len;
+    uint32_t frame_len;
+} mp3_hdr_t;
+
+// Lo que se saca del primer frame: Xing/Info (+ extensión LAME)
+typedef struct {
+    mp3_hdr_t hdr;
+    uint32_t  offset;       // del primer header, desde el fin del ID3v2
+    bool      is_info;      // el primer frame es Xing/Info (no tiene audio)
+    uint32_t  frames;       // 0: desconocido
+    uint32_t  delay;        // encoder delay / padding (LAME), en samples por canal
+    uint32_t  padding;
+} mp3_info_t;
+
+static uint8_t g_hdrbuf[512] __attribute__((aligned(4)));
+
+static const uint16_t k_l3_bitrate_v1[15] = {0,32,40,48,56,64,80,96,112,128,160,192,224,256,320};
+static const uint16_t k_l3_bitrate_v2[15] = {0,8,16,24,32,40,48,56,64,80,96,112,128,144,160};
+static const uint16_t k_samprate_v1[3]    = {44100, 48000, 32000};
+
 static bool mp3_skip_id3v2(FIL *fp)
 {
     UINT br = 0;
@@ -64,17 +229,115 @@ static bool mp3_skip_id3v2(FIL *fp)
     return (f_lseek(fp, 0) == FR_OK);
 }
 
-static bool mp3_fill_inbuf(void)
+static bool mp3_parse_header(const uint8_t *h, mp3_hdr_t *out)
+{
+    if (h[0] != 0xFF || (h[1] & 0xE0) != 0xE0) return false;
+
+    uint32_t ver   = (h[1] >> 3) & 0x3u;    // 3: MPEG1, 2: MPEG2, 0: MPEG2.5
+    uint32_t layer = (h[1] >> 1) & 0x3u;    // 1: Layer III
+    uint32_t br_ix = (h[2] >> 4) & 0xFu;
+    uint32_t sr_ix = (h[2] >> 2) & 0x3u;
+    uint32_t mode  = (h[3] >> 6) & 0x3u;    // 3: mono
+
+    if (ver == 1u || layer != 1u || br_ix == 0u || br_ix == 15u || sr_ix == 3u) return false;
+
+    bool v1 = (ver == 3u);
+    out->bitrate_kbps      = v1 ? k_l3_bitrate_v1[br_ix] : k_l3_bitrate_v2[br_ix];
+    out->samprate          = k_samprate_v1[sr_ix] >> (v1 ? 0 : (ver == 2u ? 1 : 2));
+    out->samples_per_frame = v1 ? 1152u : 576u;
+    if (v1) out->side_info_len = (mode == 3u) ? 17u : 32u;
+    else    out->side_info_len = (mode == 3u) ? 9u  : 17u;
+    out->frame_len = (out->samples_per_frame / 8u) * out->bitrate_kbps * 1000u / out->samprate
+                   + ((h[2] >> 1) & 0x1u);
+    return true;
+}
+
+static inline uint32_t be32(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+/*
+ * Lee el primer frame desde la posición actual (después del ID3v2).
+ * Info/Xing: flags, [frames], [bytes], [TOC 100], [quality]; después la
+ * extensión LAME (o Lavc/Lavf, mismo formato) con delay y padding de 12 bits
+ * a partir del byte 21.
+ */
+static bool mp3_read_info(FIL *fp, mp3_info_t *info)
+{
+    UINT br = 0;
+    const uint8_t *b = g_hdrbuf;
+
+    memset(info, 0, sizeof(*info));
+    if (f_read(fp, g_hdrbuf, sizeof(g_hdrbuf), &br) != FR_OK || br < 4u) return false;
+
+    // primer header válido (puede haber padding después del tag)
+    uint32_t off = 0;
+    while (off + 4u <= br && !mp3_parse_header(&b[off], &info->hdr)) off++;
+    if (off + 4u > br) return false;
+    info->offset = off;
+
+    uint32_t x = off + 4u + info->hdr.side_info_len;
+    if (x + 8u > br || (memcmp(&b[x], "Xing", 4) != 0 && memcmp(&b[x], "Info", 4) != 0))
+        return true;
+    info->is_info = true;
+
+    uint32_t flags = be32(&b[x + 4u]);
+    uint32_t p = x + 8u;
+    if (flags & 0x1u) { if (p + 4u <= br) info->frames = be32(&b[p]); p += 4u; }
+    if (flags & 0x2u) p += 4u;
+    if (flags & 0x4u) p += 100u;
+    if (flags & 0x8u) p += 4u;
+
+    if (p + 24u <= br &&
+        (memcmp(&b[p], "LAME", 4) == 0 || memcmp(&b[p], "Lavc", 4) == 0 || memcmp(&b[p], "Lavf", 4) == 0)) {
+        info->delay   = ((uint32_t)b[p + 21u] << 4) | ((uint32_t)b[p + 22u] >> 4);
+        info->padding = (((uint32_t)b[p + 22u] & 0xFu) << 8) | (uint32_t)b[p + 23u];
+    }
+    return true;
+}
+
+// ID3v2 + Info: deja fp en el primer frame con audio y calcula el recorte
+static bool mp3_prepare(FIL *fp, mp3_trim_t *trim)
+{
+    mp3_info_t info;
+
+    trim->skip = 0;
+    trim->left = MP3_LEN_UNKNOWN;
+    trim->samprate = 0;
+
+    if (!mp3_skip_id3v2(fp)) return false;
+    FSIZE_t data_start = f_tell(fp);
+
+    bool have_hdr = mp3_read_info(fp, &info);
+    if (have_hdr) trim->samprate = info.hdr.samprate;
+    if (!have_hdr || !info.is_info)
+        return (f_lseek(fp, data_start) == FR_OK);
+
+    // El frame Info decodifica a silencio: se saltea entero
+    if (f_lseek(fp, data_start + info.offset + info.hdr.frame_len) != FR_OK) return false;
+
+    uint64_t total = (uint64_t)info.frames * info.hdr.samples_per_frame;
+    if (info.frames && total > (uint64_t)info.delay + info.padding) {
+        trim->skip = info.delay + MP3_DECODER_DELAY;
+        trim->left = (uint32_t)(total - info.delay - info.padding);
+    }
+    return true;
+}
+
+static bool mp3_fill_inbuf(mp3_stream_t *s)
 {
-    if (g_bytes_left >= MP3_MIN_FILL) return true;
-    if (g_read_ptr != g_inbuf && g_bytes_left > 0) {
-        memmove(g_inbuf, g_read_ptr, (size_t)g_bytes_left);
-        g_read_ptr = g_inbuf;
-    } else if (g_bytes_left == 0) {
-        g_read_ptr = g_inbuf;
+    if (s->bytes_left >= MP3_MIN_FILL) return true;
+
+    // lo pendiente se corre de forma que termine alineado a 4: la lectura
+    // nueva cae alineada y puede ir por DMA directo al buffer
+    uint8_t *base = &s->inbuf[(uint32_t)(-s->bytes_left) & 0x3u];
+    if (s->read_ptr != base && s->bytes_left > 0) {
+        memmove(base, s->read_ptr, (size_t)s->bytes_left);
     }
+    s->read_ptr = base;
 
-    uint32_t space = (uint32_t)MP3_INBUF_SZ - (uint32_t)g_bytes_left;
+    uint32_t space = (uint32_t)(&s->inbuf[MP3_INBUF_SZ] - base) - (uint32_t)s->bytes_left;
     if (space == 0) return true;
 
     // Leer chunk grande, preferentemente múltiplo de 512
@@ -85,49 +348,125 @@ static bool mp3_fill_inbuf(void)
     if (aligned >= 512u) to_read = aligned;
 
     UINT br = 0;
-    FRESULT fr = f_read(g_fp, &g_inbuf[g_bytes_left], (UINT)to_read, &br);
+    TRACE_BEGIN(TRACE_EV_SD_READ, to_read);
+    FRESULT fr = ffcontig_read(&s->rd, &s->read_ptr[s->bytes_left], (UINT)to_read, &br);
+    TRACE_END(TRACE_EV_SD_READ, br);
     if (fr != FR_OK) return false;
 
-    g_bytes_left += (int)br;
-    return (g_bytes_left > 0);
+    s->bytes_left += (int)br;
+    return (s->bytes_left > 0);
 }
 
 
-static bool mp3_decode_next_frame(void)
+static void mp3_decode_account(const MP3FrameInfo *fi, uint32_t cyc)
 {
-    if (!mp3_fill_inbuf()) return false;
-    if (g_bytes_left < 4) return false;
-    int off = MP3FindSyncWord(g_read_ptr, g_bytes_left);
+    if (MP3_CPU_HZ == 0u || fi->samprate <= 0 || fi->outputSamps <= 0) return;
+
+    uint32_t ch = fi->nChans ? (uint32_t)fi->nChans : 1u;
+    uint32_t budget = (uint32_t)(((uint64_t)((uint32_t)fi->outputSamps / ch) * MP3_CPU_HZ) /
+                                 (uint32_t)fi->samprate);
+    mp3_decode_stats_t *d = &g_dec_stats;
+
+    d->cyc_avg = d->frames ? (uint32_t)((int32_t)d->cyc_avg + (((int32_t)cyc - (int32_t)d->cyc_avg) >> 4)) : cyc;
+    d->frames++;
+    d->cyc_last = cyc;
+    if (cyc > d->cyc_max) d->cyc_max = cyc;
+    d->budget_cyc = budget;
+    if (cyc > budget) d->over_budget++;
+
+    uint32_t pct = (uint32_t)(((uint64_t)cyc * 100u) / budget);
+    if (pct > d->load_pct_max) d->load_pct_max = pct;
+}
+
+static bool mp3_decode_one(mp3_stream_t *s)
+{
+    if (!mp3_fill_inbuf(s)) {
+        if (ffcontig_eof(&s->rd)) s->end = true;
+        return false;
+    }
+    if (s->bytes_left < 4) {
+        if (ffcontig_eof(&s->rd)) s->end = true;
+        return false;
+    }
+    int off = MP3FindSyncWord(s->read_ptr, s->bytes_left);
     if (off < 0) {
-        // descartar y reintentar
-        if (g_bytes_left > 16) {
-            g_read_ptr += (g_bytes_left - 16);
-            g_bytes_left = 16;
+        // descartar y reintentar (al final del archivo: tag ID3v1 o basura)
+        if (s->bytes_left > 16) {
+            s->read_ptr += (s->bytes_left - 16);
+            s->bytes_left = 16;
         }
+        if (ffcontig_eof(&s->rd)) s->end = true;
         return false;
     }
 
-    g_read_ptr += off;
-    g_bytes_left -= off;
-
-    gpioWrite(PORTNUM2PIN(PC,11),HIGH);
-    int err = MP3Decode(g_hmp3, &g_read_ptr, &g_bytes_left, g_pcm, 0);
-    gpioWrite(PORTNUM2PIN(PC,11),LOW);
+    s->read_ptr += off;
+    s->bytes_left -= off;
+    s->frame_off = s->rd.pos - (FSIZE_t)s->bytes_left;
+
+    int in_before = s->bytes_left;
+    TRACE_BEGIN(TRACE_EV_DECODE, 0);
+    uint32_t t0 = MP3_CYCLES();
+    int err = MP3Decode(s->hmp3, &s->read_ptr, &s->bytes_left, s->pcm, 0);
+    uint32_t cyc = MP3_CYCLES() - t0;
+    g_work_cyc += cyc;
+    TRACE_END(TRACE_EV_DECODE, in_before - s->bytes_left);
+    // sin bit reservoir (al retomar desde el cache): el frame se consumió y sale en silencio
+    if (err == ERR_MP3_MAINDATA_UNDERFLOW) err = ERR_MP3_NONE;
     if (err != 0) {
         g_mp3_decode_errs++;
         // avanzar 1 byte para resync
-        if (g_bytes_left > 0) { g_read_ptr++; g_bytes_left--; }
+        if (s->bytes_left > 0) { s->read_ptr++; s->bytes_left--; }
+        else if (ffcontig_eof(&s->rd)) s->end = true;
         return false;
     }
 
-    MP3GetLastFrameInfo(g_hmp3, &g_fi);
+    MP3GetLastFrameInfo(s->hmp3, &s->fi);
+    g_mp3_frames_ok++;
+    mp3_decode_account(&s->fi, cyc);
+    return true;
+}
+
+static inline uint32_t strm_channels(const mp3_stream_t *s)
+{
+    return s->fi.nChans ? (uint32_t)s->fi.nChans : 1u;
+}
 
-    // outputSamps suele venir como total interleaved (stereo => 2304)
-    g_pcm_total = g_fi.outputSamps;
-    g_pcm_idx   = 0;
+// frame k del PCM pendiente, empaquetado para el ring (mono: el mismo sample en L y R)
+static inline uint32_t strm_frame(const mp3_stream_t *s, uint32_t ch, uint32_t k)
+{
+    const int16_t *p = &s->pcm[s->pcm_idx + (int)(k * ch)];
+    return PCM_FRAME(p[0], p[ch - 1u]);
+}
 
-    g_mp3_frames_ok++;
-    return (g_pcm_total > 0);
+static bool mp3_decode_next_frame(mp3_stream_t *s)
+{
+    for (int i = 0; i < MP3_SKIP_FRAMES_MAX; i++) {
+        mp3_mark_t mark = { 0, s->trim, s->kept };
+
+        if (s->end || !mp3_decode_one(s)) return false;
+        mark.off = s->frame_off;
+        s->hist[s->nfr++ % MP3_WARMUP_FRAMES] = mark;
+
+        // outputSamps suele venir como total interleaved (stereo => 2304)
+        uint32_t ch    = strm_channels(s);
+        uint32_t frame = (uint32_t)s->fi.outputSamps / ch;
+
+        // recorte gapless: encoder + decoder delay al principio, padding al final
+        uint32_t skip = (s->trim.skip < frame) ? s->trim.skip : frame;
+        uint32_t keep = frame - skip;
+        s->trim.skip -= skip;
+        if (s->trim.left != MP3_LEN_UNKNOWN) {
+            if (keep > s->trim.left) keep = s->trim.left;
+            s->trim.left -= keep;
+            if (s->trim.left == 0) s->end = true;
+        }
+        s->kept += keep;
+
+        s->pcm_idx   = (int)(skip * ch);
+        s->pcm_total = (int)((skip + keep) * ch);
+        if (keep > 0) return true;
+    }
+    return false;
 }
 
 static inline uint16_t pcm16_to_dac(int16_t s)
@@ -139,87 +478,574 @@ static inline uint16_t pcm16_to_dac(int16_t s)
     return (u >> 4);
 }
 
+
+// samples (por canal) del frame decodificado que todavía no pasaron al ring
+static inline uint32_t strm_pending(const mp3_stream_t *s)
+{
+    return (uint32_t)(s->pcm_total - s->pcm_idx) / strm_channels(s);
+}
+
+// hay PCM pendiente (decodifica un frame si hace falta); si no, ver s->end
+static bool strm_ready(mp3_stream_t *s)
+{
+    if (s->pcm_idx < s->pcm_total) return true;
+    return mp3_decode_next_frame(s);
+}
+
+// Samples que le quedan a la pista: exacto con header LAME, si no por bitrate
+static uint32_t strm_remaining(const mp3_stream_t *s)
+{
+    uint32_t pend = strm_pending(s);
+
+    if (s->end) return pend;
+    if (s->trim.left != MP3_LEN_UNKNOWN) return s->trim.left + pend;
+    if (s->fi.bitrate <= 0 || s->fi.samprate <= 0) return MP3_LEN_UNKNOWN;
+
+    uint64_t bytes = (uint64_t)(s->rd.size - s->rd.pos) + (uint32_t)s->bytes_left;
+    return pend + (uint32_t)((bytes * 8u * (uint32_t)s->fi.samprate) / (uint32_t)s->fi.bitrate);
+}
+
+static bool mp3_begin(mp3_stream_t *s, FIL *fp, const mp3_trim_t *trim)
+{
+    s->fp = fp;
+    s->trim = *trim;
+    s->end = false;
+    (void)ffcontig_open(&s->rd, fp);        // exFAT NoFatChain o cadena de un fragmento
+
+    if(s->hmp3)
+        MP3FreeDecoder(s->hmp3);
+    s->hmp3 = MP3InitDecoder();
+    if (!s->hmp3) return false;
+
+    memset(&s->fi, 0, sizeof(s->fi));
+    s->kept = 0;
+    s->nfr = 0;
+    s->read_ptr = s->inbuf;
+    s->bytes_left = 0;
+    s->pcm_total = 0;
+    s->pcm_idx = 0;
+    return true;
+}
+
+/*******************************************************************************
+ * Ring: un sample por canal izquierdo (o mono)
+ ******************************************************************************/
+
+static inline uint32_t strm_rate(const mp3_stream_t *s)
+{
+    return (s->fi.samprate > 0) ? (uint32_t)s->fi.samprate : s->trim.samprate;
+}
+
+// lo que se escriba desde ahora sale a @p fs
+static void ring_mark_rate(uint32_t fs)
+{
+    if (fs == 0u || fs == g_ring_fs) return;
+    if (g_rate_wr - g_rate_rd >= RING_RATE_MARKS) return;      // (no pasa: uno por track)
+
+    g_rate_mark[g_rate_wr % RING_RATE_MARKS] = (ring_rate_t){ g_pcm_wr, fs };
+    CRIT_ALLOC();
+    CRIT_ENTER(CRIT_RING_MARK);
+    g_rate_wr++;
+    CRIT_EXIT(CRIT_RING_MARK);
+    g_ring_fs = fs;
+}
+
+static void ring_commit(uint32_t wr)
+{
+    CRIT_ALLOC();
+    CRIT_ENTER(CRIT_RING_COMMIT);
+    g_pcm_wr = wr;
+    CRIT_EXIT(CRIT_RING_COMMIT);
+}
+
+// @p n frames a @p fs (n <= MP3_MIX_BLOCK); si hay salida fija se convierten.
+// El resampler solo baja la frecuencia: nunca escribe más de n.
+static void ring_write(const uint32_t *x, uint32_t n, uint32_t fs)
+{
+    if (g_fixed_fs != 0u && fs != 0u && fs != g_fixed_fs) {
+        // la historia del filtro sigue entre tracks a la misma frecuencia (gapless)
+        if (fs != g_src_in) {
+            g_src_on = Resampler_Start(fs);
+            g_src_in = fs;
+        }
+        if (g_src_on) {
+            n  = Resampler_Process(x, n, g_src_out);
+            x  = g_src_out;
+            fs = g_fixed_fs;
+        }
+    } else {
+        g_src_in = 0;
+    }
+
+    ring_mark_rate(fs);
+    uint32_t wr = g_pcm_wr;                 // g_pcm_wr solo lo escribe este task
+    for (uint32_t k = 0; k < n; k++) {
+        g_pcm_ring[wr++ & PCM_RING_MASK] = x[k];
+    }
+    ring_commit(wr);
+}
+
+static void ring_push_stream(mp3_stream_t *s, uint32_t n)
+{
+    uint32_t ch = strm_channels(s);
+    uint32_t fs = strm_rate(s);
+
+    uint32_t t0 = MP3_CYCLES();
+    while (n > 0u) {
+        uint32_t m = (n < MP3_MIX_BLOCK) ? n : MP3_MIX_BLOCK;
+
+        for (uint32_t k = 0; k < m; k++) g_stage[k] = strm_frame(s, ch, k);
+        ring_write(g_stage, m, fs);
+        s->pcm_idx += (int)(m * ch);
+        n -= m;
+    }
+    g_work_cyc += MP3_CYCLES() - t0;
+}
+
+// sin(pi/2 * phase) en Q15, phase en Q16 sobre MP3_XFADE_LUT_LEN
+static inline int32_t xfade_gain(uint32_t phase)
+{
+    uint32_t i = phase >> 16;
+    int32_t  f = (int32_t)((phase >> 1) & 0x7FFFu);
+    int32_t  g0 = g_xfade_lut[i];
+    return g0 + (((g_xfade_lut[i + 1u] - g0) * f) >> 15);
+}
+
+static void ring_push_mix(mp3_stream_t *out, mp3_stream_t *in, uint32_t n)
+{
+    uint32_t ch_o = strm_channels(out), ch_i = strm_channels(in);
+    uint32_t phase = g_fade_pos * g_fade_step;
+
+    uint32_t t0 = MP3_CYCLES();
+    for (uint32_t k = 0; k < n; k++) {      // n <= MP3_MIX_BLOCK (mp3_xfade_step)
+        // cos para el que sale, sin para el que entra: la potencia se mantiene
+        int32_t g_in  = xfade_gain(phase);
+        int32_t g_out = xfade_gain((MP3_XFADE_LUT_LEN << 16) - phase);
+        uint32_t fo = strm_frame(out, ch_o, k);
+        uint32_t fi = strm_frame(in, ch_i, k);
+        uint32_t g  = MIX_PACK(g_out, g_in);
+        int32_t  l  = MIX_SAT16(MIX_DOT(MIX_PACK(fo, fi), g) >> 15);       // L de los dos
+        int32_t  r  = MIX_SAT16(MIX_DOT(MIX_PACK_HI(fo, fi), g) >> 15);    // R de los dos
+        g_stage[k] = PCM_FRAME(l, r);
+        phase += g_fade_step;
+    }
+    ring_write(g_stage, n, strm_rate(out));  // mismas frecuencias: ver mp3_xfade_try_start
+    g_work_cyc += MP3_CYCLES() - t0;
+
+    out->pcm_idx += (int)(n * ch_o);
+    in->pcm_idx  += (int)(n * ch_i);
+    g_fade_pos   += n;
+    g_mix_stats.mixed_samples += n;
+}
+
+/*******************************************************************************
+ * Cambio de track: gapless o con fundido
+ ******************************************************************************/
+
+// el que entra pasa a ser el actual; el FIL del otro se le devuelve a App
+static void mp3_swap_streams(void)
+{
+    mp3_stream_t *t = g_cur;
+
+    g_finished = g_cur->fp;
+    g_cur->fp = NULL;
+    g_cur = g_in;
+    g_in = t;
+}
+
+static bool mp3_switch_to_next(void)
+{
+    if (!g_next_fp) return false;
+
+    FIL *fp = g_next_fp;
+    g_next_fp = NULL;
+    if (!mp3_begin(g_in, fp, &g_next_trim)) {
+        g_finished = fp;
+        return false;
+    }
+    mp3_swap_streams();
+    return true;
+}
+
+static void mp3_xfade_try_start(void)
+{
+    if (g_xfade_ms == 0 || !g_next_fp || g_finished) return;
+    // a distinta frecuencia no se pueden mezclar sin resamplear: cambio gapless
+    if (g_next_trim.samprate != strm_rate(g_cur)) return;
+
+    uint32_t rem = strm_remaining(g_cur);
+    if (rem == MP3_LEN_UNKNOWN || rem > (g_xfade_ms * strm_rate(g_cur)) / 1000u) return;
+
+    // si no hay memoria para el segundo decoder queda el cambio gapless
+    if (!mp3_begin(g_in, g_next_fp, &g_next_trim)) return;
+    g_next_fp = NULL;
+
+    // el fundido dura lo que le queda al que sale
+    g_fading = true;
+    g_fade_pos = 0;
+    g_fade_total = rem ? rem : 1u;
+    g_fade_step = (MP3_XFADE_LUT_LEN << 16) / g_fade_total;
+    g_mix_stats.fades++;
+}
+
+// Mezcla hasta @p room samples; 0 si falta PCM de alguno de los dos
+static uint32_t mp3_xfade_step(uint32_t room)
+{
+    if (!strm_ready(g_in)) {
+        if (!g_in->end) return 0;
+        // el que entra es más corto que el fundido: se sigue con el que sale
+        g_finished = g_in->fp;
+        g_in->fp = NULL;
+        g_fading = false;
+        return 0;
+    }
+    if (!strm_ready(g_cur)) {
+        if (!g_cur->end) return 0;
+        // la estimación por bitrate se pasó (VBR): el que entra queda solo
+        g_fading = false;
+        mp3_swap_streams();
+        return 0;
+    }
+
+    uint32_t n = room;
+    if (n > MP3_MIX_BLOCK) n = MP3_MIX_BLOCK;
+    if (n > strm_pending(g_cur)) n = strm_pending(g_cur);
+    if (n > strm_pending(g_in)) n = strm_pending(g_in);
+    if (n > g_fade_total - g_fade_pos) n = g_fade_total - g_fade_pos;
+
+    ring_push_mix(g_cur, g_in, n);
+
+    if (g_fade_pos >= g_fade_total) {
+        g_fading = false;
+        mp3_swap_streams();
+    }
+    return n;
+}
+
+static void mp3_load_account(bool mixing, uint32_t samples)
+{
+    uint32_t fs = strm_rate(g_cur) ? strm_rate(g_cur) : MP3_OUT_FS_HZ;
+    uint32_t cyc_per_smp = MP3_CPU_HZ / fs;
+    uint32_t w = mixing ? 1u : 0u;
+
+    g_win_cyc[w] += g_work_cyc;
+    g_win_smp[w] += samples;
+    g_work_cyc = 0;
+    if (g_win_smp[w] < fs / 4u || cyc_per_smp == 0u) return;      // ventanas de 250 ms
+
+    uint32_t pct = (uint32_t)(((uint64_t)g_win_cyc[w] * 100u) / ((uint64_t)g_win_smp[w] * cyc_per_smp));
+    if (mixing) {
+        g_mix_stats.mix_load_pct = pct;
+        if (pct > g_mix_stats.mix_load_pct_max) g_mix_stats.mix_load_pct_max = pct;
+    } else {
+        g_mix_stats.solo_load_pct = pct;
+        if (pct > g_mix_stats.solo_load_pct_max) g_mix_stats.solo_load_pct_max = pct;
+    }
+    g_win_cyc[w] = 0;
+    g_win_smp[w] = 0;
+}
+
 // API
 bool MP3Player_InitWithOpenFile(FIL *fp)
 {
+    mp3_trim_t trim;
+
     if (!fp) return false;
 
-    g_fp = fp;
+#ifndef HOST_BUILD
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;     // DWT->CYCCNT para la carga de CPU
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+
+    // una pista elegida a mano descarta la cola y el fundido (los FIL los cierra App)
+    g_next_fp = NULL;
+    g_finished = NULL;
+    g_done = false;
+    g_fading = false;
+    g_in->fp = NULL;
 
-    if (!mp3_skip_id3v2(g_fp)) return false;
-    if(g_hmp3)
-        MP3FreeDecoder(g_hmp3);
-    g_hmp3 = MP3InitDecoder();
-    if (!g_hmp3) return false;
+    if (!mp3_prepare(fp, &trim)) return false;
+    if (!mp3_begin(g_cur, fp, &trim)) return false;
+    (void)mp3_decode_next_frame(g_cur);
+
+    return true;
+}
 
-    g_read_ptr = g_inbuf;
-    g_bytes_left = 0;
-    g_pcm_total = 0;
-    g_pcm_idx = 0;
-    (void)mp3_decode_next_frame();
+bool MP3Player_QueueNext(FIL *fp)
+{
+    if (!fp || g_next_fp) return false;
+    if (!mp3_prepare(fp, &g_next_trim)) return false;
 
+    g_next_fp = fp;
+    g_done = false;
     return true;
 }
 
-static uint32_t pcm_ring_push_mono_block(const int16_t *pcm, uint32_t samps, uint32_t *io_idx)
+bool MP3Player_WantsNext(void)
+{
+    const mp3_stream_t *s = g_cur;
+
+    if (!s->fp || g_next_fp || g_fading) return false;
+    // la actual ya está entera en el inbuf: hay ~1 s (inbuf + ring) para abrir la siguiente
+    if (s->end || g_done || ffcontig_eof(&s->rd)) return true;
+    if (g_xfade_ms == 0) return false;
+
+    // con fundido hace falta antes: tiene que estar abierta cuando empieza
+    uint32_t rem = strm_remaining(s);
+    return rem != MP3_LEN_UNKNOWN &&
+           rem <= ((g_xfade_ms + MP3_PREROLL_MS) * strm_rate(s)) / 1000u;
+}
+
+FIL *MP3Player_TakeFinished(void)
+{
+    FIL *fp = g_finished;
+    g_finished = NULL;
+    return fp;
+}
+
+bool MP3Player_IsFinished(void)
+{
+    return g_done;
+}
+
+FIL *MP3Player_CurrentFile(void)
+{
+    return g_cur->fp;
+}
+
+void MP3Player_SetCrossfadeMs(uint32_t ms)
+{
+    if (ms > MP3_XFADE_MAX_MS) ms = MP3_XFADE_MAX_MS;
+
+    if (g_xfade_lut[MP3_XFADE_LUT_LEN] == 0) {
+        for (uint32_t i = 0; i <= MP3_XFADE_LUT_LEN; i++) {
+            float x = 1.5707963f * (float)i / (float)MP3_XFADE_LUT_LEN;
+            g_xfade_lut[i] = (int16_t)lrintf(32767.0f * sinf(x));
+        }
+        g_xfade_lut[MP3_XFADE_LUT_LEN + 1u] = g_xfade_lut[MP3_XFADE_LUT_LEN];
+    }
+    g_xfade_ms = ms;
+}
+
+void MP3Player_SetOutputRate(uint32_t fs_hz)
+{
+    // los bancos se calculan acá (float): antes de empezar a reproducir
+    if (fs_hz != 0u && !Resampler_Init(fs_hz)) fs_hz = 0;
+    g_fixed_fs = fs_hz;
+    g_src_in = 0;
+}
+
+void MP3Player_GetMixStats(mp3_mix_stats_t *st)
+{
+    if (!st) return;
+    *st = g_mix_stats;
+    uint32_t worst = (g_mix_stats.mix_load_pct_max > g_mix_stats.solo_load_pct_max) ?
+                     g_mix_stats.mix_load_pct_max : g_mix_stats.solo_load_pct_max;
+    st->headroom_pct = (worst < 100u) ? (100u - worst) : 0u;
+}
+
+void MP3Player_GetDecodeStats(mp3_decode_stats_t *st)
 {
-    uint32_t pushed = 0;
+    if (st) *st = g_dec_stats;
+}
 
-    while (*io_idx < samps) {
-        uint32_t free = pcm_ring_free();
-        if (free == 0) break;
+void MP3Player_ResetDecodeStats(void)
+{
+    memset(&g_dec_stats, 0, sizeof(g_dec_stats));
+}
 
-        uint32_t remaining = samps - *io_idx;
-        uint32_t n = free;
-        if (n > remaining) n = remaining;
+/*******************************************************************************
+ * Cache de arranque
+ ******************************************************************************/
 
+static mp3_cache_t *cache_find(uint32_t key)
+{
+    for (uint32_t i = 0; i < MP3_CACHE_SLOTS; i++) {
+        if (g_cache[i].key == key) {
+            g_cache[i].stamp = ++g_cache_clock;
+            return &g_cache[i];
+        }
+    }
+    return NULL;
+}
+
+// MP3_CACHE_MS a la frecuencia del track (hasta el primer frame no se sabe: el slot entero)
+static uint32_t cache_cap(const mp3_stream_t *s)
+{
+    uint32_t fs = strm_rate(s);
+    uint32_t n = fs ? (fs * MP3_CACHE_MS) / 1000u : MP3_CACHE_SAMPLES;
+    return (n < MP3_CACHE_SAMPLES) ? n : MP3_CACHE_SAMPLES;
+}
+
+static mp3_cache_t *cache_victim(void)
+{
+    mp3_cache_t *v = &g_cache[0];
+    for (uint32_t i = 1; i < MP3_CACHE_SLOTS; i++) {
+        if (g_cache[i].stamp < v->stamp) v = &g_cache[i];
+    }
+    return v;
+}
+
+uint32_t MP3Player_CacheKey(const char *path)
+{
+    // FNV-1a; 0 queda para "libre"
+    uint32_t h = 2166136261u;
+    while (*path) {
+        h ^= (uint8_t)*path++;
+        h *= 16777619u;
+    }
+    return h ? h : 1u;
+}
+
+bool MP3Player_CacheTouch(uint32_t key)
+{
+    return key != 0u && cache_find(key) != NULL;
+}
+
+bool MP3Player_Precache(FIL *fp, uint32_t key)
+{
+    mp3_stream_t *s = g_in;                 // libre fuera de un fundido
+    mp3_trim_t trim;
+    uint32_t fails = 0;
+
+    if (!fp || key == 0u || g_fading) return false;
+    if (cache_find(key)) return true;
+
+    mp3_cache_t *c = cache_victim();
+    c->key = 0;
+    c->n = 0;
+
+    bool ok = mp3_prepare(fp, &trim) && mp3_begin(s, fp, &trim);
+
+    // frames enteros mientras entren (el retome arranca en un borde de frame)
+    while (ok && cache_cap(s) >= c->n + MP3_PCM_MAX / 2u) {
+        if (!strm_ready(s)) {
+            if (s->end || ++fails > MP3_CACHE_MAX_FAILS) break;
+            continue;
+        }
+        uint32_t ch = strm_channels(s);
+        uint32_t n = strm_pending(s);
         for (uint32_t k = 0; k < n; k++) {
-            g_pcm_ring[g_pcm_wr & PCM_RING_MASK] = pcm[*io_idx];
-            (*io_idx)++;
-            g_pcm_wr++;
+            c->pcm[c->n + k] = strm_frame(s, ch, k);
         }
-        pushed += n;
+        s->pcm_idx = s->pcm_total;
+        c->n += n;
     }
-    return pushed;
+
+    if (ok && c->n > 0u) {
+        // el más viejo de los últimos frames: se vuelve a decodificar desde ahí
+        // y se descarta lo que ya está en el cache
+        mp3_mark_t m = s->hist[(s->nfr < MP3_WARMUP_FRAMES) ? 0u : (s->nfr % MP3_WARMUP_FRAMES)];
+        uint32_t done = s->kept - m.kept;
+
+        c->resume = m;
+        c->resume.trim.skip += done;
+        if (m.trim.left != MP3_LEN_UNKNOWN) c->resume.trim.left -= done;
+        c->resume.kept = s->kept;
+        c->fi = s->fi;
+        c->key = key;
+        c->stamp = ++g_cache_clock;
+    } else {
+        ok = false;
+    }
+
+    s->fp = NULL;
+    g_work_cyc = 0;                         // no cuenta como carga de reproducción
+    return ok;
+}
+
+bool MP3Player_StartFromCache(FIL *fp, uint32_t key)
+{
+    mp3_cache_t *c = (key != 0u) ? cache_find(key) : NULL;
+
+    if (!fp || !c) return false;
+
+    g_next_fp = NULL;
+    g_finished = NULL;
+    g_done = false;
+    g_fading = false;
+    g_in->fp = NULL;
+
+    if (f_lseek(fp, c->resume.off) != FR_OK) return false;
+    if (!mp3_begin(g_cur, fp, &c->resume.trim)) return false;
+    g_cur->fi = c->fi;                      // frecuencia y canales antes del primer frame
+
+    // el ring arranca con lo del cache; el decoder sigue desde resume
+    pcm_ring_clear();
+    uint32_t n = (c->n < PCM_RING_SIZE) ? c->n : PCM_RING_SIZE;
+    for (uint32_t k = 0; k < n; k += MP3_MIX_BLOCK) {
+        uint32_t m = (n - k < MP3_MIX_BLOCK) ? (n - k) : MP3_MIX_BLOCK;
+        ring_write(&c->pcm[k], m, (uint32_t)c->fi.samprate);
+    }
+    return true;
+}
+
+bool MP3Player_ProbeFile(FIL *fp, uint32_t *duration_ms)
+{
+    mp3_info_t info;
+
+    if (!fp || !duration_ms) return false;
+    *duration_ms = 0;
+
+    if (!mp3_skip_id3v2(fp)) return false;
+    FSIZE_t data_start = f_tell(fp);
+
+    if (!mp3_read_info(fp, &info)) return false;
+    const mp3_hdr_t *hdr = &info.hdr;
+
+    // Xing/Info: cantidad de frames exacta (VBR), sin el delay/padding del encoder
+    if (info.frames) {
+        uint64_t samples = (uint64_t)info.frames * hdr->samples_per_frame;
+        if (samples > (uint64_t)info.delay + info.padding) samples -= info.delay + info.padding;
+        *duration_ms = (uint32_t)((samples * 1000u) / hdr->samprate);
+        return true;
+    }
+
+    // CBR: bytes de audio / bitrate
+    FSIZE_t audio_bytes = f_size(fp) - data_start - info.offset;
+    *duration_ms = (uint32_t)(((uint64_t)audio_bytes * 8u) / hdr->bitrate_kbps);
+    return true;
 }
 
 bool MP3Player_DecodeAsMuchAsPossibleToRing(void)
 {
-    if (!g_fp || !g_hmp3) return false;
+    if (!g_cur->fp || !g_cur->hmp3) return false;
 
     bool progressed = false;
 
     for (uint8_t i=0; i<3; i++) {
 
         // 1) Si no hay lugar, cortar
-        if (pcm_ring_free() == 0) return progressed;
-
-        // 2) Si NO hay PCM pendiente, decodificar un frame nuevo
-        if (g_pcm_idx >= g_pcm_total) {
-            if (!mp3_decode_next_frame()) {
-                return progressed ? true : false;
-            }
+        uint32_t room = pcm_ring_free();
+        if (room == 0) break;
+
+        if (!g_fading) mp3_xfade_try_start();
+
+        // 2) Fundido: los dos decoders a la vez
+        if (g_fading) {
+            uint32_t n = mp3_xfade_step(room);
+            mp3_load_account(true, n);
+            if (n == 0) break;
+            progressed = true;
+            continue;
         }
 
-        // 3) push de PCM pendiente del frame actual
-        uint32_t before = (uint32_t)g_pcm_idx;
-
-        if (g_fi.nChans == 2) {
-            (void)pcm_ring_push_left_block(g_pcm,
-                                           (uint32_t)g_pcm_total,
-                                           (uint32_t*)&g_pcm_idx);
-        } else {
-            (void)pcm_ring_push_mono_block(g_pcm,
-                                           (uint32_t)g_pcm_total,
-                                           (uint32_t*)&g_pcm_idx);
+        // 3) Si NO hay PCM pendiente, decodificar un frame nuevo
+        if (!strm_ready(g_cur)) {
+            // fin de pista sin fundido: la siguiente sigue en el ring sin hueco, una vez que
+            // App cerró el FIL del cambio anterior (el fundido tampoco empieza sin eso)
+            if (g_cur->end && !g_finished && !mp3_switch_to_next()) g_done = true;
+            break;
         }
 
-        // 4) Progreso
-        if ((uint32_t)g_pcm_idx != before) progressed = true;
-
-        // ring lleno
-        if ((uint32_t)g_pcm_idx == before) return progressed;
+        // 4) push de PCM pendiente del frame actual
+        uint32_t n = strm_pending(g_cur);
+        if (n > room) n = room;
+        ring_push_stream(g_cur, n);
+        mp3_load_account(false, n);
+        progressed = true;
     }
+    return progressed;
 }
 
 
@@ -229,32 +1055,36 @@ void MP3Player_GetLastPCMwindow(int16_t *pcm, uint32_t max_samples)
 {
     if (!pcm || max_samples == 0) return;
 
-    uint32_t to_copy = (uint32_t)g_pcm_total;
+    // el FFT mira la suma de los dos canales
+    uint32_t ch = strm_channels(g_cur);
+    uint32_t to_copy = (uint32_t)g_cur->pcm_total / ch;
     if (to_copy > max_samples) {
         to_copy = max_samples;
     }
 
-    for (uint32_t i = 0; i < to_copy; i++) {
-        pcm[i] = g_pcm[i];
+    const int16_t *p = g_cur->pcm;
+    for (uint32_t i = 0; i < to_copy; i++, p += ch) {
+        pcm[i] = (int16_t)(((int32_t)p[0] + (int32_t)p[ch - 1u]) >> 1);
     }
 }
 
 uint32_t MP3Player_GetSampleRateHz(void)
 {
-    return (uint32_t)g_fi.samprate;
+    return (uint32_t)g_cur->fi.samprate;
 }
 
 uint32_t MP3Player_GetChannels(void)
 {
-    return (uint32_t)g_fi.nChans;
+    return (uint32_t)g_cur->fi.nChans;
 }
 
 static inline void pcm_ring_snapshot(uint32_t *rd, uint32_t *wr)
 {
-    __disable_irq();
+    CRIT_ALLOC();
+    CRIT_ENTER(CRIT_RING_SNAPSHOT);
     *rd = g_pcm_rd;
     *wr = g_pcm_wr;
-    __enable_irq();
+    CRIT_EXIT(CRIT_RING_SNAPSHOT);
 }
 
 uint32_t pcm_ring_level(void)
@@ -275,76 +1105,61 @@ void pcm_ring_clear(void)
 {
     g_pcm_wr = 0;
     g_pcm_rd = 0;
-    g_pcm_idx = 0;
-    g_pcm_total = 0;
+    g_rate_rd = g_rate_wr;
+    g_ring_fs = 0;
+    g_src_in = 0;                           // lo nuevo no sigue a lo anterior
+    g_cur->pcm_idx = 0;
+    g_cur->pcm_total = 0;
+}
+
+uint32_t pcm_ring_rate(uint32_t *span)
+{
+    uint32_t rd, wr;
+    CRIT_ALLOC();
+    pcm_ring_snapshot(&rd, &wr);
+
+    // las marcas que ya alcanzó g_pcm_rd pasan a ser la frecuencia actual
+    *span = UINT32_MAX;
+    while (g_rate_rd != g_rate_wr) {
+        const ring_rate_t *m = &g_rate_mark[g_rate_rd % RING_RATE_MARKS];
+        if ((int32_t)(m->pos - rd) > 0) {
+            *span = m->pos - rd;
+            break;
+        }
+        g_out_fs = m->fs;
+        CRIT_ENTER(CRIT_RING_RATE);
+        g_rate_rd++;
+        CRIT_EXIT(CRIT_RING_RATE);
+    }
+    return g_out_fs;
 }
 
 uint32_t pcm_ring_pop_block(volatile uint16_t *dst, uint32_t n)
 {
     uint32_t rd, wr;
+    CRIT_ALLOC();
 
-    __disable_irq();
+    CRIT_ENTER(CRIT_RING_POP);
     rd = g_pcm_rd;
     wr = g_pcm_wr;
-    __enable_irq();
+    CRIT_EXIT(CRIT_RING_POP);
 
     uint32_t avail = (wr - rd);           
     if (n > avail) n = avail;
 
     for (uint32_t i = 0; i < n; i++) {
-        int16_t s = g_pcm_ring[(rd + i) & PCM_RING_MASK];
-        dst[i] = pcm16_to_dac(s);
+        uint32_t f = g_pcm_ring[(rd + i) & PCM_RING_MASK];
+        dst[2u * i]      = pcm16_to_dac((int16_t)(f & 0xFFFFu));
+        dst[2u * i + 1u] = pcm16_to_dac((int16_t)(f >> 16));
     }
 
-    __disable_irq();
+    CRIT_ENTER(CRIT_RING_POP);
     g_pcm_rd = rd + n;
-    __enable_irq();
+    CRIT_EXIT(CRIT_RING_POP);
 
     return n;
 }
 
-static uint32_t pcm_ring_push_left_block(const int16_t *pcm,
-                                         uint32_t interleaved_samps,
-                                         uint32_t *io_idx)
-{
-    uint32_t pushed = 0;
-    uint32_t rd, wr;
-
-    while (*io_idx < interleaved_samps) {
-
-        __disable_irq();
-        rd = g_pcm_rd;
-        wr = g_pcm_wr;
-        __enable_irq();
-
-        uint32_t free = PCM_RING_SIZE - (wr - rd);
-        if (free == 0) break;
-
-        uint32_t remaining_inter = interleaved_samps - *io_idx;
-        uint32_t remaining_mono  = remaining_inter / 2;
-        if (remaining_mono == 0) break;
-
-        uint32_t n = (free < remaining_mono) ? free : remaining_mono;
-
-        // escribir usando un wr_local, sin tocar g_pcm_wr todavía
-        uint32_t wr_local = wr;
-        for (uint32_t k = 0; k < n; k++) {
-            int16_t L = pcm[*io_idx];
-            *io_idx += 2;
-            g_pcm_ring[wr_local & PCM_RING_MASK] = L;
-            wr_local++;
-        }
-
-        __disable_irq();
-        g_pcm_wr = wr_local;
-        __enable_irq();
-
-        pushed += n;
-    }
-
-    return pushed;
-}
-
 bool is_mp3_file(const char *name)
 {
     size_t len = strlen(name);
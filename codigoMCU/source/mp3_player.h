@@ -8,15 +8,76 @@
 #include <stdbool.h>
 #include "drivers/FAT/ff.h"
 
+// Un frame estéreo por posición: L en la mitad baja, R en la alta (mono: L = R).
+// La misma profundidad en tiempo que el ring mono (371 ms a 44.1 kHz, 341 ms a 48 kHz):
+// tiene que cubrir los reintentos y la bajada de clock de la SD. 64 KB.
 #define PCM_RING_SIZE 16384u
 #define PCM_RING_MASK (PCM_RING_SIZE - 1u)
 
-static int16_t g_pcm_ring[PCM_RING_SIZE];
+static uint32_t g_pcm_ring[PCM_RING_SIZE];
 static volatile uint32_t g_pcm_wr = 0;
 static volatile uint32_t g_pcm_rd = 0;
 
 
 bool MP3Player_InitWithOpenFile(FIL *fp);
+
+// Gapless: la pista siguiente se abre y se encola mientras suena el final de
+// la actual. Al terminar la actual (recortada según el header LAME) el
+// decoder sigue con la encolada sobre el mismo ring, sin hueco.
+bool MP3Player_QueueNext(FIL *fp);          // fp abierto; falla si ya hay una en cola
+bool MP3Player_WantsNext(void);             // la actual ya se leyó entera y no hay cola
+FIL *MP3Player_TakeFinished(void);          // pista que terminó en un cambio gapless (para f_close)
+bool MP3Player_IsFinished(void);            // terminó la última pista y no había cola
+FIL *MP3Player_CurrentFile(void);
+// Crossfade: con ms > 0 el final de cada pista se mezcla con el principio de
+// la encolada (dos decoders a la vez, ganancias equal-power). 0: gapless.
+#define MP3_XFADE_MAX_MS    10000u
+
+typedef struct {
+    uint32_t fades;                 // fundidos empezados
+    uint32_t mixed_samples;         // samples que salieron de la mezcla
+    uint32_t solo_load_pct;         // CPU de decode (+ mezcla) sobre el tiempo de audio que genera,
+    uint32_t solo_load_pct_max;     // medido en ventanas de 250 ms: un decoder...
+    uint32_t mix_load_pct;
+    uint32_t mix_load_pct_max;      // ...y dos decoders + mezcla (el peor caso)
+    uint32_t headroom_pct;          // 100 - el peor máximo
+} mp3_mix_stats_t;
+
+void MP3Player_SetCrossfadeMs(uint32_t ms);
+
+// 0 (default): cada track sale a su frecuencia y Audio reprograma el PIT.
+// Otra: los tracks a 48 / 44.1 / 32 kHz se convierten a fs_hz (Resampler.h);
+// los que ya vienen a fs_hz, o a una sin banco, salen como están.
+void MP3Player_SetOutputRate(uint32_t fs_hz);
+
+void MP3Player_GetMixStats(mp3_mix_stats_t *st);
+
+// Tiempo de MP3Decode() por frame contra lo que dura ese frame (DWT; 0 en el host)
+typedef struct {
+    uint32_t frames;                // frames medidos (también los del cache de arranque)
+    uint32_t cyc_last;
+    uint32_t cyc_avg;               // media móvil de 16 frames
+    uint32_t cyc_max;
+    uint32_t budget_cyc;            // lo que dura el último frame a su frecuencia
+    uint32_t load_pct_max;          // el peor frame, sobre su propia duración
+    uint32_t over_budget;           // frames que tardaron más de lo que suenan
+} mp3_decode_stats_t;
+
+void MP3Player_GetDecodeStats(mp3_decode_stats_t *st);
+void MP3Player_ResetDecodeStats(void);
+
+// Cache de arranque: el principio (MP3_CACHE_MS) del track del cursor se
+// decodifica mientras se navega; al elegirlo el audio sale del
+// cache y el decoder sigue desde el frame donde quedó.
+#define MP3_CACHE_MS        300u        // a la frecuencia del track
+#define MP3_CACHE_FS_MAX    48000u      // el slot se dimensiona para la más alta (57.6 KB estéreo)
+#define MP3_CACHE_SLOTS     1u          // el del cursor: ocupa toda la SRAM_L
+
+uint32_t MP3Player_CacheKey(const char *path);
+bool MP3Player_CacheTouch(uint32_t key);            // true si está (y lo marca como usado)
+bool MP3Player_Precache(FIL *fp, uint32_t key);     // fp abierto; no con un fundido en curso
+bool MP3Player_StartFromCache(FIL *fp, uint32_t key); // false: no está, usar InitWithOpenFile
+
 void MP3Player_FillDacBuffer(volatile uint16_t *dst, uint32_t n);
 
 uint32_t MP3Player_GetSampleRateHz(void);
@@ -25,9 +86,16 @@ void MP3Player_GetLastPCMwindow(int16_t *pcm, uint32_t max_samples);
 
 bool MP3Player_DecodeAsMuchAsPossibleToRing(void);
 
+// Lee el primer frame (y el header Xing/Info si existe) y estima la duración.
+// No toca el estado del decoder; deja el puntero del archivo en cualquier lado.
+bool MP3Player_ProbeFile(FIL *fp, uint32_t *duration_ms);
+
 uint32_t pcm_ring_level(void);
 uint32_t pcm_ring_free(void);
-uint32_t pcm_ring_pop_block(volatile uint16_t *dst, uint32_t n);
+uint32_t pcm_ring_pop_block(volatile uint16_t *dst, uint32_t n);  // n frames -> dst[2n]: L, R intercalados
+// Frecuencia de los samples en g_pcm_rd y cuántos quedan hasta que cambia
+// (UINT32_MAX: sin cambio pendiente). Solo desde el consumidor (Audio_Service).
+uint32_t pcm_ring_rate(uint32_t *span);
 
 void pcm_ring_clear(void);
 
@@ -65,6 +65,10 @@ extern  "C" {
 #endif
 #define  OS_CPU_ARM_FP_REG_NBR                           32u
 
+#define  OS_CPU_ARM_REG_FPCCR           (*((volatile CPU_INT32U *)0xE000EF34u))  /* FP Context Control Register      */
+#define  OS_CPU_ARM_FPCCR_ASPEN                  0x80000000u   /* Set CONTROL.FPCA on the first FP instruction       */
+#define  OS_CPU_ARM_FPCCR_LSPEN                  0x40000000u   /* Lazy stacking of S0-S15, FPSCR on exception entry  */
+
 
 /*
 *********************************************************************************************************
@@ -158,11 +162,6 @@ void  PendSV_Handler (void);
 void  SysTick_Handler(void);
 void  OS_CPU_SysTickInit   (CPU_INT32U  cnts);
 
-#if (OS_CPU_ARM_FP_EN == DEF_ENABLED)
-void  OS_CPU_FP_Reg_Push   (CPU_STK    *stkPtr);
-void  OS_CPU_FP_Reg_Pop    (CPU_STK    *stkPtr);
-#endif
-
 
 #ifdef __cplusplus
 }
@@ -91,7 +91,12 @@ void  OSIdleTaskHook (void)
 *
 * Arguments  : None.
 *
-* Note(s)    : None.
+* Note(s)    : 1) Automatic and lazy FP state preservation (FPCCR.ASPEN, FPCCR.LSPEN; reset values on the
+*                 Cortex-M4, set here so that nothing before the kernel can leave them off).  A task gets
+*                 an FP context on its first FP instruction; from then on exceptions stack an extended
+*                 frame whose S0-S15 and FPSCR are only written if the handler uses the FPU, and
+*                 PendSV_Handler saves S16-S31 only for such tasks.  Any task may use the FPU: the
+*                 OS_OPT_TASK_SAVE_FP option is no longer needed.
 *********************************************************************************************************
 */
 
@@ -100,6 +105,10 @@ void  OSInitHook (void)
                                                                     /* 8-byte align the ISR stack.                            */    
     OS_CPU_ExceptStkBase = (CPU_STK *)(OSCfg_ISRStkBasePtr + OSCfg_ISRStkSize);
     OS_CPU_ExceptStkBase = (CPU_STK *)((CPU_STK)(OS_CPU_ExceptStkBase) & 0xFFFFFFF8);
+
+#if (OS_CPU_ARM_FP_EN == DEF_ENABLED)
+    OS_CPU_ARM_REG_FPCCR |= OS_CPU_ARM_FPCCR_ASPEN | OS_CPU_ARM_FPCCR_LSPEN;
+#endif
 }
 
 
@@ -224,6 +233,8 @@ void  OSTaskReturnHook (OS_TCB  *p_tcb)
 * Note(s)    : 1) Interrupts are enabled when task starts executing.
 *
 *              2) All tasks run in Thread mode, using process stack.
+*
+*              3) All tasks start without an FP context, whatever 'opt' says (see OSInitHook() Note #1).
 **********************************************************************************************************
 */
 
@@ -243,29 +254,6 @@ CPU_STK  *OSTaskStkInit (OS_TASK_PTR    p_task,
                                                                 /* Align the stack to 8-bytes.                            */
     p_stk = (CPU_STK *)((CPU_STK)(p_stk) & 0xFFFFFFF8);
                                                                 /* Registers stacked as if auto-saved on exception        */
-#if (OS_CPU_ARM_FP_EN == DEF_ENABLED)                           /* FPU auto-saved registers.                              */
-    if ((opt & OS_OPT_TASK_SAVE_FP) != (OS_OPT)0) {
-        --p_stk;
-        *--p_stk = (CPU_STK)0x02000000u;                        /* FPSCR                                                  */
-                                                                /* Initialize S0-S15 floating point registers             */
-        *--p_stk = (CPU_STK)0x41700000u;                        /* S15                                                    */
-        *--p_stk = (CPU_STK)0x41600000u;                        /* S14                                                    */
-        *--p_stk = (CPU_STK)0x41500000u;                        /* S13                                                    */
-        *--p_stk = (CPU_STK)0x41400000u;                        /* S12                                                    */
-        *--p_stk = (CPU_STK)0x41300000u;                        /* S11                                                    */
-        *--p_stk = (CPU_STK)0x41200000u;                        /* S10                                                    */
-        *--p_stk = (CPU_STK)0x41100000u;                        /* S9                                                     */
-        *--p_stk = (CPU_STK)0x41000000u;                        /* S8                                                     */
-        *--p_stk = (CPU_STK)0x40E00000u;                        /* S7                                                     */
-        *--p_stk = (CPU_STK)0x40C00000u;                        /* S6                                                     */
-        *--p_stk = (CPU_STK)0x40A00000u;                        /* S5                                                     */
-        *--p_stk = (CPU_STK)0x40800000u;                        /* S4                                                     */
-        *--p_stk = (CPU_STK)0x40400000u;                        /* S3                                                     */
-        *--p_stk = (CPU_STK)0x40000000u;                        /* S2                                                     */
-        *--p_stk = (CPU_STK)0x3F800000u;                        /* S1                                                     */
-        *--p_stk = (CPU_STK)0x00000000u;                        /* S0                                                     */
-    }
-#endif
     *--p_stk = (CPU_STK)0x01000000u;                            /* xPSR                                                 */
     *--p_stk = (CPU_STK)p_task;                                 /* Entry Point                                          */
     *--p_stk = (CPU_STK)OS_TaskReturn;                          /* R14 (LR)                                             */
@@ -275,16 +263,7 @@ CPU_STK  *OSTaskStkInit (OS_TASK_PTR    p_task,
     *--p_stk = (CPU_STK)p_stk_limit;                            /* R1                                                   */
     *--p_stk = (CPU_STK)p_arg;                                  /* R0 : argument                                        */
 
-#if (OS_CPU_ARM_FP_EN == DEF_ENABLED)
-    if ((opt & OS_OPT_TASK_SAVE_FP) != (OS_OPT)0) {
-        *--p_stk = (CPU_STK)0xFFFFFFEDu;                      /* R14: exec return                                     */
-    }
-    else {
-        *--p_stk = (CPU_STK)0xFFFFFFFDu;                      /* R14: exec return                                     */
-    }
-#else
-    *--p_stk = (CPU_STK)0xFFFFFFFDu;                          /* R14: exec return                                     */
-#endif
+    *--p_stk = (CPU_STK)0xFFFFFFFDu;                            /* R14: exec return (PSP, basic frame: no FP context)   */
                                                                 /* Remaining registers saved on process stack           */
     *--p_stk = (CPU_STK)0x11111111u;                            /* R11                                                  */
     *--p_stk = (CPU_STK)0x10101010u;                            /* R10                                                  */
@@ -294,28 +273,6 @@ CPU_STK  *OSTaskStkInit (OS_TASK_PTR    p_task,
     *--p_stk = (CPU_STK)0x06060606u;                            /* R6                                                   */
     *--p_stk = (CPU_STK)0x05050505u;                            /* R5                                                   */
     *--p_stk = (CPU_STK)0x04040404u;                            /* R4                                                   */
-    
-#if (OS_CPU_ARM_FP_EN == DEF_ENABLED)
-    if ((opt & OS_OPT_TASK_SAVE_FP) != (OS_OPT)0) {
-                                                                /* Initialize S0-S31 floating point registers             */
-        *--p_stk = (CPU_STK)0x41F80000u;                        /* S31                                                    */
-        *--p_stk = (CPU_STK)0x41F00000u;                        /* S30                                                    */
-        *--p_stk = (CPU_STK)0x41E80000u;                        /* S29                                                    */
-        *--p_stk = (CPU_STK)0x41E00000u;                        /* S28                                                    */
-        *--p_stk = (CPU_STK)0x41D80000u;                        /* S27                                                    */
-        *--p_stk = (CPU_STK)0x41D00000u;                        /* S26                                                    */
-        *--p_stk = (CPU_STK)0x41C80000u;                        /* S25                                                    */
-        *--p_stk = (CPU_STK)0x41C00000u;                        /* S24                                                    */
-        *--p_stk = (CPU_STK)0x41B80000u;                        /* S23                                                    */
-        *--p_stk = (CPU_STK)0x41B00000u;                        /* S22                                                    */
-        *--p_stk = (CPU_STK)0x41A80000u;                        /* S21                                                    */
-        *--p_stk = (CPU_STK)0x41A00000u;                        /* S20                                                    */
-        *--p_stk = (CPU_STK)0x41980000u;                        /* S19                                                    */
-        *--p_stk = (CPU_STK)0x41900000u;                        /* S18                                                    */
-        *--p_stk = (CPU_STK)0x41880000u;                        /* S17                                                    */
-        *--p_stk = (CPU_STK)0x41800000u;                        /* S16                                                    */
-    }
-#endif    
 
     return (p_stk);
 }
@@ -346,16 +303,6 @@ void  OSTaskSwHook (void)
     CPU_TS  int_dis_time;
 #endif
 
-    
-#if (OS_CPU_ARM_FP_EN == DEF_ENABLED)
-    if ((OSTCBCurPtr->Opt & OS_OPT_TASK_SAVE_FP) != (OS_OPT)0) {
-        OS_CPU_FP_Reg_Push(OSTCBCurPtr->StkPtr);
-    }
-
-    if ((OSTCBHighRdyPtr->Opt & OS_OPT_TASK_SAVE_FP) != (OS_OPT)0) {
-        OS_CPU_FP_Reg_Pop(OSTCBHighRdyPtr->StkPtr);
-    }
-#endif    
 
 #if OS_CFG_APP_HOOKS_EN > 0u
     if (OS_AppTaskSwHookPtr != (OS_APP_HOOK_VOID)0) {